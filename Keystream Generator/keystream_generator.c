@@ -9,7 +9,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
 
 /**
  * Generates keystream for cryptographic testing with fixed key/nonce
@@ -22,7 +21,7 @@ uint8_t* generate_test_keystream(size_t len) {
     KaosCipher cipher;
     kaos_init(&cipher);  // Uses DEFAULT parameters from kaos.h
     
-    uint8_t* keystream = (uint8_t*)malloc(len);
+    uint8_t* keystream = (uint8_t*)kaos_alloc(len);
     if (!keystream) {
         fprintf(stderr, "Memory allocation failed for %zu bytes\n", len);
         return NULL;
@@ -43,32 +42,20 @@ uint8_t* generate_test_keystream(size_t len) {
     for (int i = 0; i < 6; i++) printf("%02x", nonce[i]);
     printf("...\n");
     
-    double x, y, z;
-    kaos_key_to_state(key, nonce, &x, &y, &z);
-    
+    printf("Kernel: %s (override with KAOS_KERNEL=scalar|sse2|avx2|avx512)\n",
+           kaos_kernel_name(kaos_get_kernel()));
     printf("Warmup phase: %d iterations...\n", cipher.warmup);
-    
-    /* Warmup phase - Critical for chaos development */
-    for (int i = 0; i < cipher.warmup; i++) {
-        lorenz_step(&cipher, &x, &y, &z);
-        if (i % 1000 == 0 && i > 0) {
-            printf("   Progress: %d/%d\n", i, cipher.warmup);
-        }
-    }
-    
     printf("Generating keystream: %zu bytes...\n", len);
     
-    /* Generate keystream bytes using KAOS library */
-    for (size_t i = 0; i < len; i++) {
-        lorenz_step(&cipher, &x, &y, &z);
-        keystream[i] = kaos_keystream_byte(x, y, z, i);
-        
-        /* Progress indicator for large generations */
-        if (len > 1000000 && i % (len/10) == 0 && i > 0) {
-            int progress = (int)((i * 100) / len);
-            printf("   Progress: %d%% (%zu/%zu bytes)\n", progress, i, len);
-        }
+    /* Raw keystream (= encryption of zeros) written straight into the buffer */
+    KaosStream* stream = kaos_stream_init(&cipher, key, nonce);
+    if (!stream || !kaos_stream_keystream(stream, keystream, len)) {
+        fprintf(stderr, "Keystream generation failed\n");
+        kaos_stream_final(stream);
+        kaos_free(keystream, len);
+        return NULL;
     }
+    kaos_stream_final(stream);
     
     printf("Keystream generation completed\n");
     return keystream;
@@ -164,27 +151,30 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    /* Large buffers: 2 MiB huge pages, faulted in before generation */
+    KaosAllocator allocator;
+    kaos_hugepage_allocator(&allocator);
+    kaos_set_allocator(&allocator);
+    
     printf("Starting keystream generation...\n");
     printf("   Size: %zu bytes (%.2f MB)\n", size, size / (1024.0 * 1024.0));
     printf("   Output: %s\n\n", filename);
     
-    /* Generate keystream and measure performance */
-    clock_t start_time = clock();
+    /* Generate keystream; the library's phase counters time each step */
+    kaos_stats_reset();
     uint8_t* keystream = generate_test_keystream(size);
-    clock_t end_time = clock();
     
     if (!keystream) {
         printf("Keystream generation failed\n");
         return 1;
     }
     
-    /* Calculate generation speed and statistics */
-    double cpu_time_used = ((double)(end_time - start_time)) / CLOCKS_PER_SEC;
-    double throughput = size / (1024.0 * 1024.0) / cpu_time_used;
+    KaosStats stats;
+    kaos_stats_snapshot(&stats);
+    char report[1024];
+    kaos_stats_format(&stats, KAOS_STATS_TEXT, report, sizeof(report));
     
-    printf("\nGeneration statistics:\n");
-    printf("   CPU time: %.3f seconds\n", cpu_time_used);
-    printf("   Throughput: %.2f MB/s\n", throughput);
+    printf("\nGeneration statistics:\n%s", report);
     
     /* Perform quick quality verification */
     verify_keystream(keystream, size > 10000 ? 10000 : size);
@@ -194,13 +184,13 @@ int main(int argc, char* argv[]) {
     FILE* f = fopen(filename, "wb");
     if (!f) {
         printf("Error: Cannot create file '%s'\n", filename);
-        free(keystream);
+        kaos_free(keystream, size);
         return 1;
     }
     
     size_t written = fwrite(keystream, 1, size, f);
     fclose(f);
-    free(keystream);
+    kaos_free(keystream, size);
     
     if (written != size) {
         printf("Error: Only %zu/%zu bytes written\n", written, size);
@@ -14,12 +14,29 @@
 #include <string.h>
 #include <math.h>
 #include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 /* ===== TEST CONFIGURATION ===== */
 #define TEST_KEYSTREAM_SIZE 1000000     /* 1MB for internal tests */
 #define AVALANCHE_TEST_ITERATIONS 50
 #define PERFORMANCE_TEST_SIZE 10485760  /* 10MB for benchmark */
 #define NIST_TEST_STREAM_SIZE 100000    /* 100KB for each NIST test */
+#define API_TEST_SIZE 100003            /* Odd size to exercise chunk tails */
+#define BATCH_TEST_MESSAGES 37          /* Not a multiple of any lane width */
+#define SEGMENTED_TEST_SIZE 16777259    /* 16MB + odd tail for KAOS-P scaling */
+#define PREFETCH_TEST_SIZE 4194319      /* 4MB + odd tail, many ring wraps */
+#define TILE_TEST_SIZE 8192             /* Keystream tile of the pipeline test */
+#define ALLOC_TEST_SIZE 67108864        /* 64MB fresh buffer for page-fault timing */
+#define IOV_SINGLE_BYTES 4096           /* Leading 1-byte fragments of the iovec test */
+#define FILE_TEST_WINDOW 8192           /* Small mmap window: many windows per file */
+#define PIPE_TEST_CHUNK 4096            /* Pipeline buffers: ~25 chunks through 3 slots */
+#define PIPE_TEST_WRITE 1000            /* Feeder write size, not a chunk divisor */
+#define CONTAINER_TEST_CHUNK 4096       /* Checkpoint spacing: ~25 chunks per container */
 
 /* ===== MATHEMATICAL CONSTANTS ===== */
 #define SQRT2 1.41421356237309504880
@@ -30,6 +47,9 @@ double gamma_q(double a, double x);
 int count_bits(uint8_t byte);
 uint8_t* generate_test_keystream(size_t len);
 
+/* Number of failed API consistency checks (non-zero exit status) */
+static int api_failures = 0;
+
 /* ===== NIST TEST SUITE IMPLEMENTATIONS ===== */
 
 /**
@@ -323,32 +343,32 @@ void performance_benchmark_raw_keys() {
     memset(key, 0x42, KAOS_KEY_SIZE);
     memset(nonce, 0x99, KAOS_NONCE_SIZE);
     
-    clock_t start = clock();
+    kaos_stats_reset();
     
-    /* Perform encryption-like operation (keystream generation) */
-    double x, y, z;
-    kaos_key_to_state(key, nonce, &x, &y, &z);
+    /* Encrypt test data in place (key setup + warmup + keystream + XOR) */
+    kaos_encrypt_into(&cipher, test_data, test_data, data_size, key, nonce);
     
-    for (int i = 0; i < cipher.warmup; i++) {
-        lorenz_step(&cipher, &x, &y, &z);
-    }
+    KaosStats stats;
+    kaos_stats_snapshot(&stats);
+    char report[1024];
+    kaos_stats_format(&stats, KAOS_STATS_TEXT, report, sizeof(report));
     
-    for (size_t i = 0; i < data_size; i++) {
-        lorenz_step(&cipher, &x, &y, &z);
-        kaos_keystream_byte(x, y, z, i); /* Generate keystream */
+    /* End-to-end time is the sum of the four phases */
+    double seconds = 0.0;
+    for (int p = 0; p < KAOS_PHASE_COUNT; p++) {
+        seconds += stats.phase[p].seconds;
     }
-    
-    clock_t end = clock();
-    
-    double cpu_time_used = ((double)(end - start)) / CLOCKS_PER_SEC;
-    double throughput = data_size / (1024.0 * 1024.0) / cpu_time_used;
+    double throughput = seconds > 0.0 ? data_size / (1024.0 * 1024.0) / seconds : 0.0;
     
     printf("Data size: %.2f MB\n", data_size / (1024.0 * 1024.0));
-    printf("CPU time: %.3f seconds\n", cpu_time_used);
-    printf("Throughput: %.2f MB/s\n", throughput);
+    printf("%s", report);
+    if (stats.enabled) {
+        printf("Throughput: %.2f MB/s (all phases)\n", throughput);
+    }
     
     const char* performance;
-    if (throughput > 100) performance = "EXCELLENT";
+    if (!stats.enabled) performance = "NOT MEASURED";
+    else if (throughput > 100) performance = "EXCELLENT";
     else if (throughput > 50) performance = "VERY GOOD";
     else if (throughput > 25) performance = "GOOD";
     else performance = "ACCEPTABLE";
@@ -469,6 +489,1832 @@ void extended_correlation_analysis(const uint8_t* data, size_t len) {
     printf("Correlation quality: %s\n\n", correlation_result);
 }
 
+/* ===== API CONSISTENCY TESTS ===== */
+
+/**
+ * Reports an API consistency check result and records failures
+ * 
+ * @param passed Non-zero if the check passed
+ */
+void api_check_result(int passed) {
+    if (!passed) api_failures++;
+    printf("Result: %s\n\n", passed ? "PASS" : "FAIL");
+}
+
+/**
+ * Streaming API must reproduce one-shot kaos_encrypt for any chunking
+ * Uses 1-byte, prime-sized and large chunks
+ */
+void streaming_consistency_test() {
+    printf("[API] STREAMING CONSISTENCY TEST\n");
+    printf("--------------------------------\n");
+    
+    KaosCipher cipher;
+    kaos_init(&cipher);
+    
+    uint8_t key[KAOS_KEY_SIZE];
+    uint8_t nonce[KAOS_NONCE_SIZE];
+    memset(key, 0x42, KAOS_KEY_SIZE);
+    memset(nonce, 0x99, KAOS_NONCE_SIZE);
+    
+    uint8_t* plaintext = (uint8_t*)malloc(API_TEST_SIZE);
+    uint8_t* streamed = (uint8_t*)malloc(API_TEST_SIZE);
+    if (!plaintext || !streamed) {
+        printf("Error: Memory allocation failed\n");
+        free(plaintext);
+        free(streamed);
+        api_check_result(0);
+        return;
+    }
+    
+    for (size_t i = 0; i < API_TEST_SIZE; i++) {
+        plaintext[i] = (uint8_t)(i * 31 + 7);
+    }
+    
+    uint8_t* reference = kaos_encrypt(&cipher, plaintext, API_TEST_SIZE, key, nonce);
+    
+    const size_t chunk_sizes[] = {1, 7, 64, 4093, 65536};
+    const int num_chunk_sizes = sizeof(chunk_sizes) / sizeof(chunk_sizes[0]);
+    int mismatches = 0;
+    
+    for (int c = 0; c < num_chunk_sizes && reference; c++) {
+        KaosStream* stream = kaos_stream_init(&cipher, key, nonce);
+        if (!stream) {
+            mismatches++;
+            continue;
+        }
+        
+        for (size_t offset = 0; offset < API_TEST_SIZE; offset += chunk_sizes[c]) {
+            size_t n = API_TEST_SIZE - offset;
+            if (n > chunk_sizes[c]) n = chunk_sizes[c];
+            kaos_stream_update(stream, plaintext + offset, streamed + offset, n);
+        }
+        
+        int match = kaos_stream_position(stream) == API_TEST_SIZE &&
+                    memcmp(streamed, reference, API_TEST_SIZE) == 0;
+        printf("Chunk size %6zu: %s\n", chunk_sizes[c], match ? "identical" : "MISMATCH");
+        if (!match) mismatches++;
+        
+        kaos_stream_final(stream);
+    }
+    
+    api_check_result(reference && mismatches == 0);
+    
+    free(reference);
+    free(plaintext);
+    free(streamed);
+}
+
+/**
+ * Known-answer vector for key setup: nonce bytes 10 and 11 exercise the
+ * sign-extended 32-bit shift (byte 11 is shifted by 33 mod 32). These are
+ * the outputs of -O0..-O2 builds of the original code; -O3 builds dropped
+ * byte 11 and gave a different state and ciphertext for this nonce
+ */
+void nonce_mixing_vector_test() {
+    printf("[API] KEY SETUP KNOWN-ANSWER TEST\n");
+    printf("---------------------------------\n");
+    
+    static const double expected_state[3] = {
+        0x1.3a17948f59907p-2, 0x1.770fc33fc6137p-1, 0x1.4496a01a25368p-1
+    };
+    static const uint8_t expected_keystream[16] = {
+        0xE6, 0x63, 0x06, 0xD4, 0xE6, 0x6E, 0x77, 0x85,
+        0x5B, 0xD8, 0xC7, 0x44, 0xCE, 0xEA, 0x51, 0x68
+    };
+    
+    KaosCipher cipher;
+    kaos_init(&cipher);
+    
+    uint8_t key[KAOS_KEY_SIZE];
+    uint8_t nonce[KAOS_NONCE_SIZE];
+    for (int i = 0; i < KAOS_KEY_SIZE; i++) {
+        key[i] = (uint8_t)i;
+    }
+    memset(nonce, 0, KAOS_NONCE_SIZE);
+    nonce[10] = 0xFF;
+    nonce[11] = 0x80;
+    
+    double x, y, z;
+    kaos_key_to_state(key, nonce, &x, &y, &z);
+    int state_match = x == expected_state[0] && y == expected_state[1] &&
+                      z == expected_state[2];
+    
+    uint8_t zero[16] = {0};
+    uint8_t keystream[16];
+    int stream_match = kaos_encrypt_into(&cipher, zero, keystream, 16, key, nonce) &&
+                       memcmp(keystream, expected_keystream, 16) == 0;
+    
+    /* Byte 11 alone must still change the initial state */
+    double x11, y11, z11;
+    nonce[11] = 0;
+    kaos_key_to_state(key, nonce, &x11, &y11, &z11);
+    int byte11_used = x11 != x || y11 != y || z11 != z;
+    
+    printf("Initial state: %s\n", state_match ? "matches vector" : "MISMATCH");
+    printf("First 16 keystream bytes: %s\n", stream_match ? "match vector" : "MISMATCH");
+    printf("Nonce byte 11 mixed in: %s\n", byte11_used ? "yes" : "NO");
+    api_check_result(state_match && stream_match && byte11_used);
+}
+
+/**
+ * Caller-buffer API must match kaos_encrypt, including in-place operation
+ */
+void encrypt_into_consistency_test() {
+    printf("[API] ENCRYPT_INTO / IN-PLACE CONSISTENCY TEST\n");
+    printf("----------------------------------------------\n");
+    
+    KaosCipher cipher;
+    kaos_init(&cipher);
+    
+    uint8_t key[KAOS_KEY_SIZE];
+    uint8_t nonce[KAOS_NONCE_SIZE];
+    memset(key, 0x5A, KAOS_KEY_SIZE);
+    memset(nonce, 0x3C, KAOS_NONCE_SIZE);
+    
+    uint8_t* plaintext = (uint8_t*)malloc(API_TEST_SIZE);
+    uint8_t* out = (uint8_t*)malloc(API_TEST_SIZE);
+    uint8_t* inplace = (uint8_t*)malloc(API_TEST_SIZE);
+    if (!plaintext || !out || !inplace) {
+        printf("Error: Memory allocation failed\n");
+        free(plaintext);
+        free(out);
+        free(inplace);
+        api_check_result(0);
+        return;
+    }
+    
+    for (size_t i = 0; i < API_TEST_SIZE; i++) {
+        plaintext[i] = (uint8_t)(i * 13 + 1);
+    }
+    memcpy(inplace, plaintext, API_TEST_SIZE);
+    
+    uint8_t* reference = kaos_encrypt(&cipher, plaintext, API_TEST_SIZE, key, nonce);
+    
+    int separate_ok = kaos_encrypt_into(&cipher, plaintext, out, API_TEST_SIZE, key, nonce) &&
+                      reference && memcmp(out, reference, API_TEST_SIZE) == 0;
+    int inplace_ok = kaos_encrypt_into(&cipher, inplace, inplace, API_TEST_SIZE, key, nonce) &&
+                     reference && memcmp(inplace, reference, API_TEST_SIZE) == 0;
+    int roundtrip_ok = kaos_decrypt_into(&cipher, inplace, inplace, API_TEST_SIZE, key, nonce) &&
+                       memcmp(inplace, plaintext, API_TEST_SIZE) == 0;
+    
+    printf("Separate buffers: %s\n", separate_ok ? "identical" : "MISMATCH");
+    printf("In-place:         %s\n", inplace_ok ? "identical" : "MISMATCH");
+    printf("In-place decrypt: %s\n", roundtrip_ok ? "restored" : "MISMATCH");
+    
+    api_check_result(separate_ok && inplace_ok && roundtrip_ok);
+    
+    free(reference);
+    free(plaintext);
+    free(out);
+    free(inplace);
+}
+
+/**
+ * Runs one batch over the messages (in place) and compares with references
+ * 
+ * @return Number of mismatching messages, -1 if the batch call failed
+ */
+int run_batch_against_references(KaosCipher* cipher, KaosMessage* msgs,
+                                 uint8_t** plaintexts, uint8_t** references) {
+    for (int m = 0; m < BATCH_TEST_MESSAGES; m++) {
+        memcpy(msgs[m].out, plaintexts[m], msgs[m].length);
+        msgs[m].in = msgs[m].out;
+    }
+    
+    if (!kaos_encrypt_batch(cipher, msgs, BATCH_TEST_MESSAGES)) return -1;
+    
+    int mismatches = 0;
+    for (int m = 0; m < BATCH_TEST_MESSAGES; m++) {
+        if (msgs[m].length && memcmp(msgs[m].out, references[m], msgs[m].length) != 0) {
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+/**
+ * Batch engine must match kaos_encrypt per message
+ * Unequal lengths (including empty) force lane refill mid-run
+ * Covers the selected kernel and the interleaved scalar engine widths
+ */
+void batch_consistency_test() {
+    printf("[API] BATCH ENGINE CONSISTENCY TEST\n");
+    printf("-----------------------------------\n");
+    
+    KaosCipher cipher;
+    kaos_init(&cipher);
+    
+    KaosMessage msgs[BATCH_TEST_MESSAGES];
+    uint8_t keys[BATCH_TEST_MESSAGES][KAOS_KEY_SIZE];
+    uint8_t nonces[BATCH_TEST_MESSAGES][KAOS_NONCE_SIZE];
+    uint8_t* plaintexts[BATCH_TEST_MESSAGES];
+    uint8_t* references[BATCH_TEST_MESSAGES];
+    size_t total = 0;
+    int allocation_ok = 1;
+    
+    for (int m = 0; m < BATCH_TEST_MESSAGES; m++) {
+        size_t len = (m % 5 == 4) ? 0 : (size_t)((m * 7919) % 3001 + m);
+        memset(keys[m], 0x10 + m, KAOS_KEY_SIZE);
+        memset(nonces[m], 0x80 ^ m, KAOS_NONCE_SIZE);
+        keys[m][m % KAOS_KEY_SIZE] ^= 0xFF;
+        
+        plaintexts[m] = (uint8_t*)malloc(len ? len : 1);
+        msgs[m].out = (uint8_t*)malloc(len ? len : 1);
+        if (!plaintexts[m] || !msgs[m].out) allocation_ok = 0;
+        for (size_t i = 0; i < len && plaintexts[m]; i++) plaintexts[m][i] = (uint8_t)(i ^ m);
+        
+        msgs[m].length = len;
+        msgs[m].key = keys[m];
+        msgs[m].nonce = nonces[m];
+        total += len;
+        
+        references[m] = (len && plaintexts[m]) ?
+            kaos_encrypt(&cipher, plaintexts[m], len, keys[m], nonces[m]) : NULL;
+        if (len && !references[m]) allocation_ok = 0;
+    }
+    
+    printf("Messages: %d (%zu bytes total)\n", BATCH_TEST_MESSAGES, total);
+    
+    int failures = !allocation_ok;
+    if (allocation_ok) {
+        KaosKernelId selected = kaos_get_kernel();
+        int mismatches = run_batch_against_references(&cipher, msgs, plaintexts, references);
+        printf("Selected kernel (%s): %d mismatching messages\n",
+               kaos_kernel_name(selected), mismatches);
+        if (mismatches != 0) failures++;
+        
+        /* Interleaved scalar engine at every supported width */
+        const int widths[] = {2, 4, 8};
+        int default_width = kaos_get_interleave();
+        kaos_set_kernel(KAOS_KERNEL_SCALAR);
+        for (int w = 0; w < 3; w++) {
+            kaos_set_interleave(widths[w]);
+            mismatches = run_batch_against_references(&cipher, msgs, plaintexts, references);
+            printf("Interleaved x%d streams: %d mismatching messages\n", widths[w], mismatches);
+            if (mismatches != 0) failures++;
+        }
+        kaos_set_interleave(default_width);
+        kaos_set_kernel(selected);
+    }
+    
+    for (int m = 0; m < BATCH_TEST_MESSAGES; m++) {
+        free(plaintexts[m]);
+        free(msgs[m].out);
+        free(references[m]);
+    }
+    
+    api_check_result(failures == 0);
+}
+
+/**
+ * Every available kernel must reproduce the scalar reference
+ * for one-shot, streaming and batch encryption
+ */
+void kernel_dispatch_test() {
+    printf("[API] KERNEL DISPATCH TEST\n");
+    printf("--------------------------\n");
+    
+    KaosCipher cipher;
+    kaos_init(&cipher);
+    
+    KaosKernelId selected = kaos_get_kernel();
+    printf("Selected kernel: %s\n", kaos_kernel_name(selected));
+    
+    uint8_t key[KAOS_KEY_SIZE];
+    uint8_t nonce[KAOS_NONCE_SIZE];
+    memset(key, 0x77, KAOS_KEY_SIZE);
+    memset(nonce, 0x11, KAOS_NONCE_SIZE);
+    
+    const size_t len = 20011;
+    uint8_t* plaintext = (uint8_t*)malloc(len);
+    uint8_t* reference = (uint8_t*)malloc(len);
+    uint8_t* out = (uint8_t*)malloc(len);
+    if (!plaintext || !reference || !out) {
+        printf("Error: Memory allocation failed\n");
+        free(plaintext);
+        free(reference);
+        free(out);
+        api_check_result(0);
+        return;
+    }
+    for (size_t i = 0; i < len; i++) plaintext[i] = (uint8_t)(i * 3);
+    
+    /* Reference built from the low-level functions, one byte at a time */
+    double x, y, z;
+    kaos_key_to_state(key, nonce, &x, &y, &z);
+    for (int i = 0; i < cipher.warmup; i++) {
+        lorenz_step(&cipher, &x, &y, &z);
+    }
+    for (size_t i = 0; i < len; i++) {
+        lorenz_step(&cipher, &x, &y, &z);
+        reference[i] = plaintext[i] ^ kaos_keystream_byte(x, y, z, i);
+    }
+    
+    int mismatches = 0;
+    for (int k = 0; k < KAOS_KERNEL_COUNT; k++) {
+        if (!kaos_set_kernel((KaosKernelId)k)) {
+            printf("Kernel %-7s: not available\n", kaos_kernel_name((KaosKernelId)k));
+            continue;
+        }
+        
+        /* One-shot, then three batch messages sharing the reference prefix */
+        memset(out, 0, len);
+        kaos_encrypt_into(&cipher, plaintext, out, len, key, nonce);
+        int oneshot_ok = memcmp(out, reference, len) == 0;
+        
+        KaosMessage msgs[3];
+        for (int m = 0; m < 3; m++) {
+            msgs[m].in = plaintext;
+            msgs[m].out = (m == 0) ? out : (uint8_t*)malloc(len);
+            msgs[m].length = len - (size_t)m * 4000;
+            msgs[m].key = key;
+            msgs[m].nonce = nonce;
+        }
+        int batch_ok = msgs[1].out && msgs[2].out &&
+                       kaos_encrypt_batch(&cipher, msgs, 3);
+        for (int m = 0; m < 3 && batch_ok; m++) {
+            batch_ok = memcmp(msgs[m].out, reference, msgs[m].length) == 0;
+        }
+        free(msgs[1].out);
+        free(msgs[2].out);
+        
+        /* Fused block kernel, raw keystream in KAOS_BLOCK_SIZE steps */
+        KaosState state;
+        kaos_key_to_state(key, nonce, &state.x, &state.y, &state.z);
+        for (int i = 0; i < cipher.warmup; i++) {
+            lorenz_step(&cipher, &state.x, &state.y, &state.z);
+        }
+        int block_ok = 1;
+        for (size_t offset = 0; offset < len && block_ok; offset += KAOS_BLOCK_SIZE) {
+            uint8_t block[KAOS_BLOCK_SIZE];
+            size_t n = (len - offset < KAOS_BLOCK_SIZE) ? len - offset : KAOS_BLOCK_SIZE;
+            kaos_keystream_block(&cipher, &state, offset, block, n);
+            for (size_t i = 0; i < n; i++) {
+                if ((uint8_t)(block[i] ^ plaintext[offset + i]) != reference[offset + i]) {
+                    block_ok = 0;
+                }
+            }
+        }
+        
+        printf("Kernel %-7s: one-shot %s, batch %s, block %s\n",
+               kaos_kernel_name((KaosKernelId)k),
+               oneshot_ok ? "identical" : "MISMATCH", batch_ok ? "identical" : "MISMATCH",
+               block_ok ? "identical" : "MISMATCH");
+        if (!oneshot_ok || !batch_ok || !block_ok) mismatches++;
+    }
+    
+    kaos_set_kernel(selected);
+    api_check_result(mismatches == 0);
+    
+    free(plaintext);
+    free(reference);
+    free(out);
+}
+
+/**
+ * Cached decrypt and stream setup must match the uncached paths;
+ * checks hit/miss/eviction counters and invalidation
+ */
+void state_cache_test() {
+    printf("[API] WARMED STATE CACHE TEST\n");
+    printf("-----------------------------\n");
+    
+    KaosCipher cipher;
+    kaos_init(&cipher);
+    
+    const size_t len = 4099;
+    uint8_t key[KAOS_KEY_SIZE];
+    uint8_t nonces[3][KAOS_NONCE_SIZE];
+    memset(key, 0x6B, KAOS_KEY_SIZE);
+    for (int n = 0; n < 3; n++) memset(nonces[n], 0x20 + n, KAOS_NONCE_SIZE);
+    
+    KaosCache* cache = kaos_cache_new(2);
+    uint8_t* plaintext = (uint8_t*)malloc(len);
+    uint8_t* reference = (uint8_t*)malloc(len);
+    uint8_t* out = (uint8_t*)malloc(len);
+    if (!cache || !plaintext || !reference || !out) {
+        printf("Error: Memory allocation failed\n");
+        kaos_cache_free(cache);
+        free(plaintext);
+        free(reference);
+        free(out);
+        api_check_result(0);
+        return;
+    }
+    for (size_t i = 0; i < len; i++) plaintext[i] = (uint8_t)(i * 13 + 5);
+    
+    /* Miss then hit on nonce 0, both identical to kaos_decrypt_into */
+    int failures = 0;
+    kaos_decrypt_into(&cipher, plaintext, reference, len, key, nonces[0]);
+    for (int pass = 0; pass < 2; pass++) {
+        memset(out, 0, len);
+        kaos_decrypt_cached(&cipher, cache, plaintext, out, len, key, nonces[0]);
+        if (memcmp(out, reference, len) != 0) failures++;
+    }
+    
+    /* Streaming context from the cached state, split in two updates */
+    KaosStream* stream = kaos_stream_init_cached(&cipher, cache, key, nonces[0]);
+    if (!stream) {
+        failures++;
+    } else {
+        kaos_stream_update(stream, plaintext, out, 1000);
+        kaos_stream_update(stream, plaintext + 1000, out + 1000, len - 1000);
+        if (memcmp(out, reference, len) != 0) failures++;
+        kaos_stream_final(stream);
+    }
+    
+    KaosCacheStats stats;
+    kaos_cache_stats(cache, &stats);
+    printf("After 3 lookups of one key+nonce: %llu hits, %llu misses\n",
+           (unsigned long long)stats.hits, (unsigned long long)stats.misses);
+    if (stats.hits != 2 || stats.misses != 1) failures++;
+    
+    /* Capacity 2: third nonce evicts the least recently used entry */
+    kaos_decrypt_cached(&cipher, cache, plaintext, out, len, key, nonces[1]);
+    kaos_decrypt_cached(&cipher, cache, plaintext, out, len, key, nonces[2]);
+    kaos_cache_stats(cache, &stats);
+    printf("After 3 distinct nonces: %zu/%zu entries, %llu evictions\n",
+           stats.entries, stats.capacity, (unsigned long long)stats.evictions);
+    if (stats.entries != 2 || stats.evictions != 1) failures++;
+    
+    /* Invalidated entry is recomputed (miss) with the same output */
+    int removed = kaos_cache_invalidate(cache, key, nonces[2]);
+    kaos_decrypt_into(&cipher, plaintext, reference, len, key, nonces[2]);
+    kaos_decrypt_cached(&cipher, cache, plaintext, out, len, key, nonces[2]);
+    kaos_cache_stats(cache, &stats);
+    printf("Invalidate: %s, misses now %llu\n", removed ? "removed" : "NOT FOUND",
+           (unsigned long long)stats.misses);
+    if (!removed || stats.misses != 4 || memcmp(out, reference, len) != 0) failures++;
+    
+    kaos_cache_clear(cache);
+    kaos_cache_stats(cache, &stats);
+    if (stats.entries != 0) failures++;
+    
+    api_check_result(failures == 0);
+    
+    kaos_cache_free(cache);
+    free(plaintext);
+    free(reference);
+    free(out);
+}
+
+/**
+ * Checkpoint index: record while encrypting, serialize, then seek
+ * a fresh stream to arbitrary offsets (forward and backward)
+ */
+void seek_index_test() {
+    printf("[API] CHECKPOINT INDEX / SEEK TEST\n");
+    printf("----------------------------------\n");
+    
+    KaosCipher cipher;
+    kaos_init(&cipher);
+    
+    uint8_t key[KAOS_KEY_SIZE];
+    uint8_t nonce[KAOS_NONCE_SIZE];
+    memset(key, 0x2D, KAOS_KEY_SIZE);
+    memset(nonce, 0xE1, KAOS_NONCE_SIZE);
+    
+    uint8_t* plaintext = (uint8_t*)malloc(API_TEST_SIZE);
+    uint8_t* ciphertext = (uint8_t*)malloc(API_TEST_SIZE);
+    uint8_t* out = (uint8_t*)malloc(API_TEST_SIZE);
+    KaosIndex* index = kaos_index_new(4096);
+    KaosStream* stream = kaos_stream_init(&cipher, key, nonce);
+    if (!plaintext || !ciphertext || !out || !index || !stream) {
+        printf("Error: Memory allocation failed\n");
+        free(plaintext);
+        free(ciphertext);
+        free(out);
+        kaos_index_free(index);
+        kaos_stream_final(stream);
+        api_check_result(0);
+        return;
+    }
+    for (size_t i = 0; i < API_TEST_SIZE; i++) plaintext[i] = (uint8_t)(i * 11 + 1);
+    
+    /* Encrypt in uneven chunks with the index attached */
+    int failures = 0;
+    kaos_stream_attach_index(stream, index);
+    for (size_t offset = 0; offset < API_TEST_SIZE; offset += 3001) {
+        size_t n = API_TEST_SIZE - offset;
+        if (n > 3001) n = 3001;
+        kaos_stream_update(stream, plaintext + offset, ciphertext + offset, n);
+    }
+    kaos_stream_final(stream);
+    
+    kaos_encrypt_into(&cipher, plaintext, out, API_TEST_SIZE, key, nonce);
+    if (memcmp(out, ciphertext, API_TEST_SIZE) != 0) failures++;
+    
+    /* Serialize and reload */
+    size_t size = kaos_index_serialize(index, NULL, 0);
+    uint8_t* blob = (uint8_t*)malloc(size);
+    KaosIndex* loaded = NULL;
+    if (blob && kaos_index_serialize(index, blob, size) == size) {
+        loaded = kaos_index_deserialize(blob, size);
+    }
+    printf("Index: %llu checkpoints every %u bytes, %zu bytes serialized\n",
+           (unsigned long long)kaos_index_count(index), kaos_index_interval(index), size);
+    if (!loaded || kaos_index_count(loaded) != (API_TEST_SIZE - 1) / 4096 + 1) failures++;
+    
+    /* Range decryption through seeks, in a deliberately unordered sequence */
+    const uint64_t offsets[] = {98000, 4096, 4095, 0, 57345, 57344, 100002, 12};
+    const int num_offsets = sizeof(offsets) / sizeof(offsets[0]);
+    stream = kaos_stream_init(&cipher, key, nonce);
+    if (!stream || !loaded) {
+        failures++;
+    } else {
+        kaos_stream_attach_index(stream, loaded);
+        for (int o = 0; o < num_offsets; o++) {
+            size_t n = API_TEST_SIZE - (size_t)offsets[o];
+            if (n > 1000) n = 1000;
+            int ok = kaos_seek(stream, offsets[o]) &&
+                     kaos_stream_update(stream, ciphertext + offsets[o], out, n) &&
+                     memcmp(out, plaintext + offsets[o], n) == 0;
+            if (!ok) failures++;
+        }
+    }
+    kaos_stream_final(stream);
+    
+    /* Without an index, seeking replays from the current or initial state */
+    stream = kaos_stream_init(&cipher, key, nonce);
+    int plain_ok = stream && kaos_seek(stream, 70000) &&
+                   kaos_stream_update(stream, ciphertext + 70000, out, 100) &&
+                   memcmp(out, plaintext + 70000, 100) == 0 &&
+                   kaos_seek(stream, 5) &&
+                   kaos_stream_update(stream, ciphertext + 5, out, 100) &&
+                   memcmp(out, plaintext + 5, 100) == 0;
+    kaos_stream_final(stream);
+    if (!plain_ok) failures++;
+    
+    printf("Seeks to %d offsets with index, 2 without: %s\n", num_offsets,
+           failures == 0 ? "identical" : "MISMATCH");
+    
+    /* Malformed input must be rejected */
+    if (blob && size > 0) {
+        blob[0] ^= 1;
+        if (kaos_index_deserialize(blob, size) != NULL) failures++;
+        if (kaos_index_deserialize(blob, size - 1) != NULL) failures++;
+    }
+    
+    api_check_result(failures == 0);
+    
+    kaos_index_free(index);
+    kaos_index_free(loaded);
+    free(blob);
+    free(plaintext);
+    free(ciphertext);
+    free(out);
+}
+
+/**
+ * KAOS-P: container round trip, segment layout, thread-count independence,
+ * then wall-clock throughput scaling over thread counts
+ */
+void segmented_mode_test() {
+    printf("[API] SEGMENTED PARALLEL MODE (KAOS-P)\n");
+    printf("--------------------------------------\n");
+    
+    KaosCipher cipher;
+    kaos_init(&cipher);
+    
+    uint8_t key[KAOS_KEY_SIZE];
+    uint8_t nonce[KAOS_NONCE_SIZE];
+    memset(key, 0x4E, KAOS_KEY_SIZE);
+    memset(nonce, 0x07, KAOS_NONCE_SIZE);
+    
+    const size_t len = SEGMENTED_TEST_SIZE;
+    const uint32_t segment = 65536;
+    size_t size = kaos_p_container_size(len);
+    uint8_t* plaintext = (uint8_t*)malloc(len);
+    uint8_t* container = (uint8_t*)malloc(size);
+    uint8_t* other = (uint8_t*)malloc(size);
+    uint8_t* out = (uint8_t*)malloc(len);
+    if (!plaintext || !container || !other || !out) {
+        printf("Error: Memory allocation failed\n");
+        free(plaintext);
+        free(container);
+        free(other);
+        free(out);
+        api_check_result(0);
+        return;
+    }
+    for (size_t i = 0; i < len; i++) plaintext[i] = (uint8_t)(i * 29 + 3);
+    
+    /* Same container for 1 and 4 threads; decrypts back to the plaintext */
+    int failures = 0;
+    KaosPHeader header;
+    if (!kaos_p_encrypt(&cipher, plaintext, len, container, size, key, nonce, segment, 1) ||
+        !kaos_p_encrypt(&cipher, plaintext, len, other, size, key, nonce, segment, 4) ||
+        memcmp(container, other, size) != 0) failures++;
+    if (!kaos_p_parse_header(container, size, &header) || header.length != len ||
+        header.segment_size != segment || header.mode != KAOS_P_MODE_SEGMENTED) failures++;
+    if (!kaos_p_decrypt(&cipher, container, size, out, len, key, 0) ||
+        memcmp(out, plaintext, len) != 0) failures++;
+    
+    /* Last (short) segment is a plain KAOS stream under its segment nonce */
+    size_t last = (len - 1) / segment;
+    uint8_t segment_nonce[KAOS_NONCE_SIZE];
+    kaos_p_segment_nonce(nonce, last, segment_nonce);
+    kaos_encrypt_into(&cipher, plaintext + last * segment, out, len - last * segment,
+                      key, segment_nonce);
+    if (memcmp(out, container + KAOS_P_HEADER_SIZE + last * segment, len - last * segment) != 0) {
+        failures++;
+    }
+    
+    /* Truncated container is rejected */
+    if (kaos_p_decrypt(&cipher, container, size - 1, out, len, key, 0)) failures++;
+    
+    printf("Round trip, 1 vs 4 threads, segment layout: %s\n",
+           failures == 0 ? "identical" : "MISMATCH");
+    
+    /* Scaling - wall-clock time, default 1 MiB segments */
+    printf("Online CPUs: %ld\n", sysconf(_SC_NPROCESSORS_ONLN));
+    const int thread_counts[] = {1, 2, 4, 8, 0};
+    double base = 0.0;
+    for (int t = 0; t < 5; t++) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        kaos_p_encrypt(&cipher, plaintext, len, container, size, key, nonce, 0, thread_counts[t]);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        
+        double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        double throughput = len / (1024.0 * 1024.0) / seconds;
+        if (t == 0) base = throughput;
+        
+        if (thread_counts[t] == 0) printf("Threads all: ");
+        else printf("Threads %3d: ", thread_counts[t]);
+        printf("%8.2f MB/s (%.2fx)\n", throughput, throughput / base);
+    }
+    
+    api_check_result(failures == 0);
+    
+    free(plaintext);
+    free(container);
+    free(other);
+    free(out);
+}
+
+/* Completion callback: counts finished messages of the pool test */
+static void pool_test_callback(void* user, size_t index) {
+    (void)index;
+    __atomic_fetch_add((int*)user, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Work-stealing pool: messages from 0 bytes to 1MB, every one identical
+ * to kaos_encrypt_into, one callback per message
+ */
+void pool_batch_test() {
+    printf("[API] WORK-STEALING POOL BATCH TEST\n");
+    printf("-----------------------------------\n");
+    
+    KaosCipher cipher;
+    kaos_init(&cipher);
+    
+    const size_t sizes[] = {20, 0, 1048576, 1, 65536, 65537, 300000, 20, 4096, 777};
+    const size_t count = sizeof(sizes) / sizeof(sizes[0]);
+    const size_t total = 20 + 1048576 + 1 + 65536 + 65537 + 300000 + 20 + 4096 + 777;
+    
+    uint8_t key[KAOS_KEY_SIZE];
+    uint8_t nonces[10][KAOS_NONCE_SIZE];
+    memset(key, 0x3F, KAOS_KEY_SIZE);
+    for (size_t m = 0; m < count; m++) memset(nonces[m], (int)(m * 17 + 1), KAOS_NONCE_SIZE);
+    
+    KaosPool* pool = kaos_pool_new(3, NULL);
+    uint8_t* plaintext = (uint8_t*)malloc(total);
+    uint8_t* out = (uint8_t*)malloc(total);
+    uint8_t* reference = (uint8_t*)malloc(total);
+    if (!pool || !plaintext || !out || !reference) {
+        printf("Error: Pool or memory allocation failed\n");
+        kaos_pool_free(pool);
+        free(plaintext);
+        free(out);
+        free(reference);
+        api_check_result(0);
+        return;
+    }
+    for (size_t i = 0; i < total; i++) plaintext[i] = (uint8_t)(i * 5 + 9);
+    
+    KaosMessage msgs[10];
+    size_t offset = 0;
+    for (size_t m = 0; m < count; m++) {
+        msgs[m].in = plaintext + offset;
+        msgs[m].out = out + offset;
+        msgs[m].length = sizes[m];
+        msgs[m].key = key;
+        msgs[m].nonce = nonces[m];
+        if (sizes[m] > 0) {
+            kaos_encrypt_into(&cipher, plaintext + offset, reference + offset, sizes[m],
+                              key, nonces[m]);
+        }
+        offset += sizes[m];
+    }
+    
+    int callbacks = 0;
+    KaosFuture* future = kaos_pool_submit_batch(pool, &cipher, msgs, count,
+                                                pool_test_callback, &callbacks);
+    kaos_future_wait(future);
+    int done = kaos_future_done(future);
+    kaos_future_free(future);
+    
+    int identical = memcmp(out, reference, total) == 0;
+    printf("Workers: %d, messages: %zu, callbacks: %d, output %s\n",
+           kaos_pool_workers(pool), count, callbacks, identical ? "identical" : "MISMATCH");
+    
+    /* Pinned workers (all on CPU 0) must still complete */
+    const int cpus[2] = {0, 0};
+    KaosPool* pinned = kaos_pool_new(2, cpus);
+    memset(out, 0, total);
+    future = pinned ? kaos_pool_submit_batch(pinned, &cipher, msgs, count, NULL, NULL) : NULL;
+    int pinned_ok = future != NULL;
+    kaos_future_free(future);
+    pinned_ok = pinned_ok && memcmp(out, reference, total) == 0;
+    printf("Pinned pool: %s\n", pinned_ok ? "identical" : "MISMATCH");
+    kaos_pool_free(pinned);
+    
+    /* CPU list without a worker count has no known length: rejected */
+    KaosPool* unsized = kaos_pool_new(0, cpus);
+    int unsized_rejected = unsized == NULL;
+    kaos_pool_free(unsized);
+    printf("CPU list with workers = 0: %s\n", unsized_rejected ? "rejected" : "ACCEPTED");
+    
+    api_check_result(done && identical && pinned_ok && unsized_rejected &&
+                     callbacks == (int)count);
+    
+    kaos_pool_free(pool);
+    free(plaintext);
+    free(out);
+    free(reference);
+}
+
+/**
+ * Prepared keys and batched key setup: every initial state bit-identical
+ * to kaos_key_to_state (repeated, aliased-content and distinct keys),
+ * prepared encryption identical to kaos_encrypt_into
+ */
+void prepared_key_test() {
+    printf("[API] PREPARED KEY / BATCHED KEY SETUP TEST\n");
+    printf("-------------------------------------------\n");
+    
+    KaosCipher cipher;
+    kaos_init(&cipher);
+    
+    enum { PAIRS = 37, KEYS = 5 };
+    uint8_t keys[KEYS][KAOS_KEY_SIZE];
+    uint8_t nonces[PAIRS][KAOS_NONCE_SIZE];
+    const uint8_t* key_ptrs[PAIRS];
+    const uint8_t* nonce_ptrs[PAIRS];
+    KaosState batch[PAIRS];
+    
+    for (int k = 0; k < KEYS; k++) {
+        for (int i = 0; i < KAOS_KEY_SIZE; i++) keys[k][i] = (uint8_t)(k * 59 + i * 31 + 7);
+    }
+    memcpy(keys[4], keys[0], KAOS_KEY_SIZE);   /* Same bytes, different pointer */
+    
+    /* Runs of one key, then alternating keys */
+    for (int p = 0; p < PAIRS; p++) {
+        for (int i = 0; i < KAOS_NONCE_SIZE; i++) nonces[p][i] = (uint8_t)(p * 17 + i * 101);
+        key_ptrs[p] = keys[p < 12 ? 0 : p < 20 ? 1 : p % KEYS];
+        nonce_ptrs[p] = nonces[p];
+    }
+    
+    kaos_key_to_state_batch(key_ptrs, nonce_ptrs, PAIRS, batch);
+    
+    int batch_mismatches = 0, prepared_mismatches = 0;
+    for (int p = 0; p < PAIRS; p++) {
+        KaosState reference, prepared_state;
+        KaosPreparedKey prepared;
+        
+        kaos_key_to_state(key_ptrs[p], nonces[p], &reference.x, &reference.y, &reference.z);
+        kaos_prepare_key(&prepared, key_ptrs[p]);
+        kaos_key_to_state_prepared(&prepared, nonces[p], &prepared_state.x,
+                                   &prepared_state.y, &prepared_state.z);
+        kaos_prepared_key_wipe(&prepared);
+        
+        if (memcmp(&batch[p], &reference, sizeof(KaosState)) != 0) batch_mismatches++;
+        if (memcmp(&prepared_state, &reference, sizeof(KaosState)) != 0) prepared_mismatches++;
+    }
+    
+    /* Prepared one-shot against the raw-key API, then round trip */
+    uint8_t plaintext[1000], reference_ct[1000], out[1000];
+    for (size_t i = 0; i < sizeof(plaintext); i++) plaintext[i] = (uint8_t)(i * 5 + 3);
+    
+    KaosPreparedKey prepared;
+    kaos_prepare_key(&prepared, keys[2]);
+    int encrypt_ok = 1;
+    for (int p = 0; p < 4; p++) {
+        encrypt_ok = encrypt_ok &&
+            kaos_encrypt_into(&cipher, plaintext, reference_ct, sizeof(plaintext), keys[2], nonces[p]) &&
+            kaos_encrypt_prepared(&cipher, plaintext, out, sizeof(out), &prepared, nonces[p]) &&
+            memcmp(out, reference_ct, sizeof(out)) == 0 &&
+            kaos_decrypt_prepared(&cipher, out, out, sizeof(out), &prepared, nonces[p]) &&
+            memcmp(out, plaintext, sizeof(out)) == 0;
+    }
+    
+    /* Per-message key setup cost, one key and changing nonces */
+    const int rounds = 200000;
+    volatile double sink = 0.0;
+    KaosState s;
+    
+    KaosStats stats;
+    kaos_stats_reset();
+    for (int r = 0; r < rounds; r++) {
+        nonces[0][0] = (uint8_t)r;
+        kaos_key_to_state(keys[2], nonces[0], &s.x, &s.y, &s.z);
+        sink += s.x;
+    }
+    kaos_stats_thread_snapshot(&stats);
+    double raw_time = stats.phase[KAOS_PHASE_KEY_SETUP].seconds;
+    
+    kaos_stats_reset();
+    for (int r = 0; r < rounds; r++) {
+        nonces[0][0] = (uint8_t)r;
+        kaos_key_to_state_prepared(&prepared, nonces[0], &s.x, &s.y, &s.z);
+        sink += s.x;
+    }
+    kaos_stats_thread_snapshot(&stats);
+    double prepared_time = stats.phase[KAOS_PHASE_KEY_SETUP].seconds;
+    kaos_prepared_key_wipe(&prepared);
+    (void)sink;
+    
+    printf("Batch setup (%d pairs): %d mismatches\n", PAIRS, batch_mismatches);
+    printf("Prepared setup:         %d mismatches\n", prepared_mismatches);
+    printf("Prepared encryption:    %s\n", encrypt_ok ? "identical" : "MISMATCH");
+    if (stats.enabled) {
+        printf("Key setup per message:  %.1f ns raw key, %.1f ns prepared (key_setup phase)\n",
+               raw_time / rounds * 1e9, prepared_time / rounds * 1e9);
+    }
+    
+    api_check_result(batch_mismatches == 0 && prepared_mismatches == 0 && encrypt_ok);
+}
+
+/**
+ * Warmup pre-staging: staged, skipped and unreserved nonces all give
+ * kaos_encrypt_into output; counters account for every call, then
+ * small-message latency with and without pre-staged states
+ */
+void prestage_test() {
+    printf("[API] WARMUP PRE-STAGING TEST\n");
+    printf("-----------------------------\n");
+    
+    KaosCipher cipher;
+    kaos_init(&cipher);
+    
+    enum { STAGED = 16, MSG = 64, LATENCY_ROUNDS = 2000 };
+    uint8_t key[KAOS_KEY_SIZE];
+    uint8_t nonce[KAOS_NONCE_SIZE];
+    uint8_t plaintext[MSG], reference[MSG], out[MSG];
+    for (int i = 0; i < KAOS_KEY_SIZE; i++) key[i] = (uint8_t)(i * 19 + 4);
+    for (int i = 0; i < MSG; i++) plaintext[i] = (uint8_t)(i * 3);
+    memset(nonce, 0, KAOS_NONCE_SIZE);
+    
+    KaosPrestager* prestager = kaos_prestager_new(&cipher, key, STAGED, 2);
+    if (!prestager) {
+        printf("Error: Pre-stager creation failed\n");
+        api_check_result(0);
+        return;
+    }
+    
+    /* Counter nonces 0..STAGED-1; the queue refuses one more */
+    int reserve_ok = 1;
+    for (int n = 0; n < STAGED; n++) {
+        nonce[0] = (uint8_t)n;
+        reserve_ok = reserve_ok && kaos_prestager_reserve(prestager, nonce);
+    }
+    nonce[0] = STAGED;
+    int full_ok = !kaos_prestager_reserve(prestager, nonce);
+    
+    KaosPrestageStats stats;
+    for (int spins = 0; spins < 10000; spins++) {
+        kaos_prestager_stats(prestager, &stats);
+        if (stats.depth == STAGED) break;
+        usleep(100);
+    }
+    int staged_ok = stats.depth == STAGED;
+    
+    /* Nonce 0..5 in order, skip 6 and 7, then 8..15, then one never reserved */
+    int mismatches = 0;
+    for (int n = 0; n <= STAGED; n++) {
+        if (n == 6 || n == 7) continue;
+        nonce[0] = (uint8_t)n;
+        kaos_encrypt_into(&cipher, plaintext, reference, MSG, key, nonce);
+        if (!kaos_encrypt_prestaged(prestager, plaintext, out, MSG, nonce) ||
+            memcmp(out, reference, MSG) != 0) {
+            mismatches++;
+        }
+    }
+    
+    kaos_prestager_stats(prestager, &stats);
+    KaosPrestageStats checked = stats;
+    int counters_ok = stats.hits == STAGED - 2 && stats.discarded == 2 &&
+                      stats.unreserved == 1 && stats.reserved == 0 && stats.depth == 0;
+    
+    /* Latency: every call reserves its successor, as a send path would */
+    struct timespec t0, t1;
+    uint64_t counter = 1000;
+    memset(nonce, 0, KAOS_NONCE_SIZE);
+    
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int r = 0; r < LATENCY_ROUNDS; r++) {
+        memcpy(nonce, &counter, sizeof(counter));
+        counter++;
+        kaos_encrypt_into(&cipher, plaintext, out, MSG, key, nonce);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double direct_us = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / 1e3 / LATENCY_ROUNDS;
+    
+    for (int n = 0; n < STAGED - 1; n++) {
+        uint64_t ahead = counter + n;
+        memcpy(nonce, &ahead, sizeof(ahead));
+        kaos_prestager_reserve(prestager, nonce);
+    }
+    
+    KaosPrestageStats before;
+    kaos_prestager_stats(prestager, &before);
+    double prestaged_us = 0.0;
+    for (int r = 0; r < LATENCY_ROUNDS; r++) {
+        uint64_t ahead = counter + STAGED - 1;
+        memcpy(nonce, &ahead, sizeof(ahead));
+        kaos_prestager_reserve(prestager, nonce);
+        
+        /* Send path idles between messages long enough to keep up */
+        usleep(50);
+        
+        memcpy(nonce, &counter, sizeof(counter));
+        counter++;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        kaos_encrypt_prestaged(prestager, plaintext, out, MSG, nonce);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        prestaged_us += ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / 1e3;
+    }
+    prestaged_us /= LATENCY_ROUNDS;
+    kaos_prestager_stats(prestager, &stats);
+    
+    printf("Reserve/full queue:     %s / %s\n", reserve_ok ? "ok" : "FAILED",
+           full_ok ? "refused" : "ACCEPTED");
+    printf("Staged in background:   %s\n", staged_ok ? "all ready" : "TIMEOUT");
+    printf("Output vs encrypt_into: %d mismatches\n", mismatches);
+    printf("Counters:               %s (hits %llu, discarded %llu, unreserved %llu)\n",
+           counters_ok ? "consistent" : "INCONSISTENT",
+           (unsigned long long)checked.hits, (unsigned long long)checked.discarded,
+           (unsigned long long)checked.unreserved);
+    printf("64-byte latency:        %.2f us direct, %.2f us pre-staged\n",
+           direct_us, prestaged_us);
+    printf("Timed run:              %llu hits, %llu waits, %llu starved, depth %zu/%zu\n",
+           (unsigned long long)(stats.hits - before.hits),
+           (unsigned long long)(stats.waits - before.waits),
+           (unsigned long long)(stats.starved - before.starved),
+           stats.depth, stats.capacity);
+    
+    api_check_result(reserve_ok && full_ok && staged_ok && mismatches == 0 && counters_ok);
+    
+    kaos_prestager_free(prestager);
+}
+
+/**
+ * Keystream prefetcher: both wait policies, smallest and large ring,
+ * irregular update sizes - identical to kaos_encrypt_into; then consumer
+ * throughput against kaos_stream_update
+ */
+void prefetch_test() {
+    printf("[API] KEYSTREAM PREFETCHER TEST\n");
+    printf("-------------------------------\n");
+    
+    KaosCipher cipher;
+    kaos_init(&cipher);
+    
+    uint8_t key[KAOS_KEY_SIZE];
+    uint8_t nonce[KAOS_NONCE_SIZE];
+    memset(key, 0x6B, KAOS_KEY_SIZE);
+    memset(nonce, 0x2D, KAOS_NONCE_SIZE);
+    
+    uint8_t* plaintext = (uint8_t*)malloc(PREFETCH_TEST_SIZE);
+    uint8_t* reference = (uint8_t*)malloc(PREFETCH_TEST_SIZE);
+    uint8_t* out = (uint8_t*)malloc(PREFETCH_TEST_SIZE);
+    if (!plaintext || !reference || !out) {
+        printf("Error: Memory allocation failed\n");
+        free(plaintext);
+        free(reference);
+        free(out);
+        api_check_result(0);
+        return;
+    }
+    
+    for (size_t i = 0; i < PREFETCH_TEST_SIZE; i++) {
+        plaintext[i] = (uint8_t)(i * 29 + 11);
+    }
+    kaos_encrypt_into(&cipher, plaintext, reference, PREFETCH_TEST_SIZE, key, nonce);
+    
+    const size_t updates[] = { 1, 63, 4096, 4097, 65536, 300001 };
+    const size_t update_count = sizeof(updates) / sizeof(updates[0]);
+    const size_t rings[] = { 0, 1u << 20 };
+    const KaosWaitPolicy policies[] = { KAOS_WAIT_SPIN, KAOS_WAIT_BLOCK };
+    int all_ok = 1;
+    
+    for (int pi = 0; pi < 2; pi++) {
+        for (int ri = 0; ri < 2; ri++) {
+            KaosPrefetcher* prefetcher = kaos_prefetcher_new(&cipher, key, nonce,
+                                                             rings[ri], policies[pi]);
+            if (!prefetcher) {
+                printf("Error: Prefetcher creation failed\n");
+                all_ok = 0;
+                continue;
+            }
+            
+            struct timespec t0, t1;
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            size_t offset = 0;
+            for (size_t u = 0; offset < PREFETCH_TEST_SIZE; u++) {
+                size_t n = updates[u % update_count];
+                if (n > PREFETCH_TEST_SIZE - offset) n = PREFETCH_TEST_SIZE - offset;
+                kaos_prefetcher_xor(prefetcher, plaintext + offset, out + offset, n);
+                offset += n;
+            }
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            double seconds = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+            
+            int match = kaos_prefetcher_position(prefetcher) == PREFETCH_TEST_SIZE &&
+                        memcmp(out, reference, PREFETCH_TEST_SIZE) == 0;
+            printf("%-5s ring %7zu: %s, %.2f MB/s\n",
+                   policies[pi] == KAOS_WAIT_SPIN ? "spin" : "block",
+                   rings[ri] ? rings[ri] : (size_t)4096,
+                   match ? "identical" : "MISMATCH",
+                   PREFETCH_TEST_SIZE / (1024.0 * 1024.0) / seconds);
+            all_ok = all_ok && match;
+            
+            kaos_prefetcher_free(prefetcher);
+        }
+    }
+    
+    /* Same updates on the calling thread */
+    KaosStream* stream = kaos_stream_init(&cipher, key, nonce);
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    size_t offset = 0;
+    for (size_t u = 0; stream && offset < PREFETCH_TEST_SIZE; u++) {
+        size_t n = updates[u % update_count];
+        if (n > PREFETCH_TEST_SIZE - offset) n = PREFETCH_TEST_SIZE - offset;
+        kaos_stream_update(stream, plaintext + offset, out + offset, n);
+        offset += n;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    kaos_stream_final(stream);
+    double seconds = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    printf("kaos_stream_update:  %.2f MB/s (online CPUs: %d)\n",
+           PREFETCH_TEST_SIZE / (1024.0 * 1024.0) / seconds, (int)sysconf(_SC_NPROCESSORS_ONLN));
+    
+    api_check_result(all_ok);
+    
+    free(plaintext);
+    free(reference);
+    free(out);
+}
+
+/* Time stamp counter, or nanoseconds where there is none */
+static uint64_t test_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec;
+#endif
+}
+
+/**
+ * Generate-then-XOR pipeline: keystream tiles from kaos_stream_keystream
+ * applied with kaos_xor_bytes (misaligned output) equal kaos_encrypt_into;
+ * cycles/byte for each phase and for the one-call path
+ */
+void tiled_pipeline_test() {
+    printf("[API] GENERATE-THEN-XOR PIPELINE TEST\n");
+    printf("-------------------------------------\n");
+    
+    KaosCipher cipher;
+    kaos_init(&cipher);
+    
+    uint8_t key[KAOS_KEY_SIZE];
+    uint8_t nonce[KAOS_NONCE_SIZE];
+    memset(key, 0x17, KAOS_KEY_SIZE);
+    memset(nonce, 0xE1, KAOS_NONCE_SIZE);
+    
+    size_t length = PREFETCH_TEST_SIZE;
+    uint8_t* plaintext = (uint8_t*)malloc(length);
+    uint8_t* reference = (uint8_t*)malloc(length);
+    uint8_t* buffer = (uint8_t*)malloc(length + 3);
+    uint8_t* tile = (uint8_t*)aligned_alloc(64, TILE_TEST_SIZE);
+    KaosStream* stream = kaos_stream_init(&cipher, key, nonce);
+    if (!plaintext || !reference || !buffer || !tile || !stream) {
+        printf("Error: Memory allocation failed\n");
+        free(plaintext);
+        free(reference);
+        free(buffer);
+        free(tile);
+        kaos_stream_final(stream);
+        api_check_result(0);
+        return;
+    }
+    
+    for (size_t i = 0; i < length; i++) {
+        plaintext[i] = (uint8_t)(i * 23 + 9);
+    }
+    
+    uint64_t start = test_cycles();
+    kaos_encrypt_into(&cipher, plaintext, reference, length, key, nonce);
+    uint64_t one_call = test_cycles() - start;
+    
+    /* Output 3 bytes off alignment: exercises the XOR head and tail */
+    uint8_t* out = buffer + 3;
+    uint64_t generate = 0, apply = 0;
+    for (size_t offset = 0; offset < length; offset += TILE_TEST_SIZE) {
+        size_t n = length - offset < TILE_TEST_SIZE ? length - offset : TILE_TEST_SIZE;
+        
+        start = test_cycles();
+        kaos_stream_keystream(stream, tile, n);
+        uint64_t mid = test_cycles();
+        kaos_xor_bytes(plaintext + offset, tile, out + offset, n);
+        uint64_t end = test_cycles();
+        
+        generate += mid - start;
+        apply += end - mid;
+    }
+    int match = kaos_stream_position(stream) == length &&
+                memcmp(out, reference, length) == 0;
+    
+    printf("Pipeline vs encrypt_into: %s (kernel %s)\n", match ? "identical" : "MISMATCH",
+           kaos_kernel_name(kaos_get_kernel()));
+    printf("Generate phase:   %7.3f cycles/byte\n", (double)generate / length);
+    printf("XOR phase:        %7.3f cycles/byte\n", (double)apply / length);
+    printf("kaos_encrypt_into %7.3f cycles/byte (incl. warmup)\n", (double)one_call / length);
+    
+    api_check_result(match);
+    
+    kaos_stream_final(stream);
+    free(plaintext);
+    free(reference);
+    free(buffer);
+    free(tile);
+}
+
+/**
+ * Phase statistics: one encryption is accounted exactly, a prefetcher's
+ * producer thread is still counted after it exits, and both renderings work
+ */
+void stats_test() {
+    printf("[API] PHASE STATISTICS TEST\n");
+    printf("---------------------------\n");
+    
+    KaosStats stats;
+    kaos_stats_snapshot(&stats);
+    if (!stats.enabled) {
+        printf("Phase statistics compiled out (build with -DKAOS_STATS)\n");
+        api_check_result(1);
+        return;
+    }
+    
+    KaosCipher cipher;
+    kaos_init(&cipher);
+    
+    uint8_t key[KAOS_KEY_SIZE];
+    uint8_t nonce[KAOS_NONCE_SIZE];
+    memset(key, 0x5A, KAOS_KEY_SIZE);
+    memset(nonce, 0x0F, KAOS_NONCE_SIZE);
+    
+    size_t length = API_TEST_SIZE;
+    uint8_t* buffer = (uint8_t*)calloc(length, 1);
+    if (!buffer) {
+        printf("Error: Memory allocation failed\n");
+        api_check_result(0);
+        return;
+    }
+    
+    kaos_stats_reset();
+    kaos_encrypt_into(&cipher, buffer, buffer, length, key, nonce);
+    kaos_stats_snapshot(&stats);
+    
+    KaosPhaseStats* p = stats.phase;
+    int exact = p[KAOS_PHASE_KEY_SETUP].calls == 1 && p[KAOS_PHASE_WARMUP].calls == 1 &&
+                p[KAOS_PHASE_KEYSTREAM].bytes == length && p[KAOS_PHASE_XOR].bytes == length &&
+                p[KAOS_PHASE_KEYSTREAM].ticks > 0 && p[KAOS_PHASE_XOR].ticks > 0;
+    printf("One encrypt_into: %llu key setups, %llu warmups, %llu keystream / %llu XOR bytes\n",
+           (unsigned long long)p[KAOS_PHASE_KEY_SETUP].calls,
+           (unsigned long long)p[KAOS_PHASE_WARMUP].calls,
+           (unsigned long long)p[KAOS_PHASE_KEYSTREAM].bytes,
+           (unsigned long long)p[KAOS_PHASE_XOR].bytes);
+    
+    /* Producer thread: its keystream is generated on another thread */
+    kaos_stats_reset();
+    KaosPrefetcher* pf = kaos_prefetcher_new(&cipher, key, nonce, 0, KAOS_WAIT_BLOCK);
+    int retired = pf && kaos_prefetcher_xor(pf, buffer, buffer, length);
+    KaosStats mine;
+    kaos_stats_thread_snapshot(&mine);
+    kaos_prefetcher_free(pf);
+    kaos_stats_snapshot(&stats);
+    retired = retired && mine.phase[KAOS_PHASE_KEYSTREAM].bytes == 0 &&
+              stats.phase[KAOS_PHASE_KEYSTREAM].bytes >= length &&
+              stats.phase[KAOS_PHASE_WARMUP].calls == 1 &&
+              stats.phase[KAOS_PHASE_XOR].bytes == length;
+    printf("Prefetcher: %llu keystream bytes counted after its thread exited, "
+           "0 on this thread: %s\n",
+           (unsigned long long)stats.phase[KAOS_PHASE_KEYSTREAM].bytes, retired ? "yes" : "NO");
+    
+    char text[1024], json[1024];
+    size_t text_len = kaos_stats_format(&stats, KAOS_STATS_TEXT, text, sizeof(text));
+    size_t json_len = kaos_stats_format(&stats, KAOS_STATS_JSON, json, sizeof(json));
+    int formatted = text_len > 0 && text_len < sizeof(text) && json_len < sizeof(json) &&
+                    kaos_stats_format(&stats, KAOS_STATS_JSON, NULL, 0) == json_len &&
+                    json[0] == '{' && strstr(json, "\"keystream\":{\"calls\":") != NULL;
+    printf("%s%s", text, json);
+    
+    api_check_result(exact && retired && formatted);
+    free(buffer);
+}
+
+/* Splits length bytes at base into segments cycling through sizes[];
+ * gap bytes are skipped after each segment (scattered output) */
+static int build_iov_chain(struct iovec* iov, uint8_t* base, size_t length,
+                           const size_t* sizes, size_t count, size_t gap) {
+    int n = 0;
+    size_t offset = 0;
+    for (size_t k = 0; offset < length; k++) {
+        size_t len = sizes[k % count];
+        if (len > length - offset) len = length - offset;
+        iov[n].iov_base = base;
+        iov[n].iov_len = len;
+        base += len + gap;
+        offset += len;
+        n++;
+    }
+    return n;
+}
+
+void iovec_test() {
+    printf("[API] SCATTER-GATHER (IOVEC) TEST\n");
+    printf("---------------------------------\n");
+    
+    KaosCipher cipher;
+    kaos_init(&cipher);
+    
+    uint8_t key[KAOS_KEY_SIZE];
+    uint8_t nonce[KAOS_NONCE_SIZE];
+    memset(key, 0x3C, KAOS_KEY_SIZE);
+    memset(nonce, 0xA5, KAOS_NONCE_SIZE);
+    
+    size_t length = API_TEST_SIZE;
+    uint8_t* plaintext = (uint8_t*)malloc(length);
+    uint8_t* reference = (uint8_t*)malloc(length);
+    uint8_t* scattered = (uint8_t*)malloc(2 * length);
+    uint8_t* inplace = (uint8_t*)malloc(length);
+    struct iovec* in_iov = (struct iovec*)malloc(length * sizeof(struct iovec));
+    struct iovec* out_iov = (struct iovec*)malloc(length * sizeof(struct iovec));
+    KaosStream* stream = kaos_stream_init(&cipher, key, nonce);
+    KaosStream* second = kaos_stream_init(&cipher, key, nonce);
+    if (!plaintext || !reference || !scattered || !inplace || !in_iov || !out_iov ||
+        !stream || !second) {
+        printf("Error: Memory allocation failed\n");
+        free(plaintext);
+        free(reference);
+        free(scattered);
+        free(inplace);
+        free(in_iov);
+        free(out_iov);
+        kaos_stream_final(stream);
+        kaos_stream_final(second);
+        api_check_result(0);
+        return;
+    }
+    
+    for (size_t i = 0; i < length; i++) {
+        plaintext[i] = (uint8_t)(i * 29 + 3);
+    }
+    kaos_encrypt_into(&cipher, plaintext, reference, length, key, nonce);
+    
+    /* Input: IOV_SINGLE_BYTES 1-byte fragments, then mixed sizes and empty
+     * segments; output split differently and scattered with 1-byte gaps */
+    static const size_t one[] = {1};
+    static const size_t in_sizes[] = {1, 0, 3, 1, 1, 255, 4096, 17, 0, 8197};
+    static const size_t out_sizes[] = {64, 1, 1, 9000, 2, 0, 513, 1};
+    int n_in = build_iov_chain(in_iov, plaintext, IOV_SINGLE_BYTES, one, 1, 0);
+    n_in += build_iov_chain(in_iov + n_in, plaintext + IOV_SINGLE_BYTES,
+                            length - IOV_SINGLE_BYTES, in_sizes, 10, 0);
+    int n_out = build_iov_chain(out_iov, scattered, length, out_sizes, 8, 1);
+    
+    int accepted = kaos_encryptv(stream, in_iov, n_in, out_iov, n_out);
+    
+    int gathered = 1;
+    size_t offset = 0;
+    for (int k = 0; k < n_out; k++) {
+        gathered = gathered && memcmp(out_iov[k].iov_base, reference + offset,
+                                      out_iov[k].iov_len) == 0;
+        offset += out_iov[k].iov_len;
+    }
+    int scatter_match = accepted && gathered && kaos_stream_position(stream) == length;
+    int scatter_in = n_in;
+    
+    /* In place, the chain cut in two calls at an odd fragment */
+    memcpy(inplace, plaintext, length);
+    n_in = build_iov_chain(in_iov, inplace, length, in_sizes, 10, 0);
+    int half = n_in / 2 + 1;
+    accepted = kaos_encryptv(second, in_iov, half, in_iov, half) &&
+               kaos_encryptv(second, in_iov + half, n_in - half, in_iov + half, n_in - half);
+    int inplace_match = accepted && memcmp(inplace, reference, length) == 0;
+    
+    /* Output chain shorter than the input is rejected before any write */
+    uint64_t position = kaos_stream_position(second);
+    int rejected = !kaos_encryptv(second, in_iov, n_in, in_iov, n_in - 1) &&
+                   kaos_stream_position(second) == position;
+    
+    printf("Scattered (%d in / %d out segments, %d single bytes): %s\n",
+           scatter_in, n_out, IOV_SINGLE_BYTES, scatter_match ? "identical" : "MISMATCH");
+    printf("In place across two calls: %s\n", inplace_match ? "identical" : "MISMATCH");
+    printf("Short output chain rejected: %s\n", rejected ? "yes" : "NO");
+    api_check_result(scatter_match && inplace_match && rejected);
+    
+    kaos_stream_final(stream);
+    kaos_stream_final(second);
+    free(plaintext);
+    free(reference);
+    free(scattered);
+    free(inplace);
+    free(in_iov);
+    free(out_iov);
+}
+
+/* Whole file into buf (at most capacity bytes); returns bytes read or -1 */
+static long test_read_file(const char* path, uint8_t* buf, size_t capacity) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return -1;
+    size_t n = fread(buf, 1, capacity, file);
+    fclose(file);
+    return (long)n;
+}
+
+static int test_write_file(const char* path, const uint8_t* data, size_t length) {
+    FILE* file = fopen(path, "wb");
+    if (!file) return 0;
+    int ok = fwrite(data, 1, length, file) == length;
+    return fclose(file) == 0 && ok;
+}
+
+void file_mmap_test() {
+    printf("[API] MEMORY-MAPPED FILE TEST\n");
+    printf("-----------------------------\n");
+    
+    KaosCipher cipher;
+    kaos_init(&cipher);
+    
+    uint8_t key[KAOS_KEY_SIZE];
+    uint8_t nonce[KAOS_NONCE_SIZE];
+    memset(key, 0x6D, KAOS_KEY_SIZE);
+    memset(nonce, 0x1F, KAOS_NONCE_SIZE);
+    
+    char plain_path[] = "/tmp/kaos_file_test_XXXXXX";
+    char cipher_path[] = "/tmp/kaos_file_test_XXXXXX";
+    int plain_fd = mkstemp(plain_path);
+    int cipher_fd = mkstemp(cipher_path);
+    
+    size_t length = API_TEST_SIZE;
+    uint8_t* plaintext = (uint8_t*)malloc(length);
+    uint8_t* reference = (uint8_t*)malloc(length);
+    uint8_t* result = (uint8_t*)malloc(length + 1);
+    if (plain_fd < 0 || cipher_fd < 0 || !plaintext || !reference || !result) {
+        printf("Error: Temporary files or memory unavailable\n");
+        if (plain_fd >= 0) { close(plain_fd); unlink(plain_path); }
+        if (cipher_fd >= 0) { close(cipher_fd); unlink(cipher_path); }
+        free(plaintext);
+        free(reference);
+        free(result);
+        api_check_result(0);
+        return;
+    }
+    close(plain_fd);
+    close(cipher_fd);
+    
+    for (size_t i = 0; i < length; i++) {
+        plaintext[i] = (uint8_t)(i * 37 + 11);
+    }
+    kaos_encrypt_into(&cipher, plaintext, reference, length, key, nonce);
+    
+    /* Out of place across many windows (length is not a window multiple) */
+    int written = test_write_file(plain_path, plaintext, length);
+    int mapped = written &&
+                 kaos_encrypt_file(&cipher, plain_path, cipher_path, key, nonce, FILE_TEST_WINDOW);
+    int mapped_match = mapped && test_read_file(cipher_path, result, length + 1) == (long)length &&
+                       memcmp(result, reference, length) == 0;
+    
+    /* In place, default window: decrypting the ciphertext file restores it */
+    int restored = kaos_decrypt_file_inplace(&cipher, cipher_path, key, nonce, 0) &&
+                   test_read_file(cipher_path, result, length + 1) == (long)length &&
+                   memcmp(result, plaintext, length) == 0;
+    int inplace_match = restored &&
+                        kaos_encrypt_file_inplace(&cipher, plain_path, key, nonce, 1) &&
+                        test_read_file(plain_path, result, length + 1) == (long)length &&
+                        memcmp(result, reference, length) == 0;
+    
+    /* Empty input gives an empty output; input as its own output is refused */
+    int empty = test_write_file(plain_path, plaintext, 0) &&
+                kaos_encrypt_file(&cipher, plain_path, cipher_path, key, nonce, 0) &&
+                test_read_file(cipher_path, result, length + 1) == 0;
+    int same_refused = test_write_file(plain_path, plaintext, length) &&
+                       !kaos_encrypt_file(&cipher, plain_path, plain_path, key, nonce, 0) &&
+                       test_read_file(plain_path, result, length + 1) == (long)length;
+    
+    printf("Mapped (%d-byte windows): %s\n", FILE_TEST_WINDOW,
+           mapped_match ? "identical to kaos_encrypt" : "MISMATCH");
+    printf("In place (decrypt back, encrypt again): %s\n", inplace_match ? "identical" : "MISMATCH");
+    printf("Empty file: %s\n", empty ? "ok" : "FAILED");
+    printf("Input as output refused: %s\n", same_refused ? "yes" : "NO");
+    api_check_result(mapped_match && inplace_match && empty && same_refused);
+    
+    unlink(plain_path);
+    unlink(cipher_path);
+    free(plaintext);
+    free(reference);
+    free(result);
+}
+
+/* One pipeline run from in_path (or a pipe fed by a child) into out_path */
+static int run_pipeline_case(KaosCipher* cipher, const char* in_path, const char* out_path,
+                             const uint8_t* data, size_t length, int use_pipe,
+                             KaosIoBackend backend, const uint8_t* key, const uint8_t* nonce,
+                             KaosPipelineStats* stats) {
+    KaosPipelineOptions options = { PIPE_TEST_CHUNK, 3, backend };
+    int fds[2] = { -1, -1 };
+    pid_t child = -1;
+    int in_fd;
+    if (use_pipe) {
+        if (pipe(fds) != 0) return 0;
+        child = fork();
+        if (child == 0) {
+            close(fds[0]);
+            for (size_t offset = 0; offset < length; offset += PIPE_TEST_WRITE) {
+                size_t n = length - offset < PIPE_TEST_WRITE ? length - offset : PIPE_TEST_WRITE;
+                if (write(fds[1], data + offset, n) != (ssize_t)n) _exit(1);
+            }
+            _exit(0);
+        }
+        close(fds[1]);
+        in_fd = fds[0];
+    } else {
+        in_fd = open(in_path, O_RDONLY);
+    }
+    int out_fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    
+    int ok = in_fd >= 0 && out_fd >= 0 && (!use_pipe || child > 0) &&
+             kaos_encrypt_fd(cipher, in_fd, out_fd, key, nonce, &options, stats) &&
+             lseek(out_fd, 0, SEEK_CUR) == (off_t)length;
+    
+    if (in_fd >= 0) close(in_fd);
+    if (out_fd >= 0) close(out_fd);
+    if (child > 0) {
+        int status;
+        waitpid(child, &status, 0);
+        ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    return ok;
+}
+
+void pipeline_test() {
+    printf("[API] DESCRIPTOR PIPELINE TEST\n");
+    printf("------------------------------\n");
+    
+    KaosCipher cipher;
+    kaos_init(&cipher);
+    
+    uint8_t key[KAOS_KEY_SIZE];
+    uint8_t nonce[KAOS_NONCE_SIZE];
+    memset(key, 0x52, KAOS_KEY_SIZE);
+    memset(nonce, 0xC7, KAOS_NONCE_SIZE);
+    
+    char in_path[] = "/tmp/kaos_pipe_test_XXXXXX";
+    char out_path[] = "/tmp/kaos_pipe_test_XXXXXX";
+    int in_fd = mkstemp(in_path);
+    int out_fd = mkstemp(out_path);
+    
+    size_t length = API_TEST_SIZE;
+    uint8_t* plaintext = (uint8_t*)malloc(length);
+    uint8_t* reference = (uint8_t*)malloc(length);
+    uint8_t* result = (uint8_t*)malloc(length + 1);
+    if (in_fd < 0 || out_fd < 0 || !plaintext || !reference || !result) {
+        printf("Error: Temporary files or memory unavailable\n");
+        if (in_fd >= 0) { close(in_fd); unlink(in_path); }
+        if (out_fd >= 0) { close(out_fd); unlink(out_path); }
+        free(plaintext);
+        free(reference);
+        free(result);
+        api_check_result(0);
+        return;
+    }
+    close(in_fd);
+    close(out_fd);
+    
+    for (size_t i = 0; i < length; i++) {
+        plaintext[i] = (uint8_t)(i * 53 + 9);
+    }
+    kaos_encrypt_into(&cipher, plaintext, reference, length, key, nonce);
+    int written = test_write_file(in_path, plaintext, length);
+    
+    /* Regular file and pipe input, each backend; output must equal kaos_encrypt */
+    static const KaosIoBackend backends[] = { KAOS_IO_AUTO, KAOS_IO_THREADS };
+    int all_match = written;
+    for (int b = 0; b < 2; b++) {
+        for (int use_pipe = 0; use_pipe < 2; use_pipe++) {
+            KaosPipelineStats stats;
+            int ran = run_pipeline_case(&cipher, in_path, out_path, plaintext, length, use_pipe,
+                                        backends[b], key, nonce, &stats);
+            int match = ran && test_read_file(out_path, result, length + 1) == (long)length &&
+                        memcmp(result, reference, length) == 0 && stats.bytes == length;
+            printf("%-8s input, %-8s backend: %s (%llu chunks, %llu stalls%s%s)\n",
+                   use_pipe ? "Pipe" : "File", kaos_io_backend_name(stats.backend),
+                   match ? "identical" : "MISMATCH", (unsigned long long)stats.chunks,
+                   (unsigned long long)stats.stalls,
+                   stats.registered_buffers ? ", registered buffers" : "",
+                   stats.fixed_files ? ", fixed files" : "");
+            all_match = all_match && match;
+        }
+    }
+    
+    /* Empty input: nothing written, still a success */
+    KaosPipelineStats stats;
+    int empty = test_write_file(in_path, plaintext, 0) &&
+                run_pipeline_case(&cipher, in_path, out_path, plaintext, 0, 0,
+                                  KAOS_IO_AUTO, key, nonce, &stats) &&
+                test_read_file(out_path, result, length + 1) == 0;
+    printf("Empty input: %s\n", empty ? "ok" : "FAILED");
+    api_check_result(all_match && empty);
+    
+    unlink(in_path);
+    unlink(out_path);
+    free(plaintext);
+    free(reference);
+    free(result);
+}
+
+/* Container of in_path written to out_path */
+static int run_container_case(KaosCipher* cipher, const char* in_path, const char* out_path,
+                              const uint8_t* key, const uint8_t* nonce) {
+    int in_fd = open(in_path, O_RDONLY);
+    int out_fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    int ok = in_fd >= 0 && out_fd >= 0 &&
+             kaos_container_encrypt_fd(cipher, in_fd, out_fd, key, nonce, CONTAINER_TEST_CHUNK);
+    if (in_fd >= 0) close(in_fd);
+    if (out_fd >= 0 && close(out_fd) != 0) ok = 0;
+    return ok;
+}
+
+void container_test() {
+    printf("[API] INDEXED CONTAINER TEST\n");
+    printf("----------------------------\n");
+    
+    KaosCipher cipher;
+    kaos_init(&cipher);
+    
+    uint8_t key[KAOS_KEY_SIZE];
+    uint8_t wrong_key[KAOS_KEY_SIZE];
+    uint8_t nonce[KAOS_NONCE_SIZE];
+    memset(key, 0x3A, KAOS_KEY_SIZE);
+    memset(wrong_key, 0x3A, KAOS_KEY_SIZE);
+    wrong_key[KAOS_KEY_SIZE - 1] ^= 1;
+    memset(nonce, 0x95, KAOS_NONCE_SIZE);
+    
+    char in_path[] = "/tmp/kaos_container_test_XXXXXX";
+    char out_path[] = "/tmp/kaos_container_test_XXXXXX";
+    int in_fd = mkstemp(in_path);
+    int out_fd = mkstemp(out_path);
+    
+    size_t length = API_TEST_SIZE;
+    size_t capacity = length + KAOS_CONTAINER_HEADER_SIZE + 4096;
+    uint8_t* plaintext = (uint8_t*)malloc(length);
+    uint8_t* reference = (uint8_t*)malloc(length);
+    uint8_t* container = (uint8_t*)malloc(capacity);
+    uint8_t* result = (uint8_t*)malloc(length);
+    if (in_fd < 0 || out_fd < 0 || !plaintext || !reference || !container || !result) {
+        printf("Error: Temporary files or memory unavailable\n");
+        if (in_fd >= 0) { close(in_fd); unlink(in_path); }
+        if (out_fd >= 0) { close(out_fd); unlink(out_path); }
+        free(plaintext);
+        free(reference);
+        free(container);
+        free(result);
+        api_check_result(0);
+        return;
+    }
+    close(in_fd);
+    close(out_fd);
+    
+    for (size_t i = 0; i < length; i++) {
+        plaintext[i] = (uint8_t)(i * 29 + 5);
+    }
+    kaos_encrypt_into(&cipher, plaintext, reference, length, key, nonce);
+    
+    /* Ciphertext section is exactly kaos_encrypt; header names the format */
+    long size = -1;
+    int written = test_write_file(in_path, plaintext, length) &&
+                  run_container_case(&cipher, in_path, out_path, key, nonce);
+    if (written) {
+        size = test_read_file(out_path, container, capacity);
+    }
+    int layout = size > (long)(KAOS_CONTAINER_HEADER_SIZE + length) &&
+                 memcmp(container, "KAOS", 4) == 0 &&
+                 container[4] == KAOS_CONTAINER_VERSION &&
+                 container[5] == KAOS_CONTAINER_MODE_INDEXED &&
+                 memcmp(container + 20, nonce, KAOS_NONCE_SIZE) == 0 &&
+                 memcmp(container + KAOS_CONTAINER_HEADER_SIZE, reference, length) == 0;
+    
+    /* Ranges out of order: chunk boundaries, straddles, backwards, the tail */
+    static const size_t ranges[][2] = {
+        { 50000, 1000 }, { 0, 1 }, { 4095, 2 }, { 8192, 4096 },
+        { 99000, 1003 }, { 4096, 0 }, { 12345, 30000 }, { 100002, 1 }
+    };
+    int fd = open(out_path, O_RDONLY);
+    KaosContainer* reader = fd >= 0 ? kaos_container_open(&cipher, fd, key) : NULL;
+    int ranges_match = reader && kaos_container_length(reader) == length;
+    for (size_t r = 0; ranges_match && r < sizeof(ranges) / sizeof(ranges[0]); r++) {
+        ranges_match = kaos_container_pread(reader, ranges[r][0], ranges[r][1], result) &&
+                       memcmp(result, plaintext + ranges[r][0], ranges[r][1]) == 0;
+    }
+    int whole = reader && kaos_container_pread(reader, 0, length, result) &&
+                memcmp(result, plaintext, length) == 0;
+    int past_end = reader && !kaos_container_pread(reader, length - 10, 11, result) &&
+                   !kaos_container_pread(reader, length + 1, 0, result);
+    kaos_container_free(reader);
+    
+    /* Wrong key and a truncated file fail at open */
+    KaosContainer* wrong = fd >= 0 ? kaos_container_open(&cipher, fd, wrong_key) : NULL;
+    int wrong_refused = fd >= 0 && wrong == NULL;
+    kaos_container_free(wrong);
+    if (fd >= 0) close(fd);
+    
+    int truncated_refused = 0;
+    if (size > 0 && test_write_file(out_path, container, (size_t)size - 1)) {
+        fd = open(out_path, O_RDONLY);
+        KaosContainer* truncated = fd >= 0 ? kaos_container_open(&cipher, fd, key) : NULL;
+        truncated_refused = fd >= 0 && truncated == NULL;
+        kaos_container_free(truncated);
+        if (fd >= 0) close(fd);
+    }
+    
+    /* Empty input: a valid container of length 0 */
+    int empty = 0;
+    if (test_write_file(in_path, plaintext, 0) &&
+        run_container_case(&cipher, in_path, out_path, key, nonce)) {
+        fd = open(out_path, O_RDONLY);
+        KaosContainer* nothing = fd >= 0 ? kaos_container_open(&cipher, fd, key) : NULL;
+        empty = nothing && kaos_container_length(nothing) == 0 &&
+                kaos_container_pread(nothing, 0, 0, result);
+        kaos_container_free(nothing);
+        if (fd >= 0) close(fd);
+    }
+    
+    printf("Layout (header, ciphertext = kaos_encrypt): %s\n", layout ? "ok" : "MISMATCH");
+    printf("Range reads (%d-byte chunks, out of order): %s\n", CONTAINER_TEST_CHUNK,
+           ranges_match ? "identical" : "MISMATCH");
+    printf("Whole file through one read: %s\n", whole ? "identical" : "MISMATCH");
+    printf("Range past the end refused: %s\n", past_end ? "yes" : "NO");
+    printf("Wrong key refused: %s\n", wrong_refused ? "yes" : "NO");
+    printf("Truncated container refused: %s\n", truncated_refused ? "yes" : "NO");
+    printf("Empty input: %s\n", empty ? "ok" : "FAILED");
+    api_check_result(written && layout && ranges_match && whole && past_end &&
+                     wrong_refused && truncated_refused && empty);
+    
+    unlink(in_path);
+    unlink(out_path);
+    free(plaintext);
+    free(reference);
+    free(container);
+    free(result);
+}
+
+/* Counting allocator for the allocator test */
+typedef struct {
+    size_t allocs;
+    size_t frees;
+    size_t bytes;
+} TestAllocCounts;
+
+static void* test_counting_alloc(void* context, size_t size) {
+    TestAllocCounts* counts = (TestAllocCounts*)context;
+    counts->allocs++;
+    counts->bytes += size;
+    return malloc(size);
+}
+
+static void test_counting_free(void* context, void* ptr, size_t size) {
+    TestAllocCounts* counts = (TestAllocCounts*)context;
+    counts->frees++;
+    counts->bytes -= size;
+    free(ptr);
+}
+
+static double test_seconds_since(const struct timespec* t0) {
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0->tv_sec) + (t1.tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+/**
+ * Allocator hooks: kaos_encrypt/kaos_decrypt buffers come from the
+ * installed allocator, arena buffers are aligned and reset per thread,
+ * huge-page buffers are 2 MiB aligned; then a first pass over a fresh
+ * 64MB buffer from malloc versus the huge-page allocator
+ */
+void allocator_test() {
+    printf("[API] ALLOCATOR HOOKS TEST\n");
+    printf("--------------------------\n");
+    
+    KaosCipher cipher;
+    kaos_init(&cipher);
+    
+    uint8_t key[KAOS_KEY_SIZE];
+    uint8_t nonce[KAOS_NONCE_SIZE];
+    uint8_t plaintext[777];
+    memset(key, 0x21, KAOS_KEY_SIZE);
+    memset(nonce, 0x43, KAOS_NONCE_SIZE);
+    for (size_t i = 0; i < sizeof(plaintext); i++) plaintext[i] = (uint8_t)i;
+    
+    /* Counting hooks see both buffers and both releases */
+    TestAllocCounts counts = { 0, 0, 0 };
+    KaosAllocator counting = { test_counting_alloc, test_counting_free, &counts };
+    int hooks_ok = kaos_set_allocator(&counting);
+    uint8_t* ciphertext = kaos_encrypt(&cipher, plaintext, sizeof(plaintext), key, nonce);
+    uint8_t* restored = kaos_decrypt(&cipher, ciphertext, sizeof(plaintext), key, nonce);
+    hooks_ok = hooks_ok && ciphertext && restored &&
+               memcmp(restored, plaintext, sizeof(plaintext)) == 0 &&
+               counts.allocs == 2 && counts.bytes == 2 * sizeof(plaintext);
+    kaos_free(ciphertext, sizeof(plaintext));
+    kaos_free(restored, sizeof(plaintext));
+    hooks_ok = hooks_ok && counts.frees == 2 && counts.bytes == 0;
+    
+    /* Per-thread arena: aligned bump allocation, oversize block, reset */
+    KaosAllocator arena;
+    kaos_arena_allocator(&arena, 4096);
+    kaos_set_allocator(&arena);
+    int arena_ok = 1;
+    for (int i = 0; i < 100; i++) {
+        uint8_t* buffer = kaos_encrypt(&cipher, plaintext, (size_t)(i * 7 + 1), key, nonce);
+        arena_ok = arena_ok && buffer && ((uintptr_t)buffer & 63) == 0;
+    }
+    uint8_t* large = (uint8_t*)kaos_alloc(100000);
+    arena_ok = arena_ok && large && kaos_arena_used() >= 100000;
+    kaos_arena_reset();
+    arena_ok = arena_ok && kaos_arena_used() == 0;
+    
+    /* Huge pages: small requests fall back to malloc */
+    KaosAllocator huge;
+    kaos_hugepage_allocator(&huge);
+    kaos_set_allocator(&huge);
+    uint8_t* small = (uint8_t*)kaos_alloc(1000);
+    int huge_ok = small != NULL;
+    kaos_free(small, 1000);
+    
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    uint8_t* huge_buffer = (uint8_t*)kaos_alloc(ALLOC_TEST_SIZE);
+    double huge_alloc = test_seconds_since(&t0);
+    huge_ok = huge_ok && huge_buffer && ((uintptr_t)huge_buffer & ((2u << 20) - 1)) == 0;
+    
+    kaos_set_allocator(NULL);
+    uint8_t* plain_buffer = (uint8_t*)malloc(ALLOC_TEST_SIZE);
+    uint8_t* tile = (uint8_t*)malloc(ALLOC_TEST_SIZE);
+    
+    if (huge_ok && plain_buffer && tile) {
+        memset(tile, 0x5C, ALLOC_TEST_SIZE);
+        
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        kaos_xor_bytes(tile, tile, plain_buffer, ALLOC_TEST_SIZE);
+        double plain_first = test_seconds_since(&t0);
+        
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        kaos_xor_bytes(tile, tile, huge_buffer, ALLOC_TEST_SIZE);
+        double huge_first = test_seconds_since(&t0);
+        
+        printf("First pass over fresh 64MB: malloc %.1f ms, huge pages %.1f ms "
+               "(+%.1f ms at allocation)\n",
+               plain_first * 1e3, huge_first * 1e3, huge_alloc * 1e3);
+    }
+    
+    FILE* thp = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    char mode[64] = "unavailable";
+    if (thp) {
+        if (!fgets(mode, sizeof(mode), thp)) strcpy(mode, "unreadable");
+        mode[strcspn(mode, "\n")] = '\0';
+        fclose(thp);
+    }
+    
+    printf("Installed hooks:  %s (%zu allocs, %zu frees)\n", hooks_ok ? "used" : "BYPASSED",
+           counts.allocs, counts.frees);
+    printf("Thread arena:     %s\n", arena_ok ? "aligned, reset" : "FAILED");
+    printf("Huge-page buffer: %s (THP: %s)\n", huge_ok ? "2 MiB aligned" : "FAILED", mode);
+    
+    api_check_result(hooks_ok && arena_ok && huge_ok);
+    
+    kaos_set_allocator(&huge);
+    kaos_free(huge_buffer, ALLOC_TEST_SIZE);
+    kaos_set_allocator(NULL);
+    free(plain_buffer);
+    free(tile);
+}
+
 /* ===== TEST SUITE COORDINATION ===== */
 
 /**
@@ -490,16 +2336,11 @@ uint8_t* generate_test_keystream(size_t len) {
     memset(key, 0x42, KAOS_KEY_SIZE);
     memset(nonce, 0x99, KAOS_NONCE_SIZE);
     
-    double x, y, z;
-    kaos_key_to_state(key, nonce, &x, &y, &z);
-    
-    for (int i = 0; i < cipher.warmup; i++) {
-        lorenz_step(&cipher, &x, &y, &z);
-    }
-    
-    for (size_t i = 0; i < len; i++) {
-        lorenz_step(&cipher, &x, &y, &z);
-        keystream[i] = kaos_keystream_byte(x, y, z, i);
+    /* Keystream = encryption of zeros, in place */
+    memset(keystream, 0, len);
+    if (!kaos_encrypt_into(&cipher, keystream, keystream, len, key, nonce)) {
+        free(keystream);
+        return NULL;
     }
     
     return keystream;
@@ -519,6 +2360,7 @@ void run_comprehensive_test_suite() {
     printf("For formal validation, use NIST STS, Dieharder, ENT, TestU01.\n\n");
     
     printf("Initializing test environment...\n");
+    printf("Active kernel: %s\n", kaos_kernel_name(kaos_get_kernel()));
     
     printf("Generating test keystream (%d bytes)...\n", TEST_KEYSTREAM_SIZE);
     uint8_t* keystream = generate_test_keystream(TEST_KEYSTREAM_SIZE);
@@ -543,6 +2385,27 @@ void run_comprehensive_test_suite() {
     advanced_entropy_analysis(keystream, TEST_KEYSTREAM_SIZE);
     extended_correlation_analysis(keystream, TEST_KEYSTREAM_SIZE);
     
+    /* API Consistency Tests */
+    streaming_consistency_test();
+    nonce_mixing_vector_test();
+    encrypt_into_consistency_test();
+    batch_consistency_test();
+    kernel_dispatch_test();
+    state_cache_test();
+    seek_index_test();
+    segmented_mode_test();
+    pool_batch_test();
+    prepared_key_test();
+    prestage_test();
+    prefetch_test();
+    tiled_pipeline_test();
+    iovec_test();
+    file_mmap_test();
+    pipeline_test();
+    container_test();
+    stats_test();
+    allocator_test();
+    
     printf("===============================================\n");
     printf("           INTERNAL TEST SUITE COMPLETED       \n");
     printf("===============================================\n");
@@ -562,5 +2425,5 @@ int main() {
     
     run_comprehensive_test_suite();
     
-    return 0;
+    return api_failures ? 1 : 0;
 }
@@ -0,0 +1,703 @@
+/**
+ * KAOS CIPHER - Benchmark Suite
+ * Throughput of every engine over a message-size sweep, JSON output
+ * Author: Simón M. Guiñazú
+ * Github: https://github.com/sysphersec/kaos-cipher
+ *
+ * Each (engine, size) point gets one cold call (caches evicted first),
+ * one untimed warm call, then --reps timed repetitions of enough calls
+ * to last --min-time. Per-call time is reported as median, mean, stddev
+ * and min over the repetitions, plus TSC cycles/byte and MB/s at the
+ * median. Every call includes key setup and warmup, so the sweep shows
+ * how the fixed per-message cost amortizes. Output bytes are folded
+ * into a checksum that is printed, so no engine's work can be dropped.
+ */
+
+#define _GNU_SOURCE
+#include "kaos.h"
+#include "chacha20.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+
+/* Defaults */
+#define BENCH_MIN_SIZE 16
+#define BENCH_MAX_SIZE (1ULL << 30)          /* 1 GiB */
+#define BENCH_REPS 7
+#define BENCH_MIN_TIME_MS 20                 /* Per repetition */
+#define BENCH_MAX_TIME_S 10                  /* Per point, before the 3-rep floor */
+#define BENCH_MIN_REPS 3
+#define BENCH_BATCH_MESSAGES 64
+#define BENCH_BATCH_BYTES (64u << 20)        /* Cap on one batch */
+#define BENCH_STREAM_CHUNK 16384             /* kaos_stream_update call size */
+#define BENCH_FLUSH_BYTES (64u << 20)        /* Evicts every cache level */
+#define BENCH_MAX_REPS 101
+#define BENCH_VERIFY_SIZE 4099               /* Odd: every kernel's tail path */
+#define BENCH_VERIFY_MESSAGES 11             /* Unequal lengths: lanes refill */
+#define BENCH_VERIFY_SEGMENT 1024            /* Several KAOS-P segments */
+#define BENCH_SCALING_SIZE (64u << 20)       /* Thread sweep message size (cap) */
+
+/*
+ * CLOCKS
+ */
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* TSC on x86 (constant rate, not the core clock), nanoseconds elsewhere */
+static uint64_t now_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return now_ns();
+#endif
+}
+
+static double calibrate_tick_rate(void) {
+    uint64_t t0 = now_ns(), c0 = now_ticks();
+    while (now_ns() - t0 < 50000000ULL) {
+    }
+    uint64_t t1 = now_ns(), c1 = now_ticks();
+    return (double)(c1 - c0) * 1e9 / (double)(t1 - t0);
+}
+
+/*
+ * ENGINES
+ */
+typedef struct {
+    KaosCipher cipher;
+    uint8_t key[KAOS_KEY_SIZE];
+    uint8_t nonce[KAOS_NONCE_SIZE];
+    size_t size;               // Message size
+    size_t messages;           // Messages per call (batch), else 1
+    uint8_t* data;             // size * messages bytes, encrypted in place
+    uint8_t* container;        // Segmented output
+    size_t container_size;
+    KaosMessage* msgs;         // Batch descriptors
+    int threads;               // Segmented worker threads (0 = one per CPU)
+} BenchCase;
+
+typedef struct {
+    const char* name;
+    const char* description;
+    int kernel;                // KaosKernelId forced for this engine, -1 = best
+    void (*run)(BenchCase* c);
+} BenchEngine;
+
+/* Per-byte lorenz_step + kaos_keystream_byte: the unoptimized algorithm */
+static void run_reference(BenchCase* c) {
+    double x, y, z;
+    kaos_key_to_state(c->key, c->nonce, &x, &y, &z);
+    for (int i = 0; i < c->cipher.warmup; i++) {
+        lorenz_step(&c->cipher, &x, &y, &z);
+    }
+    for (size_t i = 0; i < c->size; i++) {
+        lorenz_step(&c->cipher, &x, &y, &z);
+        c->data[i] ^= kaos_keystream_byte(x, y, z, i);
+    }
+}
+
+/* One-shot fused kernel (the kernel is forced by the engine entry) */
+static void run_fused(BenchCase* c) {
+    kaos_encrypt_into(&c->cipher, c->data, c->data, c->size, c->key, c->nonce);
+}
+
+static void run_batch(BenchCase* c) {
+    kaos_encrypt_batch(&c->cipher, c->msgs, c->messages);
+}
+
+static void run_stream(BenchCase* c) {
+    KaosStream* stream = kaos_stream_init(&c->cipher, c->key, c->nonce);
+    for (size_t offset = 0; offset < c->size; offset += BENCH_STREAM_CHUNK) {
+        size_t n = c->size - offset < BENCH_STREAM_CHUNK ? c->size - offset : BENCH_STREAM_CHUNK;
+        kaos_stream_update(stream, c->data + offset, c->data + offset, n);
+    }
+    kaos_stream_final(stream);
+}
+
+static void run_segmented(BenchCase* c) {
+    kaos_p_encrypt(&c->cipher, c->data, c->size, c->container, c->container_size,
+                   c->key, c->nonce, 0, c->threads);
+}
+
+static void run_chacha20(BenchCase* c) {
+    chacha20_xor(c->key, c->nonce, 1, c->data, c->data, c->size);
+}
+
+static const BenchEngine engines[] = {
+    { "reference", "per-byte lorenz_step + kaos_keystream_byte", -1, run_reference },
+    { "scalar",    "kaos_encrypt_into, portable fused kernel", KAOS_KERNEL_SCALAR, run_fused },
+    { "sse2",      "kaos_encrypt_into, SSE2 kernel",   KAOS_KERNEL_SSE2,   run_fused },
+    { "avx2",      "kaos_encrypt_into, AVX2 kernel",   KAOS_KERNEL_AVX2,   run_fused },
+    { "avx512",    "kaos_encrypt_into, AVX-512 kernel", KAOS_KERNEL_AVX512, run_fused },
+    { "batch",     "kaos_encrypt_batch, one nonce per message", -1, run_batch },
+    { "stream",    "kaos_stream_update in 16 KiB calls", -1, run_stream },
+    { "segmented", "kaos_p_encrypt (KAOS-P container)", -1, run_segmented },
+    { "chacha20",  "bundled portable ChaCha20 (RFC 8439)", -1, run_chacha20 },
+};
+#define ENGINE_COUNT (sizeof(engines) / sizeof(engines[0]))
+
+/*
+ * VERIFICATION - every engine against kaos_encrypt_into before timing
+ */
+/* Each message of a batch with unequal lengths and its own nonce */
+static int verify_batch(const BenchEngine* e, BenchCase* c) {
+    uint8_t nonces[BENCH_VERIFY_MESSAGES][KAOS_NONCE_SIZE];
+    KaosMessage msgs[BENCH_VERIFY_MESSAGES];
+    size_t total = 0;
+    for (size_t m = 0; m < BENCH_VERIFY_MESSAGES; m++) total += m * 97 + 1;
+
+    uint8_t* data = (uint8_t*)malloc(total);
+    uint8_t* expected = (uint8_t*)malloc(total);
+    int ok = data && expected;
+
+    size_t offset = 0;
+    for (size_t m = 0; ok && m < BENCH_VERIFY_MESSAGES; m++) {
+        size_t length = m * 97 + 1;
+        for (size_t i = 0; i < length; i++) data[offset + i] = (uint8_t)((offset + i) * 13);
+        memcpy(nonces[m], c->nonce, KAOS_NONCE_SIZE);
+        nonces[m][0] ^= (uint8_t)m;
+        msgs[m].in = data + offset;
+        msgs[m].out = data + offset;
+        msgs[m].length = length;
+        msgs[m].key = c->key;
+        msgs[m].nonce = nonces[m];
+        ok = kaos_encrypt_into(&c->cipher, data + offset, expected + offset, length,
+                               c->key, nonces[m]);
+        offset += length;
+    }
+
+    if (ok) {
+        c->msgs = msgs;
+        c->messages = BENCH_VERIFY_MESSAGES;
+        e->run(c);
+        ok = memcmp(data, expected, total) == 0;
+    }
+
+    c->msgs = NULL;
+    free(data);
+    free(expected);
+    return ok;
+}
+
+/* Container segments are kaos_encrypt_into under segment nonces, and decrypt back */
+static int verify_segmented(BenchCase* c) {
+    size_t size = BENCH_VERIFY_SIZE;
+    size_t container_size = kaos_p_container_size(size);
+    uint8_t* plain = (uint8_t*)malloc(size);
+    uint8_t* expected = (uint8_t*)malloc(size);
+    uint8_t* container = (uint8_t*)malloc(container_size);
+    int ok = plain && expected && container;
+
+    for (size_t i = 0; ok && i < size; i++) plain[i] = (uint8_t)(i * 13);
+    for (size_t offset = 0; ok && offset < size; offset += BENCH_VERIFY_SEGMENT) {
+        uint8_t nonce[KAOS_NONCE_SIZE];
+        size_t n = size - offset < BENCH_VERIFY_SEGMENT ? size - offset : BENCH_VERIFY_SEGMENT;
+        kaos_p_segment_nonce(c->nonce, offset / BENCH_VERIFY_SEGMENT, nonce);
+        ok = kaos_encrypt_into(&c->cipher, plain + offset, expected + offset, n, c->key, nonce);
+    }
+
+    ok = ok && kaos_p_encrypt(&c->cipher, plain, size, container, container_size,
+                              c->key, c->nonce, BENCH_VERIFY_SEGMENT, c->threads) &&
+         memcmp(container + KAOS_P_HEADER_SIZE, expected, size) == 0 &&
+         kaos_p_decrypt(&c->cipher, container, container_size, expected, size,
+                        c->key, c->threads) &&
+         memcmp(expected, plain, size) == 0;
+
+    // The timed path (default segment size) must round-trip too
+    if (ok) {
+        c->data = plain;
+        c->size = size;
+        c->container = container;
+        c->container_size = container_size;
+        run_segmented(c);
+        ok = kaos_p_decrypt(&c->cipher, container, container_size, expected, size,
+                            c->key, c->threads) &&
+             memcmp(expected, plain, size) == 0;
+    }
+
+    c->data = NULL;
+    c->container = NULL;
+    free(plain);
+    free(expected);
+    free(container);
+    return ok;
+}
+
+/* Single-stream engines: same bytes as kaos_encrypt_into */
+static int verify_engine(const BenchEngine* e, BenchCase* c) {
+    if (e->run == run_chacha20) {
+        return chacha20_selftest();
+    }
+    if (e->run == run_batch) {
+        return verify_batch(e, c);
+    }
+    if (e->run == run_segmented) {
+        return verify_segmented(c);
+    }
+
+    uint8_t expected[BENCH_VERIFY_SIZE];
+    uint8_t* data = (uint8_t*)malloc(sizeof(expected));
+    if (!data) {
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(expected); i++) {
+        data[i] = (uint8_t)(i * 13);
+    }
+    kaos_encrypt_into(&c->cipher, data, expected, sizeof(expected), c->key, c->nonce);
+    c->data = data;
+    c->size = sizeof(expected);
+    e->run(c);
+    int ok = memcmp(data, expected, sizeof(expected)) == 0;
+    c->data = NULL;
+    free(data);
+    return ok;
+}
+
+/*
+ * BUFFERS
+ */
+static int case_setup(BenchCase* c, const BenchEngine* e, size_t size) {
+    c->size = size;
+    c->messages = 1;
+    if (e->run == run_batch) {
+        c->messages = BENCH_BATCH_BYTES / size;
+        if (c->messages > BENCH_BATCH_MESSAGES) c->messages = BENCH_BATCH_MESSAGES;
+        if (c->messages == 0) c->messages = 1;
+    }
+
+    size_t total = size * c->messages;
+    c->data = (uint8_t*)malloc(total);
+    c->container = NULL;
+    c->msgs = NULL;
+    if (!c->data) {
+        return 0;
+    }
+    for (size_t i = 0; i < total; i++) {
+        c->data[i] = (uint8_t)(i * 31 + 7);
+    }
+
+    if (e->run == run_segmented) {
+        c->container_size = kaos_p_container_size(size);
+        c->container = (uint8_t*)malloc(c->container_size);
+        if (!c->container) {
+            return 0;
+        }
+    }
+    if (e->run == run_batch) {
+        static uint8_t nonces[BENCH_BATCH_MESSAGES][KAOS_NONCE_SIZE];
+        c->msgs = (KaosMessage*)calloc(c->messages, sizeof(KaosMessage));
+        if (!c->msgs) {
+            return 0;
+        }
+        for (size_t m = 0; m < c->messages; m++) {
+            memcpy(nonces[m], c->nonce, KAOS_NONCE_SIZE);
+            nonces[m][0] ^= (uint8_t)m;
+            c->msgs[m].in = c->data + m * size;
+            c->msgs[m].out = c->data + m * size;
+            c->msgs[m].length = size;
+            c->msgs[m].key = c->key;
+            c->msgs[m].nonce = nonces[m];
+        }
+    }
+    return 1;
+}
+
+/* Folds sampled output bytes into a checksum (keeps every call observable) */
+static uint64_t case_checksum(const BenchCase* c) {
+    const uint8_t* out = c->container ? c->container : c->data;
+    size_t length = c->container ? c->container_size : c->size * c->messages;
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    for (size_t i = 0; i < length; i += (length > 4096 ? 4093 : 1)) {
+        h = (h ^ out[i]) * 0x100000001b3ULL;
+    }
+    return h ^ out[length - 1];
+}
+
+static void case_teardown(BenchCase* c) {
+    free(c->data);
+    free(c->container);
+    free(c->msgs);
+    c->data = NULL;
+    c->container = NULL;
+    c->msgs = NULL;
+}
+
+/* Streams through a large buffer so the next call starts with cold caches */
+static void flush_caches(void) {
+    static volatile uint8_t* scratch = NULL;
+    if (!scratch) {
+        scratch = (volatile uint8_t*)calloc(BENCH_FLUSH_BYTES, 1);
+        if (!scratch) return;
+    }
+    for (size_t i = 0; i < BENCH_FLUSH_BYTES; i += 64) {
+        scratch[i] = (uint8_t)(scratch[i] + 1);
+    }
+}
+
+/*
+ * STATISTICS
+ */
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+typedef struct {
+    double median, mean, stddev, min;
+} Summary;
+
+static Summary summarize(double* samples, int count) {
+    Summary s = { 0, 0, 0, 0 };
+    qsort(samples, count, sizeof(double), compare_double);
+
+    s.min = samples[0];
+    s.median = count % 2 ? samples[count / 2]
+                         : (samples[count / 2 - 1] + samples[count / 2]) / 2.0;
+    for (int i = 0; i < count; i++) s.mean += samples[i];
+    s.mean /= count;
+    for (int i = 0; i < count; i++) s.stddev += (samples[i] - s.mean) * (samples[i] - s.mean);
+    s.stddev = count > 1 ? sqrt(s.stddev / (count - 1)) : 0.0;
+    return s;
+}
+
+/*
+ * COMMAND LINE
+ */
+typedef struct {
+    size_t min_size;
+    size_t max_size;
+    int reps;
+    double min_time_ms;
+    double max_time_s;
+    const char* cpus;          // Affinity list, NULL = current CPU
+    const char* engines;       // Comma-separated names, NULL = all
+    const char* output;        // JSON file, NULL = stdout
+    int threads;
+} BenchConfig;
+
+static size_t parse_size(const char* text) {
+    char* end;
+    double value = strtod(text, &end);
+    switch (*end) {
+    case 'k': case 'K': value *= 1024.0; break;
+    case 'm': case 'M': value *= 1048576.0; break;
+    case 'g': case 'G': value *= 1073741824.0; break;
+    default: break;
+    }
+    return value >= 1.0 ? (size_t)value : 0;
+}
+
+/* "0-3,6" into a CPU set; returns the number of CPUs */
+static int parse_cpus(const char* text, cpu_set_t* set) {
+    CPU_ZERO(set);
+    while (*text) {
+        char* end;
+        long first = strtol(text, &end, 10), last = first;
+        if (end == text || first < 0) return 0;
+        if (*end == '-') {
+            text = end + 1;
+            last = strtol(text, &end, 10);
+            if (end == text || last < first) return 0;
+        }
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+            CPU_SET(cpu, set);
+        }
+        text = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return 0;
+    }
+    return CPU_COUNT(set);
+}
+
+static int engine_selected(const BenchConfig* config, const char* name) {
+    if (!config->engines) return 1;
+
+    size_t len = strlen(name);
+    for (const char* p = config->engines; *p; ) {
+        const char* comma = strchr(p, ',');
+        size_t n = comma ? (size_t)(comma - p) : strlen(p);
+        if (n == len && strncmp(p, name, n) == 0) return 1;
+        p += n + (comma ? 1 : 0);
+    }
+    return 0;
+}
+
+static void print_usage(const char* program) {
+    printf("KAOS Cipher Benchmark Suite\n\n");
+    printf("USAGE: %s [options]\n\n", program);
+    printf("  --sizes MIN:MAX    message sizes, powers of 4 (default 16:1G)\n");
+    printf("  --reps N           timed repetitions per point (default %d)\n", BENCH_REPS);
+    printf("  --min-time MS      minimum duration of one repetition (default %d)\n",
+           BENCH_MIN_TIME_MS);
+    printf("  --max-time S       time budget of one point; long calls get fewer\n"
+           "                     repetitions, never fewer than %d (default %d)\n",
+           BENCH_MIN_REPS, BENCH_MAX_TIME_S);
+    printf("  --cpus LIST        pin to CPUs, e.g. 2 or 0-3 (default: current CPU)\n");
+    printf("  --threads N        KAOS-P worker threads (default: one per pinned CPU);\n"
+           "                     a 1, 2, 4 ... thread sweep over the pinned CPUs always runs\n");
+    printf("  --engines LIST     comma-separated subset of:");
+    for (size_t e = 0; e < ENGINE_COUNT; e++) printf(" %s", engines[e].name);
+    printf("\n  --quick            16:1M, 3 repetitions\n");
+    printf("  --output FILE      JSON results (default: stdout; progress on stderr)\n");
+}
+
+static int parse_args(int argc, char* argv[], BenchConfig* config) {
+    config->min_size = BENCH_MIN_SIZE;
+    config->max_size = BENCH_MAX_SIZE;
+    config->reps = BENCH_REPS;
+    config->min_time_ms = BENCH_MIN_TIME_MS;
+    config->max_time_s = BENCH_MAX_TIME_S;
+    config->cpus = NULL;
+    config->engines = NULL;
+    config->output = NULL;
+    config->threads = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--quick") == 0) {
+            config->max_size = 1 << 20;
+            config->reps = 3;
+            continue;
+        }
+        if (!value) return 0;
+        i++;
+
+        if (strcmp(arg, "--sizes") == 0) {
+            const char* colon = strchr(value, ':');
+            config->min_size = parse_size(value);
+            config->max_size = colon ? parse_size(colon + 1) : config->min_size;
+        } else if (strcmp(arg, "--reps") == 0) {
+            config->reps = atoi(value);
+        } else if (strcmp(arg, "--min-time") == 0) {
+            config->min_time_ms = atof(value);
+        } else if (strcmp(arg, "--max-time") == 0) {
+            config->max_time_s = atof(value);
+        } else if (strcmp(arg, "--cpus") == 0) {
+            config->cpus = value;
+        } else if (strcmp(arg, "--threads") == 0) {
+            config->threads = atoi(value);
+        } else if (strcmp(arg, "--engines") == 0) {
+            config->engines = value;
+        } else if (strcmp(arg, "--output") == 0) {
+            config->output = value;
+        } else {
+            return 0;
+        }
+    }
+
+    return config->min_size > 0 && config->max_size >= config->min_size &&
+           config->reps > 0 && config->reps <= BENCH_MAX_REPS && config->min_time_ms >= 0 && config->max_time_s >= 0;
+}
+
+/*
+ * ONE POINT - cold call, warm call, timed repetitions
+ * Returns the median ns per call, 0 if skipped
+ */
+static double bench_point(FILE* json, const BenchEngine* e, BenchCase* c, size_t size,
+                          const BenchConfig* config, int* first) {
+    if (!case_setup(c, e, size)) {
+        fprintf(stderr, "  %-10s %12zu  skipped: out of memory\n", e->name, size);
+        case_teardown(c);
+        return 0.0;
+    }
+
+    flush_caches();
+    uint64_t start = now_ns();
+    e->run(c);
+    double cold_ns = (double)(now_ns() - start);
+
+    start = now_ns();
+    e->run(c);
+    double warm_ns = (double)(now_ns() - start);
+
+    double target_ns = config->min_time_ms * 1e6;
+    uint64_t iterations = warm_ns > 0 && target_ns > warm_ns ? (uint64_t)(target_ns / warm_ns) : 1;
+
+    // Calls of several seconds (1 GB) would make the full sweep take hours
+    int reps = config->reps;
+    double budget_reps = config->max_time_s * 1e9 / (warm_ns * iterations);
+    if (budget_reps < reps) {
+        reps = budget_reps > BENCH_MIN_REPS ? (int)budget_reps : BENCH_MIN_REPS;
+        if (reps > config->reps) reps = config->reps;
+    }
+
+    double samples[BENCH_MAX_REPS], ticks[BENCH_MAX_REPS];
+    for (int r = 0; r < reps; r++) {
+        uint64_t t0 = now_ns(), k0 = now_ticks();
+        for (uint64_t i = 0; i < iterations; i++) {
+            e->run(c);
+        }
+        uint64_t k1 = now_ticks(), t1 = now_ns();
+        samples[r] = (double)(t1 - t0) / iterations;
+        ticks[r] = (double)(k1 - k0) / iterations;
+    }
+
+    Summary s = summarize(samples, reps);
+    Summary k = summarize(ticks, reps);
+    double bytes = (double)size * c->messages;
+    double mb_per_s = bytes / 1048576.0 / (s.median * 1e-9);
+
+    fprintf(stderr, "  %-10s %12zu  %12.0f ns  %10.3f cycles/byte  %10.2f MB/s\n",
+            e->name, size, s.median, k.median / bytes, mb_per_s);
+
+    fprintf(json, "%s\n    {\"engine\": \"%s\", \"size\": %zu, \"messages\": %zu, "
+            "\"iterations\": %llu, \"reps\": %d, \"cold_ns\": %.0f, "
+            "\"median_ns\": %.1f, \"mean_ns\": %.1f, \"stddev_ns\": %.1f, \"min_ns\": %.1f, "
+            "\"cycles_per_byte\": %.4f, \"mb_per_s\": %.3f, \"checksum\": \"%016llx\"",
+            *first ? "" : ",", e->name, size, c->messages, (unsigned long long)iterations,
+            reps, cold_ns, s.median, s.mean, s.stddev, s.min, k.median / bytes, mb_per_s,
+            (unsigned long long)case_checksum(c));
+    if (e->run == run_segmented) {
+        fprintf(json, ", \"threads\": %d", c->threads);
+    }
+    fprintf(json, "}");
+    *first = 0;
+
+    case_teardown(c);
+    return s.median;
+}
+
+/* Doubling thread counts, always ending on max */
+static int next_thread_count(int threads, int max) {
+    if (threads >= max) return max + 1;
+    return threads * 2 < max ? threads * 2 : max;
+}
+
+/*
+ * MAIN
+ */
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+    if (!parse_args(argc, argv, &config)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    /* Pin before anything is measured; KAOS-P threads inherit the set,
+       so by default they get one worker per pinned CPU */
+    cpu_set_t set;
+    char cpus[64];
+    if (config.cpus) {
+        if (!parse_cpus(config.cpus, &set)) {
+            fprintf(stderr, "Error: invalid CPU list '%s'\n", config.cpus);
+            return 1;
+        }
+        snprintf(cpus, sizeof(cpus), "%s", config.cpus);
+    } else {
+        int cpu = sched_getcpu();
+        CPU_ZERO(&set);
+        CPU_SET(cpu < 0 ? 0 : cpu, &set);
+        snprintf(cpus, sizeof(cpus), "%d", cpu < 0 ? 0 : cpu);
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        fprintf(stderr, "Warning: could not pin to CPUs %s\n", cpus);
+    }
+
+    FILE* json = config.output ? fopen(config.output, "w") : stdout;
+    if (!json) {
+        fprintf(stderr, "Error: cannot create '%s'\n", config.output);
+        return 1;
+    }
+
+    BenchCase c;
+    memset(&c, 0, sizeof(c));
+    kaos_init(&c.cipher);
+    for (int i = 0; i < KAOS_KEY_SIZE; i++) c.key[i] = (uint8_t)(i * 17 + 1);
+    for (int i = 0; i < KAOS_NONCE_SIZE; i++) c.nonce[i] = (uint8_t)(i * 29 + 3);
+    int pinned = CPU_COUNT(&set);
+    c.threads = config.threads > 0 ? config.threads : pinned;
+
+    KaosKernelId best = kaos_get_kernel();
+    double tick_rate = calibrate_tick_rate();
+
+    fprintf(stderr, "KAOS benchmark: kernel %s, CPUs %s, TSC %.3f GHz\n",
+            kaos_kernel_name(best), cpus, tick_rate / 1e9);
+
+    fprintf(json, "{\n  \"benchmark\": \"kaos-throughput\",\n");
+    fprintf(json, "  \"host\": {\"cpus_online\": %ld, \"pinned\": \"%s\", \"kernel\": \"%s\", "
+            "\"tsc_hz\": %.0f, \"compiler\": \"%s\"},\n",
+            sysconf(_SC_NPROCESSORS_ONLN), cpus, kaos_kernel_name(best), tick_rate,
+#ifdef __VERSION__
+            __VERSION__
+#else
+            "unknown"
+#endif
+            );
+    fprintf(json, "  \"config\": {\"min_size\": %zu, \"max_size\": %zu, \"reps\": %d, "
+            "\"min_time_ms\": %.1f, \"max_time_s\": %.1f, \"segmented_threads\": %d, "
+            "\"batch_messages\": %d},\n",
+            config.min_size, config.max_size, config.reps, config.min_time_ms, config.max_time_s,
+            c.threads, BENCH_BATCH_MESSAGES);
+
+    /* Engines: bit-exactness first, unavailable kernels dropped */
+    int active[ENGINE_COUNT];
+    fprintf(json, "  \"engines\": [");
+    int first = 1;
+    for (size_t e = 0; e < ENGINE_COUNT; e++) {
+        const BenchEngine* engine = &engines[e];
+        active[e] = engine_selected(&config, engine->name) &&
+                    (engine->kernel < 0 || kaos_kernel_available((KaosKernelId)engine->kernel));
+        if (!active[e]) continue;
+
+        kaos_set_kernel(engine->kernel < 0 ? best : (KaosKernelId)engine->kernel);
+        int verified = verify_engine(engine, &c);
+        if (!verified) {
+            fprintf(stderr, "Error: engine %s does not match kaos_encrypt\n", engine->name);
+            active[e] = 0;
+        }
+        fprintf(json, "%s\n    {\"name\": \"%s\", \"description\": \"%s\", \"verified\": %s}",
+                first ? "" : ",", engine->name, engine->description, verified ? "true" : "false");
+        first = 0;
+    }
+    fprintf(json, "\n  ],\n  \"results\": [");
+
+    first = 1;
+    for (size_t size = config.min_size; size <= config.max_size; size *= 4) {
+        for (size_t e = 0; e < ENGINE_COUNT; e++) {
+            if (!active[e]) continue;
+            kaos_set_kernel(engines[e].kernel < 0 ? best : (KaosKernelId)engines[e].kernel);
+            bench_point(json, &engines[e], &c, size, &config, &first);
+        }
+        fflush(json);
+        if (size > SIZE_MAX / 4) break;
+    }
+    fprintf(json, "\n  ],\n  \"scaling\": [");
+
+    /* KAOS-P thread sweep: 1, 2, 4, ... and every pinned CPU */
+    first = 1;
+    for (size_t e = 0; e < ENGINE_COUNT; e++) {
+        if (!active[e] || engines[e].run != run_segmented) continue;
+
+        size_t size = config.max_size < BENCH_SCALING_SIZE ? config.max_size : BENCH_SCALING_SIZE;
+        int configured = c.threads;
+        double single = 0.0;
+        fprintf(stderr, "KAOS-P scaling, %zu bytes, CPUs %s\n", size, cpus);
+        kaos_set_kernel(best);
+        for (int threads = 1; threads <= pinned; threads = next_thread_count(threads, pinned)) {
+            c.threads = threads;
+            double median = bench_point(json, &engines[e], &c, size, &config, &first);
+            if (threads == 1) single = median;
+            if (median > 0.0 && single > 0.0) {
+                fprintf(stderr, "  %-10s %12d threads  speedup %.2fx\n",
+                        engines[e].name, threads, single / median);
+            }
+        }
+        c.threads = configured;
+    }
+    fprintf(json, "\n  ]\n}\n");
+    kaos_set_kernel(best);
+
+    if (json != stdout) {
+        fclose(json);
+    }
+    return 0;
+}
@@ -0,0 +1,34 @@
+/**
+ * KAOS CIPHER - Benchmark Suite
+ * ChaCha20 (RFC 8439) - bundled reference stream cipher for comparison
+ * Author: Simón M. Guiñazú
+ * Github: https://github.com/sysphersec/kaos-cipher
+ *
+ * Portable C, one 64-byte block at a time, no SIMD: the baseline a
+ * stream cipher without platform-specific code reaches on this host.
+ */
+
+#ifndef KAOS_BENCH_CHACHA20_H
+#define KAOS_BENCH_CHACHA20_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define CHACHA20_KEY_SIZE 32
+#define CHACHA20_NONCE_SIZE 12
+
+/**
+ * out[i] = in[i] ^ keystream, blocks counted from counter
+ * in and out may point to the same buffer
+ */
+void chacha20_xor(const uint8_t key[CHACHA20_KEY_SIZE],
+                  const uint8_t nonce[CHACHA20_NONCE_SIZE], uint32_t counter,
+                  const uint8_t* in, uint8_t* out, size_t length);
+
+/**
+ * RFC 8439 section 2.4.2 test vector
+ * Returns 1 if this build reproduces it, 0 otherwise
+ */
+int chacha20_selftest(void);
+
+#endif /* KAOS_BENCH_CHACHA20_H */
@@ -0,0 +1,384 @@
+/**
+ * KAOS CIPHER - Benchmark Suite
+ * File encryption: stdio chunks versus memory mappings
+ * Author: Simón M. Guiñazú
+ * Github: https://github.com/sysphersec/kaos-cipher
+ *
+ * Encrypts a scratch file of each size with every method: the stdio
+ * path of examples/example_file.c (4 MiB fread, stream, fwrite), the
+ * mapped kaos_encrypt_file, the overlapped kaos_encrypt_fd pipeline on
+ * io_uring and on threads, the mapped in-place kaos_encrypt_file_inplace,
+ * and the same stream over one in-memory chunk with no file at all, which
+ * is the ceiling the I/O paths approach. Page cache warm by default;
+ * --cold drops the files' pages before every repetition.
+ */
+
+#define _GNU_SOURCE
+#include "kaos.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* Defaults */
+#define FILE_REPS 3
+#define FILE_MAX_REPS 101
+#define FILE_MAX_SIZES 16
+#define FILE_CHUNK (4u << 20)     /* stdio read/write unit, as in example_file */
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * METHODS
+ */
+typedef struct {
+    KaosCipher cipher;
+    uint8_t key[KAOS_KEY_SIZE];
+    uint8_t nonce[KAOS_NONCE_SIZE];
+    size_t size;
+    const char* plain_path;
+    const char* out_path;
+    uint8_t* chunk;               // FILE_CHUNK bytes
+} FileCase;
+
+typedef struct {
+    const char* name;
+    const char* description;
+    int (*run)(FileCase* c);
+    int (*available)(FileCase* c);  // NULL = always; 0 = skipped, reported
+} FileMethod;
+
+/* Same keystream work with no file: one chunk encrypted repeatedly */
+static int run_memory(FileCase* c) {
+    KaosStream* stream = kaos_stream_init(&c->cipher, c->key, c->nonce);
+    int ok = stream != NULL;
+    for (size_t offset = 0; ok && offset < c->size; offset += FILE_CHUNK) {
+        size_t n = c->size - offset < FILE_CHUNK ? c->size - offset : FILE_CHUNK;
+        ok = kaos_stream_update(stream, c->chunk, c->chunk, n);
+    }
+    kaos_stream_final(stream);
+    return ok;
+}
+
+static int run_stdio(FileCase* c) {
+    FILE* in = fopen(c->plain_path, "rb");
+    FILE* out = fopen(c->out_path, "wb");
+    KaosStream* stream = kaos_stream_init(&c->cipher, c->key, c->nonce);
+    int ok = in && out && stream;
+
+    size_t n;
+    while (ok && (n = fread(c->chunk, 1, FILE_CHUNK, in)) > 0) {
+        ok = kaos_stream_update(stream, c->chunk, c->chunk, n) &&
+             fwrite(c->chunk, 1, n, out) == n;
+    }
+    ok = ok && !ferror(in);
+
+    kaos_stream_final(stream);
+    if (in) fclose(in);
+    if (out && fclose(out) != 0) ok = 0;
+    return ok;
+}
+
+static int run_mmap(FileCase* c) {
+    return kaos_encrypt_file(&c->cipher, c->plain_path, c->out_path, c->key, c->nonce, 0);
+}
+
+/* Overlapped read/encrypt/write through descriptors */
+static int run_pipeline(FileCase* c, KaosIoBackend backend) {
+    int in_fd = open(c->plain_path, O_RDONLY | O_CLOEXEC);
+    int out_fd = open(c->out_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    KaosPipelineOptions options = { 0 };
+    options.backend = backend;
+
+    int ok = in_fd >= 0 && out_fd >= 0 &&
+             kaos_encrypt_fd(&c->cipher, in_fd, out_fd, c->key, c->nonce, &options, NULL);
+
+    if (in_fd >= 0) close(in_fd);
+    if (out_fd >= 0 && close(out_fd) != 0) ok = 0;
+    return ok;
+}
+
+static int run_uring(FileCase* c) {
+    return run_pipeline(c, KAOS_IO_URING);
+}
+
+/* io_uring needs kernel support (and no seccomp/sysctl block): one empty probe run */
+static int uring_available(FileCase* c) {
+    int in_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    int out_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    KaosPipelineStats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    int ok = in_fd >= 0 && out_fd >= 0 &&
+             kaos_encrypt_fd(&c->cipher, in_fd, out_fd, c->key, c->nonce, NULL, &stats) &&
+             stats.backend == KAOS_IO_URING;
+
+    if (in_fd >= 0) close(in_fd);
+    if (out_fd >= 0) close(out_fd);
+    return ok;
+}
+
+static int run_threads(FileCase* c) {
+    return run_pipeline(c, KAOS_IO_THREADS);
+}
+
+/* Alternately encrypts and decrypts the output file of the previous method */
+static int run_inplace(FileCase* c) {
+    return kaos_encrypt_file_inplace(&c->cipher, c->out_path, c->key, c->nonce, 0);
+}
+
+static const FileMethod methods[] = {
+    { "memory", "kaos_stream_update over an in-memory chunk, no file", run_memory, NULL },
+    { "stdio", "4 MiB fread, kaos_stream_update, fwrite", run_stdio, NULL },
+    { "mmap", "kaos_encrypt_file, input and output mapped", run_mmap, NULL },
+    { "uring", "kaos_encrypt_fd, io_uring with registered buffers", run_uring, uring_available },
+    { "threads", "kaos_encrypt_fd, reader and writer threads", run_threads, NULL },
+    { "inplace", "kaos_encrypt_file_inplace, one shared mapping", run_inplace, NULL },
+};
+#define METHOD_COUNT (sizeof(methods) / sizeof(methods[0]))
+
+/*
+ * FILES
+ */
+static int write_scratch(const char* path, size_t size, uint8_t* chunk) {
+    FILE* file = fopen(path, "wb");
+    if (!file) return 0;
+
+    int ok = 1;
+    for (size_t offset = 0; ok && offset < size; offset += FILE_CHUNK) {
+        size_t n = size - offset < FILE_CHUNK ? size - offset : FILE_CHUNK;
+        for (size_t i = 0; i < n; i++) chunk[i] = (uint8_t)((offset + i) * 131 + 7);
+        ok = fwrite(chunk, 1, n, file) == n;
+    }
+    return fclose(file) == 0 && ok;
+}
+
+/* FNV-1a of a whole file, 0 if unreadable */
+static uint64_t file_checksum(const char* path, uint8_t* chunk) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return 0;
+
+    uint64_t h = 1469598103934665603ULL;
+    size_t n;
+    while ((n = fread(chunk, 1, FILE_CHUNK, file)) > 0) {
+        for (size_t i = 0; i < n; i++) h = (h ^ chunk[i]) * 1099511628211ULL;
+    }
+    fclose(file);
+    return h;
+}
+
+/* Written back and evicted, so the next pass reads from the device */
+static void drop_cache(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+/*
+ * COMMAND LINE
+ */
+typedef struct {
+    size_t sizes[FILE_MAX_SIZES];
+    int size_count;
+    int reps;
+    int cold;
+    const char* dir;
+    const char* output;            // JSON file, NULL = stdout
+} FileConfig;
+
+static size_t parse_size(const char* text) {
+    char* end;
+    double value = strtod(text, &end);
+    switch (*end) {
+    case 'k': case 'K': value *= 1024.0; break;
+    case 'm': case 'M': value *= 1048576.0; break;
+    case 'g': case 'G': value *= 1073741824.0; break;
+    default: break;
+    }
+    return value >= 1.0 ? (size_t)value : 0;
+}
+
+static int parse_sizes(const char* text, FileConfig* config) {
+    config->size_count = 0;
+    while (*text && config->size_count < FILE_MAX_SIZES) {
+        size_t size = parse_size(text);
+        if (size == 0) return 0;
+        config->sizes[config->size_count++] = size;
+        const char* comma = strchr(text, ',');
+        if (!comma) break;
+        text = comma + 1;
+    }
+    return config->size_count > 0;
+}
+
+static void print_usage(const char* program) {
+    printf("KAOS Cipher File Benchmark\n\n");
+    printf("USAGE: %s [options]\n\n", program);
+    printf("  --sizes LIST     file sizes (default 1M,64M,256M)\n");
+    printf("  --dir DIR        where the scratch files go (default .)\n");
+    printf("  --reps N         repetitions per point, median reported (default %d)\n", FILE_REPS);
+    printf("  --cold           drop the files from the page cache before each repetition\n");
+    printf("  --output FILE    JSON results (default stdout)\n");
+}
+
+static int parse_args(int argc, char* argv[], FileConfig* config) {
+    memset(config, 0, sizeof(FileConfig));
+    parse_sizes("1M,64M,256M", config);
+    config->reps = FILE_REPS;
+    config->dir = ".";
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--cold") == 0) { config->cold = 1; continue; }
+
+        const char* value = i + 1 < argc ? argv[++i] : NULL;
+        if (!value) return 0;
+
+        if (strcmp(arg, "--sizes") == 0) {
+            if (!parse_sizes(value, config)) return 0;
+        } else if (strcmp(arg, "--dir") == 0) {
+            config->dir = value;
+        } else if (strcmp(arg, "--reps") == 0) {
+            config->reps = atoi(value);
+        } else if (strcmp(arg, "--output") == 0) {
+            config->output = value;
+        } else {
+            return 0;
+        }
+    }
+    return config->reps > 0 && config->reps <= FILE_MAX_REPS;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * MAIN
+ */
+int main(int argc, char* argv[]) {
+    FileConfig config;
+    if (!parse_args(argc, argv, &config)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    FILE* json = config.output ? fopen(config.output, "w") : stdout;
+    if (!json) {
+        fprintf(stderr, "Error: cannot create '%s'\n", config.output);
+        return 1;
+    }
+
+    char plain_path[4096], out_path[4096];
+    snprintf(plain_path, sizeof(plain_path), "%s/kaos_filebench_%d.in", config.dir, (int)getpid());
+    snprintf(out_path, sizeof(out_path), "%s/kaos_filebench_%d.out", config.dir, (int)getpid());
+
+    FileCase c;
+    memset(&c, 0, sizeof(c));
+    kaos_init(&c.cipher);
+    for (int i = 0; i < KAOS_KEY_SIZE; i++) c.key[i] = (uint8_t)(i * 17 + 1);
+    for (int i = 0; i < KAOS_NONCE_SIZE; i++) c.nonce[i] = (uint8_t)(i * 29 + 3);
+    c.plain_path = plain_path;
+    c.out_path = out_path;
+    c.chunk = (uint8_t*)malloc(FILE_CHUNK);
+    if (!c.chunk) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+
+    fprintf(stderr, "KAOS file benchmark: kernel %s, files in %s, page cache %s\n",
+            kaos_kernel_name(kaos_get_kernel()), config.dir, config.cold ? "cold" : "warm");
+
+    // Methods this host cannot run are skipped, not failed
+    int available[METHOD_COUNT];
+    for (size_t m = 0; m < METHOD_COUNT; m++) {
+        available[m] = !methods[m].available || methods[m].available(&c);
+        if (!available[m]) {
+            fprintf(stderr, "  %-8s unavailable on this host, skipped\n", methods[m].name);
+        }
+    }
+
+    fprintf(json, "{\n  \"benchmark\": \"kaos-file\",\n");
+    fprintf(json, "  \"host\": {\"cpus_online\": %ld, \"kernel\": \"%s\", \"unavailable\": [",
+            sysconf(_SC_NPROCESSORS_ONLN), kaos_kernel_name(kaos_get_kernel()));
+    for (size_t m = 0, listed = 0; m < METHOD_COUNT; m++) {
+        if (!available[m]) {
+            fprintf(json, "%s\"%s\"", listed++ ? ", " : "", methods[m].name);
+        }
+    }
+    fprintf(json, "]},\n");
+    fprintf(json, "  \"config\": {\"dir\": \"%s\", \"reps\": %d, \"cold\": %s, "
+            "\"stdio_chunk\": %u, \"mmap_window\": %u},\n  \"results\": [",
+            config.dir, config.reps, config.cold ? "true" : "false",
+            FILE_CHUNK, KAOS_FILE_WINDOW);
+
+    int first = 1, all_ok = 1;
+    for (int s = 0; s < config.size_count; s++) {
+        c.size = config.sizes[s];
+        if (!write_scratch(plain_path, c.size, c.chunk)) {
+            fprintf(stderr, "  %zu: cannot write scratch file in %s\n", c.size, config.dir);
+            all_ok = 0;
+            break;
+        }
+
+        uint64_t expected = 0;
+        for (size_t m = 0; m < METHOD_COUNT; m++) {
+            const FileMethod* method = &methods[m];
+            double samples[FILE_MAX_REPS];
+            int ok = 1;
+            if (!available[m]) continue;
+
+            for (int r = 0; ok && r < config.reps; r++) {
+                if (config.cold) {
+                    drop_cache(plain_path);
+                    drop_cache(out_path);
+                }
+                uint64_t start = now_ns();
+                ok = method->run(&c);
+                samples[r] = (double)(now_ns() - start);
+            }
+
+            // Every out-of-place path must produce the same file
+            int verified = 1;
+            if (ok && method->run == run_stdio) {
+                expected = file_checksum(out_path, c.chunk);
+            } else if (ok && (method->run == run_mmap || method->run == run_uring ||
+                              method->run == run_threads)) {
+                verified = file_checksum(out_path, c.chunk) == expected;
+            }
+            if (!ok || !verified) {
+                fprintf(stderr, "  %-8s %12zu  FAILED%s\n", method->name, c.size,
+                        ok ? " (output differs from stdio)" : "");
+                all_ok = 0;
+                continue;
+            }
+
+            qsort(samples, config.reps, sizeof(double), compare_double);
+            double median = samples[config.reps / 2];
+            double mb_per_s = (double)c.size / 1048576.0 / (median * 1e-9);
+            fprintf(stderr, "  %-8s %12zu  %14.0f ns  %10.2f MB/s\n",
+                    method->name, c.size, median, mb_per_s);
+            fprintf(json, "%s\n    {\"method\": \"%s\", \"size\": %zu, \"median_ns\": %.0f, "
+                    "\"min_ns\": %.0f, \"mb_per_s\": %.3f}",
+                    first ? "" : ",", method->name, c.size, median, samples[0], mb_per_s);
+            first = 0;
+        }
+        fflush(json);
+    }
+    fprintf(json, "\n  ]\n}\n");
+
+    unlink(plain_path);
+    unlink(out_path);
+    free(c.chunk);
+    if (json != stdout) fclose(json);
+    return all_ok ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+/**
+ * KAOS CIPHER - Benchmark Suite
+ * Log-bucketed latency histogram (HDR-style)
+ * Author: Simón M. Guiñazú
+ * Github: https://github.com/sysphersec/kaos-cipher
+ */
+
+#include "histogram.h"
+#include <string.h>
+
+/*
+ * BUCKET LAYOUT
+ * index < 2*HIST_HALF: the value itself; above, exponent e >= 1 holds
+ * values [HIST_HALF << e, HIST_HALF << (e+1)) in HIST_HALF buckets of width 2^e
+ */
+static inline unsigned hist_index(uint64_t value) {
+    if (value < 2 * HIST_HALF) {
+        return (unsigned)value;
+    }
+    unsigned msb = 63 - (unsigned)__builtin_clzll(value);
+    unsigned e = msb - (HIST_SUB_BITS - 1);
+    return e * HIST_HALF + (unsigned)(value >> e);
+}
+
+/* Largest value that maps to index */
+static inline uint64_t hist_upper(unsigned index) {
+    if (index < 2 * HIST_HALF) {
+        return index;
+    }
+    unsigned e = index / HIST_HALF - 1;
+    uint64_t sub = index - e * HIST_HALF;
+    return ((sub + 1) << e) - 1;
+}
+
+void hist_init(Histogram* h) {
+    memset(h, 0, sizeof(Histogram));
+    h->min = UINT64_MAX;
+}
+
+void hist_record(Histogram* h, uint64_t value) {
+    h->counts[hist_index(value)]++;
+    h->total++;
+    h->sum += (double)value;
+    if (value < h->min) h->min = value;
+    if (value > h->max) h->max = value;
+}
+
+void hist_merge(Histogram* dst, const Histogram* src) {
+    for (unsigned i = 0; i < HIST_BUCKETS; i++) {
+        dst->counts[i] += src->counts[i];
+    }
+    dst->total += src->total;
+    dst->sum += src->sum;
+    if (src->min < dst->min) dst->min = src->min;
+    if (src->max > dst->max) dst->max = src->max;
+}
+
+uint64_t hist_percentile(const Histogram* h, double percentile) {
+    if (h->total == 0) {
+        return 0;
+    }
+
+    // Rank of the value, 1-based, rounded up
+    double exact = percentile / 100.0 * (double)h->total;
+    uint64_t rank = (uint64_t)exact;
+    if ((double)rank < exact || rank == 0) rank++;
+    if (rank > h->total) rank = h->total;
+
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t value = hist_upper(i);
+            if (value > h->max) value = h->max;
+            if (value < h->min) value = h->min;
+            return value;
+        }
+    }
+    return h->max;
+}
+
+double hist_mean(const Histogram* h) {
+    return h->total ? h->sum / (double)h->total : 0.0;
+}
+
+void hist_write_buckets(const Histogram* h, FILE* out) {
+    int first = 1;
+    fputc('[', out);
+    for (unsigned i = 0; i < HIST_BUCKETS; i++) {
+        if (h->counts[i]) {
+            fprintf(out, "%s[%llu,%llu]", first ? "" : ",",
+                    (unsigned long long)hist_upper(i), (unsigned long long)h->counts[i]);
+            first = 0;
+        }
+    }
+    fputc(']', out);
+}
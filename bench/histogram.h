@@ -0,0 +1,53 @@
+/**
+ * KAOS CIPHER - Benchmark Suite
+ * Log-bucketed latency histogram (HDR-style)
+ * Author: Simón M. Guiñazú
+ * Github: https://github.com/sysphersec/kaos-cipher
+ *
+ * Values below 2^HIST_SUB_BITS are counted exactly; above that every
+ * power-of-two range is split into 2^(HIST_SUB_BITS-1) linear buckets,
+ * so any recorded value is known to within 1/2^(HIST_SUB_BITS-1)
+ * (0.8%) over the full 64-bit range, in a fixed 58 KiB array.
+ * Recording is one index computation and an increment.
+ */
+
+#ifndef KAOS_BENCH_HISTOGRAM_H
+#define KAOS_BENCH_HISTOGRAM_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define HIST_SUB_BITS 8
+#define HIST_HALF (1u << (HIST_SUB_BITS - 1))
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 2) * HIST_HALF)
+
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    double sum;
+} Histogram;
+
+/* Empty histogram */
+void hist_init(Histogram* h);
+
+/* Count one value */
+void hist_record(Histogram* h, uint64_t value);
+
+/* dst += src */
+void hist_merge(Histogram* dst, const Histogram* src);
+
+/**
+ * Smallest recorded value v such that at least percentile % of the
+ * values are <= v (to bucket precision); 0 when empty
+ */
+uint64_t hist_percentile(const Histogram* h, double percentile);
+
+/* Mean of the recorded values */
+double hist_mean(const Histogram* h);
+
+/* Non-empty buckets as a JSON array of [upper_bound, count] pairs */
+void hist_write_buckets(const Histogram* h, FILE* out);
+
+#endif /* KAOS_BENCH_HISTOGRAM_H */
@@ -0,0 +1,526 @@
+/**
+ * KAOS CIPHER - Benchmark Suite
+ * Per-call latency percentiles for small messages
+ * Author: Simón M. Guiñazú
+ * Github: https://github.com/sysphersec/kaos-cipher
+ *
+ * Every call is timed on its own with CLOCK_MONOTONIC and counted in a
+ * log-bucketed histogram per thread; the histograms of one run are
+ * merged and reported as p50/p90/p99/p99.9/p99.99/max per variant,
+ * message size and thread count. Averages hide what matters for small
+ * messages: warmup dominates every call, and the tail shows frequency
+ * scaling, allocator behaviour and contention between threads.
+ */
+
+#define _GNU_SOURCE
+#include "kaos.h"
+#include "histogram.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+
+/* Defaults */
+#define LAT_SAMPLES 5000          /* Timed calls per thread */
+#define LAT_DISCARD 100           /* Untimed calls first (cold caches, clock ramp) */
+#define LAT_BATCH 8               /* Messages per kaos_encrypt_batch call */
+#define LAT_MAX_BATCH 64
+#define LAT_MAX_LIST 16
+#define LAT_PRESTAGE_DEPTH 32     /* Reservations kept ahead of the sender */
+#define LAT_CACHE_NONCES 16       /* Nonces each thread cycles through (all hits) */
+#define LAT_CACHE_CAPACITY 4096
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Smallest back-to-back clock difference: the resolution floor of every sample */
+static uint64_t timer_floor(void) {
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < 10000; i++) {
+        uint64_t t0 = now_ns(), t1 = now_ns();
+        if (t1 - t0 < best) best = t1 - t0;
+    }
+    return best;
+}
+
+/*
+ * VARIANTS
+ */
+typedef struct {
+    KaosCipher cipher;
+    uint8_t key[KAOS_KEY_SIZE];
+    uint8_t nonce[KAOS_NONCE_SIZE];
+    int thread;
+    size_t size;
+    uint8_t* in;
+    uint8_t* out;
+    uint8_t* result;               // kaos_encrypt/kaos_decrypt output
+    KaosPrestager* prestager;
+    KaosCache* cache;              // Shared by every thread of a run
+    int batch;
+    uint8_t* batch_data;
+    KaosMessage msgs[LAT_MAX_BATCH];
+    uint8_t nonces[LAT_MAX_BATCH][KAOS_NONCE_SIZE];
+} LatencyCtx;
+
+/* Thread id in bytes 0..3, sequence number in bytes 4..11 */
+static void make_nonce(uint8_t nonce[KAOS_NONCE_SIZE], int thread, uint64_t sequence) {
+    for (int i = 0; i < 4; i++) nonce[i] = (uint8_t)(thread >> (8 * i));
+    for (int i = 0; i < 8; i++) nonce[4 + i] = (uint8_t)(sequence >> (8 * i));
+}
+
+typedef struct {
+    const char* name;
+    const char* description;
+    int (*setup)(LatencyCtx* c);                  // NULL: nothing beyond buffers
+    void (*before)(LatencyCtx* c, uint64_t seq);  // Untimed, sets the nonce
+    int (*call)(LatencyCtx* c);                   // Timed
+    void (*after)(LatencyCtx* c);                 // Untimed, NULL: nothing
+    void (*teardown)(LatencyCtx* c);
+} LatencyVariant;
+
+static void before_plain(LatencyCtx* c, uint64_t seq) {
+    make_nonce(c->nonce, c->thread, seq);
+}
+
+static int call_encrypt(LatencyCtx* c) {
+    c->result = kaos_encrypt(&c->cipher, c->in, c->size, c->key, c->nonce);
+    return c->result != NULL;
+}
+
+static int call_decrypt(LatencyCtx* c) {
+    c->result = kaos_decrypt(&c->cipher, c->in, c->size, c->key, c->nonce);
+    return c->result != NULL;
+}
+
+static void after_release(LatencyCtx* c) {
+    kaos_free(c->result, c->size);
+    c->result = NULL;
+}
+
+static int call_encrypt_into(LatencyCtx* c) {
+    return kaos_encrypt_into(&c->cipher, c->in, c->out, c->size, c->key, c->nonce);
+}
+
+/* Pre-staged: the state for each nonce is reserved LAT_PRESTAGE_DEPTH calls ahead */
+static int setup_prestaged(LatencyCtx* c) {
+    c->prestager = kaos_prestager_new(&c->cipher, c->key, LAT_PRESTAGE_DEPTH, 1);
+    if (!c->prestager) {
+        return 0;
+    }
+    for (uint64_t seq = 0; seq < LAT_PRESTAGE_DEPTH - 1; seq++) {
+        make_nonce(c->nonce, c->thread, seq);
+        kaos_prestager_reserve(c->prestager, c->nonce);
+    }
+    return 1;
+}
+
+static void before_prestaged(LatencyCtx* c, uint64_t seq) {
+    make_nonce(c->nonce, c->thread, seq + LAT_PRESTAGE_DEPTH - 1);
+    kaos_prestager_reserve(c->prestager, c->nonce);
+    make_nonce(c->nonce, c->thread, seq);
+}
+
+static int call_prestaged(LatencyCtx* c) {
+    return kaos_encrypt_prestaged(c->prestager, c->in, c->out, c->size, c->nonce);
+}
+
+static void teardown_prestaged(LatencyCtx* c) {
+    kaos_prestager_free(c->prestager);
+    c->prestager = NULL;
+}
+
+/* Cached: a few nonces per thread, so every timed call is a hit on a shared cache */
+static void before_cached(LatencyCtx* c, uint64_t seq) {
+    make_nonce(c->nonce, c->thread, seq % LAT_CACHE_NONCES);
+}
+
+static int call_cached(LatencyCtx* c) {
+    return kaos_decrypt_cached(&c->cipher, c->cache, c->in, c->out, c->size, c->key, c->nonce);
+}
+
+/* Batch: one call encrypts c->batch messages, each with its own nonce */
+static int setup_batch(LatencyCtx* c) {
+    c->batch_data = (uint8_t*)calloc(c->batch, c->size);
+    if (!c->batch_data) {
+        return 0;
+    }
+    for (int m = 0; m < c->batch; m++) {
+        c->msgs[m].in = c->batch_data + (size_t)m * c->size;
+        c->msgs[m].out = c->batch_data + (size_t)m * c->size;
+        c->msgs[m].length = c->size;
+        c->msgs[m].key = c->key;
+        c->msgs[m].nonce = c->nonces[m];
+    }
+    return 1;
+}
+
+static void before_batch(LatencyCtx* c, uint64_t seq) {
+    for (int m = 0; m < c->batch; m++) {
+        make_nonce(c->nonces[m], c->thread, seq * c->batch + m);
+    }
+}
+
+static int call_batch(LatencyCtx* c) {
+    return kaos_encrypt_batch(&c->cipher, c->msgs, c->batch);
+}
+
+static void teardown_batch(LatencyCtx* c) {
+    free(c->batch_data);
+    c->batch_data = NULL;
+}
+
+static const LatencyVariant variants[] = {
+    { "encrypt", "kaos_encrypt (allocates the output)",
+      NULL, before_plain, call_encrypt, after_release, NULL },
+    { "decrypt", "kaos_decrypt (allocates the output)",
+      NULL, before_plain, call_decrypt, after_release, NULL },
+    { "encrypt_into", "kaos_encrypt_into (caller buffer)",
+      NULL, before_plain, call_encrypt_into, NULL, NULL },
+    { "prestaged", "kaos_encrypt_prestaged, nonces reserved ahead",
+      setup_prestaged, before_prestaged, call_prestaged, NULL, teardown_prestaged },
+    { "cached", "kaos_decrypt_cached hits on a shared cache",
+      NULL, before_cached, call_cached, NULL, NULL },
+    { "batch", "kaos_encrypt_batch, one call per batch",
+      setup_batch, before_batch, call_batch, NULL, teardown_batch },
+};
+#define VARIANT_COUNT (sizeof(variants) / sizeof(variants[0]))
+
+/*
+ * WORKER THREAD
+ */
+typedef struct {
+    size_t sizes[LAT_MAX_LIST];
+    int size_count;
+    int threads[LAT_MAX_LIST];
+    int thread_count;
+    int samples;
+    int discard;
+    int batch;
+    int interval_us;
+    int pin;
+    const char* variants;          // Comma-separated names, NULL = all
+    const char* json;              // JSON file, NULL = none
+    int buckets;                   // Histogram buckets in the JSON
+} LatencyConfig;
+
+typedef struct {
+    const LatencyVariant* variant;
+    const LatencyConfig* config;
+    LatencyCtx ctx;
+    pthread_barrier_t* barrier;
+    Histogram hist;
+    uint64_t first_ns;             // First (cold) call
+    int failed;
+} LatencyWorker;
+
+static void* latency_worker(void* arg) {
+    LatencyWorker* w = (LatencyWorker*)arg;
+    LatencyCtx* c = &w->ctx;
+    const LatencyVariant* v = w->variant;
+    const LatencyConfig* config = w->config;
+
+    if (config->pin) {
+        cpu_set_t set;
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        CPU_ZERO(&set);
+        CPU_SET(c->thread % (cpus > 0 ? cpus : 1), &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    c->in = (uint8_t*)malloc(c->size);
+    c->out = (uint8_t*)malloc(c->size);
+    int ready = c->in && c->out && (!v->setup || v->setup(c));
+    if (ready) {
+        memset(c->in, 0xA5, c->size);
+    }
+
+    // Every thread starts timing together
+    pthread_barrier_wait(w->barrier);
+    if (!ready) {
+        w->failed = 1;
+        goto done;
+    }
+
+    struct timespec pause = { 0, (long)config->interval_us * 1000 };
+    uint64_t total = (uint64_t)config->discard + (uint64_t)config->samples;
+    for (uint64_t seq = 0; seq < total; seq++) {
+        v->before(c, seq);
+
+        uint64_t t0 = now_ns();
+        int ok = v->call(c);
+        uint64_t elapsed = now_ns() - t0;
+
+        if (v->after) v->after(c);
+        if (!ok) w->failed = 1;
+        if (seq == 0) w->first_ns = elapsed;
+        if (seq >= (uint64_t)config->discard) hist_record(&w->hist, elapsed);
+        if (config->interval_us > 0) nanosleep(&pause, NULL);
+    }
+
+done:
+    if (ready && v->teardown) v->teardown(c);
+    free(c->in);
+    free(c->out);
+    return NULL;
+}
+
+/*
+ * ONE RUN - variant x size x thread count
+ */
+static void report(FILE* json, int* first, const LatencyVariant* v, size_t size, int threads,
+                   const Histogram* h, uint64_t first_ns, int failed, const LatencyConfig* config) {
+    static const double percentiles[] = { 50.0, 90.0, 99.0, 99.9, 99.99 };
+    uint64_t p[5];
+    for (int i = 0; i < 5; i++) p[i] = hist_percentile(h, percentiles[i]);
+
+    printf("%-13s %6zu %4d %9llu %9.2f %9.2f %9.2f %9.2f %9.2f %10.2f %9.2f%s\n",
+           v->name, size, threads, (unsigned long long)h->total,
+           p[0] / 1e3, p[1] / 1e3, p[2] / 1e3, p[3] / 1e3, p[4] / 1e3,
+           h->max / 1e3, hist_mean(h) / 1e3, failed ? "  FAILED" : "");
+    fflush(stdout);
+
+    if (!json) return;
+    fprintf(json, "%s\n    {\"variant\": \"%s\", \"size\": %zu, \"threads\": %d, "
+            "\"messages_per_call\": %d, \"samples\": %llu, \"failed\": %s, \"first_ns\": %llu, "
+            "\"min_ns\": %llu, \"p50_ns\": %llu, \"p90_ns\": %llu, \"p99_ns\": %llu, "
+            "\"p999_ns\": %llu, \"p9999_ns\": %llu, \"max_ns\": %llu, \"mean_ns\": %.1f",
+            *first ? "" : ",", v->name, size, threads,
+            v->call == call_batch ? config->batch : 1, (unsigned long long)h->total,
+            failed ? "true" : "false", (unsigned long long)first_ns,
+            (unsigned long long)(h->total ? h->min : 0), (unsigned long long)p[0],
+            (unsigned long long)p[1], (unsigned long long)p[2], (unsigned long long)p[3],
+            (unsigned long long)p[4], (unsigned long long)h->max, hist_mean(h));
+    if (config->buckets) {
+        fprintf(json, ", \"buckets\": ");
+        hist_write_buckets(h, json);
+    }
+    fputc('}', json);
+    *first = 0;
+}
+
+static int run(const LatencyVariant* v, size_t size, int threads, const LatencyConfig* config,
+               KaosCache* cache, Histogram* merged, uint64_t* first_ns) {
+    LatencyWorker* workers = (LatencyWorker*)calloc(threads, sizeof(LatencyWorker));
+    pthread_t* ids = (pthread_t*)calloc(threads, sizeof(pthread_t));
+    pthread_barrier_t barrier;
+    if (!workers || !ids || pthread_barrier_init(&barrier, NULL, threads) != 0) {
+        free(workers);
+        free(ids);
+        return 0;
+    }
+
+    for (int t = 0; t < threads; t++) {
+        LatencyWorker* w = &workers[t];
+        w->variant = v;
+        w->config = config;
+        w->barrier = &barrier;
+        hist_init(&w->hist);
+        kaos_init(&w->ctx.cipher);
+        for (int i = 0; i < KAOS_KEY_SIZE; i++) w->ctx.key[i] = (uint8_t)(i * 7 + t);
+        w->ctx.thread = t;
+        w->ctx.size = size;
+        w->ctx.cache = cache;
+        w->ctx.batch = config->batch;
+    }
+
+    // Thread 0 runs on the calling thread
+    int started = 1;
+    for (int t = 1; t < threads; t++) {
+        if (pthread_create(&ids[t], NULL, latency_worker, &workers[t]) != 0) {
+            fprintf(stderr, "Error: cannot start thread %d\n", t);
+            exit(1);
+        }
+        started++;
+    }
+    latency_worker(&workers[0]);
+    for (int t = 1; t < started; t++) {
+        pthread_join(ids[t], NULL);
+    }
+
+    int failed = 0;
+    hist_init(merged);
+    for (int t = 0; t < threads; t++) {
+        hist_merge(merged, &workers[t].hist);
+        failed |= workers[t].failed;
+    }
+    *first_ns = workers[0].first_ns;
+
+    pthread_barrier_destroy(&barrier);
+    free(workers);
+    free(ids);
+    return !failed;
+}
+
+/*
+ * COMMAND LINE
+ */
+static size_t parse_size(const char* text) {
+    char* end;
+    double value = strtod(text, &end);
+    if (*end == 'k' || *end == 'K') value *= 1024.0;
+    if (*end == 'm' || *end == 'M') value *= 1048576.0;
+    return value >= 1.0 ? (size_t)value : 0;
+}
+
+/* Comma-separated list; returns the count, 0 on error */
+static int parse_list(const char* text, size_t* values, int max) {
+    int count = 0;
+    while (*text && count < max) {
+        values[count] = parse_size(text);
+        if (values[count] == 0) return 0;
+        count++;
+        const char* comma = strchr(text, ',');
+        if (!comma) break;
+        text = comma + 1;
+    }
+    return count;
+}
+
+static int variant_selected(const LatencyConfig* config, const char* name) {
+    if (!config->variants) return 1;
+
+    size_t len = strlen(name);
+    for (const char* p = config->variants; *p; ) {
+        const char* comma = strchr(p, ',');
+        size_t n = comma ? (size_t)(comma - p) : strlen(p);
+        if (n == len && strncmp(p, name, n) == 0) return 1;
+        p += n + (comma ? 1 : 0);
+    }
+    return 0;
+}
+
+static void print_usage(const char* program) {
+    printf("KAOS Cipher Latency Benchmark\n\n");
+    printf("USAGE: %s [options]\n\n", program);
+    printf("  --sizes LIST       message sizes (default 16,64,256,1K)\n");
+    printf("  --threads LIST     concurrent threads per run (default 1,2,4)\n");
+    printf("  --samples N        timed calls per thread (default %d)\n", LAT_SAMPLES);
+    printf("  --discard N        untimed calls first (default %d)\n", LAT_DISCARD);
+    printf("  --batch N          messages per batch call (default %d)\n", LAT_BATCH);
+    printf("  --interval-us N    idle time between calls, e.g. to let pre-staging keep up\n");
+    printf("  --pin              pin thread t to CPU t mod online CPUs\n");
+    printf("  --variants LIST    comma-separated subset of:");
+    for (size_t v = 0; v < VARIANT_COUNT; v++) printf(" %s", variants[v].name);
+    printf("\n  --json FILE        percentiles as JSON\n");
+    printf("  --buckets          include the histogram buckets in the JSON\n");
+}
+
+static int parse_args(int argc, char* argv[], LatencyConfig* config) {
+    size_t list[LAT_MAX_LIST];
+    memset(config, 0, sizeof(LatencyConfig));
+    config->size_count = parse_list("16,64,256,1K", config->sizes, LAT_MAX_LIST);
+    config->thread_count = 3;
+    config->threads[0] = 1;
+    config->threads[1] = 2;
+    config->threads[2] = 4;
+    config->samples = LAT_SAMPLES;
+    config->discard = LAT_DISCARD;
+    config->batch = LAT_BATCH;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--pin") == 0) { config->pin = 1; continue; }
+        if (strcmp(arg, "--buckets") == 0) { config->buckets = 1; continue; }
+
+        const char* value = i + 1 < argc ? argv[++i] : NULL;
+        if (!value) return 0;
+
+        if (strcmp(arg, "--sizes") == 0) {
+            config->size_count = parse_list(value, config->sizes, LAT_MAX_LIST);
+            if (config->size_count == 0) return 0;
+        } else if (strcmp(arg, "--threads") == 0) {
+            config->thread_count = parse_list(value, list, LAT_MAX_LIST);
+            if (config->thread_count == 0) return 0;
+            for (int t = 0; t < config->thread_count; t++) {
+                if (list[t] > 1024) return 0;
+                config->threads[t] = (int)list[t];
+            }
+        } else if (strcmp(arg, "--samples") == 0) {
+            config->samples = atoi(value);
+        } else if (strcmp(arg, "--discard") == 0) {
+            config->discard = atoi(value);
+        } else if (strcmp(arg, "--batch") == 0) {
+            config->batch = atoi(value);
+        } else if (strcmp(arg, "--interval-us") == 0) {
+            config->interval_us = atoi(value);
+        } else if (strcmp(arg, "--variants") == 0) {
+            config->variants = value;
+        } else if (strcmp(arg, "--json") == 0) {
+            config->json = value;
+        } else {
+            return 0;
+        }
+    }
+
+    return config->samples > 0 && config->discard >= 0 && config->interval_us >= 0 &&
+           config->batch > 0 && config->batch <= LAT_MAX_BATCH;
+}
+
+/*
+ * MAIN
+ */
+int main(int argc, char* argv[]) {
+    LatencyConfig config;
+    if (!parse_args(argc, argv, &config)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    FILE* json = NULL;
+    if (config.json && !(json = fopen(config.json, "w"))) {
+        fprintf(stderr, "Error: cannot create '%s'\n", config.json);
+        return 1;
+    }
+
+    uint64_t floor_ns = timer_floor();
+    printf("KAOS latency: kernel %s, %ld CPUs online, clock floor %llu ns, "
+           "%d samples/thread after %d discarded\n",
+           kaos_kernel_name(kaos_get_kernel()), sysconf(_SC_NPROCESSORS_ONLN),
+           (unsigned long long)floor_ns, config.samples, config.discard);
+    printf("%-13s %6s %4s %9s %9s %9s %9s %9s %9s %10s %9s\n", "variant", "size", "thr",
+           "samples", "p50 us", "p90 us", "p99 us", "p99.9 us", "p99.99", "max us", "mean us");
+
+    if (json) {
+        fprintf(json, "{\n  \"benchmark\": \"kaos-latency\",\n"
+                "  \"host\": {\"cpus_online\": %ld, \"kernel\": \"%s\", \"clock_floor_ns\": %llu},\n"
+                "  \"config\": {\"samples_per_thread\": %d, \"discard\": %d, \"batch\": %d, "
+                "\"interval_us\": %d, \"pinned\": %s},\n  \"results\": [",
+                sysconf(_SC_NPROCESSORS_ONLN), kaos_kernel_name(kaos_get_kernel()),
+                (unsigned long long)floor_ns, config.samples, config.discard, config.batch,
+                config.interval_us, config.pin ? "true" : "false");
+    }
+
+    static Histogram merged;
+    int first = 1, all_ok = 1;
+    for (size_t v = 0; v < VARIANT_COUNT; v++) {
+        if (!variant_selected(&config, variants[v].name)) continue;
+
+        for (int s = 0; s < config.size_count; s++) {
+            for (int t = 0; t < config.thread_count; t++) {
+                // A fresh cache per run: every thread's first cycle of nonces misses
+                KaosCache* cache = variants[v].call == call_cached ?
+                                   kaos_cache_new(LAT_CACHE_CAPACITY) : NULL;
+                uint64_t first_ns = 0;
+                int ok = run(&variants[v], config.sizes[s], config.threads[t], &config,
+                             cache, &merged, &first_ns);
+                report(json, &first, &variants[v], config.sizes[s], config.threads[t],
+                       &merged, first_ns, !ok, &config);
+                all_ok &= ok;
+                kaos_cache_free(cache);
+            }
+        }
+    }
+
+    if (json) {
+        fprintf(json, "\n  ]\n}\n");
+        fclose(json);
+    }
+    return all_ok ? 0 : 1;
+}
@@ -0,0 +1,616 @@
+/**
+ * EXAMPLE 3: Batch Directory Encryption
+ * Whole directory trees on every core, one process, resumable
+ *
+ * Each file is streamed in chunks exactly as example_file does, under
+ * one batch key and a fresh random nonce kept in a 32-byte header in
+ * front of the ciphertext. Files are handed to the workers largest
+ * first, so no big file starts last and holds up the end of the run.
+ * A manifest records every finished file; a rerun skips them.
+ */
+
+#include "kaos.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+
+/* Read/write unit per worker, as in example_file */
+#define CHUNK_SIZE (4 * 1024 * 1024)
+
+/* Upper bound on worker threads */
+#define MAX_THREADS 256
+
+/*
+ * Per-file header (little-endian), laid out like the KAOS-P header:
+ *   0  "KAOS"         4 bytes magic
+ *   4  version        1 byte
+ *   5  mode           1 byte, 0 = one stream over the whole file
+ *   6  reserved       6 bytes, zero
+ *   12 length         8 bytes, plaintext length
+ *   20 nonce          12 bytes
+ *   32 ciphertext
+ */
+#define HEADER_SIZE 32
+#define HEADER_VERSION 1
+#define HEADER_MODE_STREAM 0
+
+/* Encrypted files get this suffix; decryption strips it */
+#define SUFFIX ".kaos"
+
+/* Default manifest name, inside the output directory */
+#define MANIFEST_NAME ".kaos-manifest"
+
+/* One file to process */
+typedef struct {
+    char* rel;              // Path relative to the source directory
+    uint64_t size;
+    int64_t mtime;
+} BatchFile;
+
+typedef struct {
+    int encrypt;
+    const char* src_dir;
+    const char* dst_dir;
+    dev_t dst_dev;          // Output root, skipped when it lies inside src_dir
+    ino_t dst_ino;
+    uint8_t key[KAOS_KEY_SIZE];
+    KaosCipher cipher;
+
+    BatchFile* files;
+    size_t count;
+    size_t capacity;
+
+    char** done;            // Sorted "size mtime path" lines from the manifest
+    size_t done_count;
+
+    FILE* manifest;
+    FILE* random;
+    pthread_mutex_t lock;   // Manifest appends and error lines
+
+    atomic_size_t next;     // Next unclaimed file
+    atomic_size_t processed;
+    atomic_size_t failed;
+    atomic_uint_least64_t bytes;
+} Batch;
+
+static double now_seconds(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/* "a" + "/" + "b" in a new string */
+static char* join_path(const char* a, const char* b, const char* suffix) {
+    size_t length = strlen(a) + 1 + strlen(b) + strlen(suffix) + 1;
+    char* path = (char*)malloc(length);
+    if (path) {
+        snprintf(path, length, "%s%s%s%s", a, *a && *b ? "/" : "", b, suffix);
+    }
+    return path;
+}
+
+static void report(Batch* batch, const char* what, const char* path) {
+    pthread_mutex_lock(&batch->lock);
+    fprintf(stderr, "ERROR: %s: %s (%s)\n", what, path, strerror(errno));
+    pthread_mutex_unlock(&batch->lock);
+}
+
+/*
+ * KEY - one key per batch, reused when the key file exists (resume)
+ */
+static int load_or_create_key(Batch* batch, const char* key_file) {
+    FILE* file = fopen(key_file, "rb");
+    if (file) {
+        int ok = fread(batch->key, 1, KAOS_KEY_SIZE, file) == KAOS_KEY_SIZE;
+        fclose(file);
+        if (!ok) {
+            fprintf(stderr, "ERROR: Key file '%s' is too short\n", key_file);
+        }
+        return ok;
+    }
+    if (!batch->encrypt) {
+        fprintf(stderr, "ERROR: Cannot load key file '%s'\n", key_file);
+        return 0;
+    }
+
+    // Only the key: every file carries its own nonce
+    if (fread(batch->key, 1, KAOS_KEY_SIZE, batch->random) != KAOS_KEY_SIZE) {
+        fprintf(stderr, "ERROR: Cannot read /dev/urandom\n");
+        return 0;
+    }
+    int fd = open(key_file, O_WRONLY | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 || write(fd, batch->key, KAOS_KEY_SIZE) != KAOS_KEY_SIZE || close(fd) != 0) {
+        fprintf(stderr, "ERROR: Cannot write key file '%s'\n", key_file);
+        return 0;
+    }
+    printf("Key saved to: %s\n", key_file);
+    return 1;
+}
+
+/*
+ * SCAN - regular files under src, output directories created as found
+ */
+static int add_file(Batch* batch, const char* rel, const struct stat* st) {
+    if (batch->count == batch->capacity) {
+        size_t capacity = batch->capacity ? batch->capacity * 2 : 256;
+        BatchFile* files = (BatchFile*)realloc(batch->files, capacity * sizeof(BatchFile));
+        if (!files) return 0;
+        batch->files = files;
+        batch->capacity = capacity;
+    }
+    BatchFile* file = &batch->files[batch->count];
+    file->rel = strdup(rel);
+    file->size = (uint64_t)st->st_size;
+    file->mtime = (int64_t)st->st_mtime;
+    if (!file->rel) return 0;
+    batch->count++;
+    return 1;
+}
+
+static int scan_dir(Batch* batch, const char* rel) {
+    char* src = join_path(batch->src_dir, rel, "");
+    char* dst = join_path(batch->dst_dir, rel, "");
+    DIR* dir = src && dst ? opendir(src) : NULL;
+    int ok = dir != NULL && (mkdir(dst, 0777) == 0 || errno == EEXIST);
+    if (!ok) {
+        fprintf(stderr, "ERROR: Cannot scan '%s' into '%s'\n", src ? src : rel, dst ? dst : "");
+    }
+
+    // Remember the output root: a dst_dir inside src_dir must not be walked
+    struct stat root;
+    if (ok && *rel == '\0') {
+        if (stat(dst, &root) != 0) {
+            fprintf(stderr, "ERROR: Cannot stat '%s' (%s)\n", dst, strerror(errno));
+            ok = 0;
+        } else {
+            batch->dst_dev = root.st_dev;
+            batch->dst_ino = root.st_ino;
+            if (stat(src, &root) == 0 && root.st_dev == batch->dst_dev &&
+                root.st_ino == batch->dst_ino) {
+                fprintf(stderr, "ERROR: '%s' is both the source and the output directory\n", src);
+                ok = 0;
+            }
+        }
+    }
+
+    struct dirent* entry;
+    while (ok && (entry = readdir(dir)) != NULL) {
+        const char* name = entry->d_name;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0 ||
+            strcmp(name, MANIFEST_NAME) == 0) {
+            continue;
+        }
+
+        // Newlines would break the manifest's one-path-per-line format
+        char* child = join_path(rel, name, "");
+        char* path = child ? join_path(batch->src_dir, child, "") : NULL;
+        struct stat st;
+        if (!child || !path) {
+            ok = 0;
+        } else if (strchr(name, '\n')) {
+            fprintf(stderr, "Skipping '%s': newline in name\n", path);
+        } else if (lstat(path, &st) != 0) {
+            fprintf(stderr, "Skipping '%s': %s\n", path, strerror(errno));
+        } else if (S_ISDIR(st.st_mode) && st.st_dev == batch->dst_dev &&
+                   st.st_ino == batch->dst_ino) {
+            fprintf(stderr, "Skipping '%s': output directory\n", path);
+        } else if (S_ISDIR(st.st_mode)) {
+            ok = scan_dir(batch, child);
+        } else if (S_ISREG(st.st_mode)) {
+            ok = add_file(batch, child, &st);
+        }
+        free(path);
+        free(child);
+    }
+
+    if (dir) closedir(dir);
+    free(dst);
+    free(src);
+    return ok;
+}
+
+/* Largest first: the long files start while every core is still free */
+static int compare_size_desc(const void* a, const void* b) {
+    uint64_t x = ((const BatchFile*)a)->size, y = ((const BatchFile*)b)->size;
+    return (x < y) - (x > y);
+}
+
+/*
+ * MANIFEST - one "size mtime path" line per finished file, appended
+ * after the output is renamed into place. A file whose source changed
+ * since (size or mtime) no longer matches its line and is redone
+ */
+static int compare_line(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static char* manifest_line(const BatchFile* file) {
+    size_t length = strlen(file->rel) + 48;
+    char* line = (char*)malloc(length);
+    if (line) {
+        snprintf(line, length, "%llu %lld %s", (unsigned long long)file->size,
+                 (long long)file->mtime, file->rel);
+    }
+    return line;
+}
+
+static int open_manifest(Batch* batch, const char* path) {
+    const char* header = batch->encrypt ? "kaos-batch 1 encrypt" : "kaos-batch 1 decrypt";
+
+    FILE* file = fopen(path, "r");
+    if (file) {
+        char* line = NULL;
+        size_t capacity = 0;
+        ssize_t length;
+        int first = 1, ok = 1;
+        while (ok && (length = getline(&line, &capacity, file)) > 0) {
+            // A line without its newline was cut off by the interruption
+            if (line[length - 1] != '\n') break;
+            line[length - 1] = '\0';
+
+            if (first) {
+                if (strcmp(line, header) != 0) {
+                    fprintf(stderr, "ERROR: Manifest '%s' belongs to another kind of run\n", path);
+                    ok = 0;
+                }
+                first = 0;
+                continue;
+            }
+            char** done = (char**)realloc(batch->done, (batch->done_count + 1) * sizeof(char*));
+            ok = done != NULL && (done[batch->done_count] = strdup(line)) != NULL;
+            if (done) batch->done = done;
+            if (ok) batch->done_count++;
+        }
+        free(line);
+        fclose(file);
+        if (!ok) return 0;
+        qsort(batch->done, batch->done_count, sizeof(char*), compare_line);
+    }
+
+    batch->manifest = fopen(path, "a");
+    if (!batch->manifest) {
+        fprintf(stderr, "ERROR: Cannot open manifest '%s'\n", path);
+        return 0;
+    }
+    if (!file) {
+        fprintf(batch->manifest, "%s\n", header);
+        fflush(batch->manifest);
+    }
+    return 1;
+}
+
+static int already_done(const Batch* batch, const BatchFile* file) {
+    char* line = manifest_line(file);
+    int found = line && batch->done_count > 0 &&
+                bsearch(&line, batch->done, batch->done_count, sizeof(char*), compare_line);
+    free(line);
+    return found;
+}
+
+static void record_done(Batch* batch, const BatchFile* file) {
+    char* line = manifest_line(file);
+    pthread_mutex_lock(&batch->lock);
+    if (line) {
+        fprintf(batch->manifest, "%s\n", line);
+        fflush(batch->manifest);
+    }
+    pthread_mutex_unlock(&batch->lock);
+    free(line);
+}
+
+/*
+ * ONE FILE - streamed in CHUNK_SIZE pieces into "<output>.part",
+ * renamed over the output once complete
+ * The data is fsynced before the rename and the directory entry after it,
+ * so a file in the manifest survives a crash on disk, not just in cache
+ */
+static int sync_parent(const char* path) {
+    const char* slash = strrchr(path, '/');
+    char* dir = slash ? strndup(path, (size_t)(slash - path) + 1) : strdup(".");
+    int fd = dir ? open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC) : -1;
+    int ok = fd >= 0 && fsync(fd) == 0;
+    if (fd >= 0) close(fd);
+    free(dir);
+    return ok;
+}
+
+static void put_le(uint8_t* out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static uint64_t get_le(const uint8_t* in, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= (uint64_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+/* read() until length bytes or end of file */
+static ssize_t read_full(int fd, uint8_t* data, size_t length) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = read(fd, data + done, length - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n == 0) break;
+        done += (size_t)n;
+    }
+    return (ssize_t)done;
+}
+
+static int write_full(int fd, const uint8_t* data, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        data += n;
+        length -= (size_t)n;
+    }
+    return 1;
+}
+
+static int process_file(Batch* batch, const BatchFile* file, uint8_t* chunk) {
+    char* src = join_path(batch->src_dir, file->rel, "");
+    char* dst = NULL;
+    if (batch->encrypt) {
+        dst = join_path(batch->dst_dir, file->rel, SUFFIX);
+    } else {
+        // Strip the suffix when present
+        size_t length = strlen(file->rel), suffix = strlen(SUFFIX);
+        int strip = length > suffix && strcmp(file->rel + length - suffix, SUFFIX) == 0;
+        char* rel = strdup(file->rel);
+        if (rel && strip) rel[length - suffix] = '\0';
+        dst = rel ? join_path(batch->dst_dir, rel, "") : NULL;
+        free(rel);
+    }
+    char* part = dst ? join_path(dst, "", ".part") : NULL;
+    if (!src || !dst || !part) {
+        free(src);
+        free(dst);
+        free(part);
+        return 0;
+    }
+
+    int in = open(src, O_RDONLY | O_CLOEXEC);
+    int out = in < 0 ? -1 : open(part, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (in < 0 || out < 0) {
+        report(batch, in < 0 ? "Cannot open" : "Cannot create", in < 0 ? src : part);
+    }
+
+    uint8_t header[HEADER_SIZE];
+    uint8_t nonce[KAOS_NONCE_SIZE];
+    uint64_t length = 0;
+    int ok = in >= 0 && out >= 0;
+
+    if (ok && batch->encrypt) {
+        // Fresh nonce per file: one key, never the same stream twice
+        length = file->size;
+        ok = fread(nonce, 1, KAOS_NONCE_SIZE, batch->random) == KAOS_NONCE_SIZE;
+        memset(header, 0, HEADER_SIZE);
+        memcpy(header, "KAOS", 4);
+        header[4] = HEADER_VERSION;
+        header[5] = HEADER_MODE_STREAM;
+        put_le(header + 12, length, 8);
+        memcpy(header + 20, nonce, KAOS_NONCE_SIZE);
+        ok = ok && write_full(out, header, HEADER_SIZE);
+    } else if (ok) {
+        // Header must match and announce exactly the bytes that follow
+        ok = read_full(in, header, HEADER_SIZE) == HEADER_SIZE &&
+             memcmp(header, "KAOS", 4) == 0 && header[4] == HEADER_VERSION &&
+             header[5] == HEADER_MODE_STREAM &&
+             file->size - HEADER_SIZE == (length = get_le(header + 12, 8));
+        memcpy(nonce, header + 20, KAOS_NONCE_SIZE);
+        if (!ok) {
+            pthread_mutex_lock(&batch->lock);
+            fprintf(stderr, "ERROR: Not a KAOS batch file or truncated: %s\n", src);
+            pthread_mutex_unlock(&batch->lock);
+        }
+    }
+
+    KaosStream* stream = ok ? kaos_stream_init(&batch->cipher, batch->key, nonce) : NULL;
+    ok = ok && stream != NULL;
+
+    uint64_t done = 0;
+    ssize_t n = 0;
+    while (ok && (n = read_full(in, chunk, CHUNK_SIZE)) > 0) {
+        ok = kaos_stream_update(stream, chunk, chunk, (size_t)n) &&
+             write_full(out, chunk, (size_t)n);
+        done += (uint64_t)n;
+    }
+
+    // Source changed size while being read
+    if (ok && (n < 0 || done != length)) {
+        pthread_mutex_lock(&batch->lock);
+        fprintf(stderr, "ERROR: %s: %s\n", n < 0 ? "Read failed" : "File changed while read", src);
+        pthread_mutex_unlock(&batch->lock);
+        ok = 0;
+    }
+
+    kaos_stream_final(stream);
+    if (ok && fsync(out) != 0) {
+        report(batch, "Cannot sync", part);
+        ok = 0;
+    }
+    if (out >= 0 && close(out) != 0) ok = 0;
+    if (in >= 0) close(in);
+
+    if (ok && rename(part, dst) != 0) {
+        report(batch, "Cannot rename", part);
+        ok = 0;
+    }
+    if (ok && !sync_parent(dst)) {
+        report(batch, "Cannot sync directory of", dst);
+        ok = 0;
+    }
+    if (!ok && out >= 0) {
+        unlink(part);
+    }
+    if (ok) {
+        atomic_fetch_add(&batch->bytes, done);
+    }
+
+    free(src);
+    free(dst);
+    free(part);
+    return ok;
+}
+
+/*
+ * WORKERS - claim files in order (largest first) until none are left
+ */
+static void* batch_worker(void* arg) {
+    Batch* batch = (Batch*)arg;
+    uint8_t* chunk = (uint8_t*)malloc(CHUNK_SIZE);
+    if (!chunk) {
+        return NULL;
+    }
+
+    for (;;) {
+        size_t index = atomic_fetch_add(&batch->next, 1);
+        if (index >= batch->count) break;
+
+        const BatchFile* file = &batch->files[index];
+        if (process_file(batch, file, chunk)) {
+            record_done(batch, file);
+            atomic_fetch_add(&batch->processed, 1);
+        } else {
+            atomic_fetch_add(&batch->failed, 1);
+        }
+    }
+
+    // Plaintext of the last chunk
+    memset(chunk, 0, CHUNK_SIZE);
+    free(chunk);
+    return NULL;
+}
+
+static void print_usage(const char* program) {
+    printf("Usage: %s encrypt|decrypt <src_dir> <dst_dir> <key_file> [options]\n", program);
+    printf("Options:\n");
+    printf("  --threads N       Worker threads (default: one per online CPU)\n");
+    printf("  --manifest FILE   Finished-file list (default: <dst_dir>/%s)\n", MANIFEST_NAME);
+    printf("Example: %s encrypt /var/log/archive /backup/archive archive.key\n", program);
+    printf("Rerunning an interrupted command skips the files it already finished.\n");
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 5 || (strcmp(argv[1], "encrypt") != 0 && strcmp(argv[1], "decrypt") != 0)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    static Batch batch;
+    batch.encrypt = strcmp(argv[1], "encrypt") == 0;
+    batch.src_dir = argv[2];
+    batch.dst_dir = argv[3];
+    const char* key_file = argv[4];
+    const char* manifest_path = NULL;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (int i = 5; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--manifest") == 0 && i + 1 < argc) {
+            manifest_path = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+
+    batch.random = fopen("/dev/urandom", "rb");
+    if (!batch.random) {
+        fprintf(stderr, "ERROR: Cannot open /dev/urandom\n");
+        return 1;
+    }
+    pthread_mutex_init(&batch.lock, NULL);
+    kaos_init(&batch.cipher);
+
+    char* default_manifest = join_path(batch.dst_dir, MANIFEST_NAME, "");
+    if (!manifest_path) manifest_path = default_manifest;
+
+    printf("=== KAOS CIPHER - BATCH %s ===\n", batch.encrypt ? "ENCRYPTION" : "DECRYPTION");
+    printf("%s -> %s\n", batch.src_dir, batch.dst_dir);
+
+    int ok = default_manifest && load_or_create_key(&batch, key_file) &&
+             scan_dir(&batch, "") && open_manifest(&batch, manifest_path);
+    if (!ok) {
+        return 1;
+    }
+
+    // Drop finished files, then order the rest largest first
+    size_t resumed = 0, kept = 0;
+    for (size_t i = 0; i < batch.count; i++) {
+        if (already_done(&batch, &batch.files[i])) {
+            free(batch.files[i].rel);
+            resumed++;
+        } else {
+            batch.files[kept++] = batch.files[i];
+        }
+    }
+    batch.count = kept;
+    qsort(batch.files, batch.count, sizeof(BatchFile), compare_size_desc);
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < batch.count; i++) {
+        total += batch.files[i].size;
+    }
+    if ((size_t)threads > batch.count) threads = batch.count ? (long)batch.count : 1;
+    printf("Files: %zu to do (%llu bytes), %zu already done, %ld threads\n",
+           batch.count, (unsigned long long)total, resumed, threads);
+
+    // The main thread is worker 0
+    double start = now_seconds();
+    pthread_t workers[MAX_THREADS];
+    int started = 0;
+    for (long t = 1; t < threads; t++) {
+        if (pthread_create(&workers[started], NULL, batch_worker, &batch) == 0) {
+            started++;
+        }
+    }
+    batch_worker(&batch);
+    for (int t = 0; t < started; t++) {
+        pthread_join(workers[t], NULL);
+    }
+    double seconds = now_seconds() - start;
+
+    uint64_t bytes = atomic_load(&batch.bytes);
+    size_t processed = atomic_load(&batch.processed);
+    size_t failed = atomic_load(&batch.failed);
+    printf("%s %zu files, %llu bytes in %.2f s: %.1f MB/s on %d threads\n",
+           batch.encrypt ? "Encrypted" : "Decrypted", processed,
+           (unsigned long long)bytes, seconds, seconds > 0 ? bytes / seconds / 1e6 : 0.0,
+           started + 1);
+    if (failed > 0) {
+        printf("%zu files failed; rerun to retry them\n", failed);
+    }
+
+    fclose(batch.manifest);
+    fclose(batch.random);
+    for (size_t i = 0; i < batch.done_count; i++) {
+        free(batch.done[i]);
+    }
+    free(batch.done);
+    for (size_t i = 0; i < batch.count; i++) {
+        free(batch.files[i].rel);
+    }
+    free(batch.files);
+    free(default_manifest);
+    memset(batch.key, 0, KAOS_KEY_SIZE);
+    pthread_mutex_destroy(&batch.lock);
+
+    return failed > 0 || processed < batch.count ? 1 : 0;
+}
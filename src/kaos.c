@@ -8,8 +8,15 @@
  * Note: Uses only raw cryptographic keys
  * Key derivation (PBKDF2/Argon2) is EXTERNAL responsibility
  */
+
+/* Reference arithmetic - no FMA contraction even with -march=native */
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
  
-#include "kaos.h"
+#include "kaos_internal.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -20,34 +27,40 @@
  * Pure chaotic dynamics implementation
  */
 void lorenz_step(KaosCipher* cipher, double* x, double* y, double* z) {
-    double dx = cipher->sigma * (*y - *x) * cipher->dt;
-    double dy = (*x * (cipher->rho - *z) - *y) * cipher->dt;
-    double dz = (*x * *y - cipher->beta * *z) * cipher->dt;
-    
-    *x += dx;
-    *y += dy;
-    *z += dz;
+    // dx = sigma(y - x), dy = x(rho - z) - y, dz = xy - beta z (Euler step)
+    kaos_lorenz_inline(cipher, x, y, z);
 }
 
 /*
- * KEY & NONCE TO INITIAL STATE
- * Transforms 256-bit key + 96-bit nonce into initial conditions
- * Uses cryptographic mixing for sensitivity
+ * KEY MIXING - key-dependent half of kaos_key_to_state
+ * Mix key bytes (256 bits = 32 bytes) into three 64-bit accumulators
  */
-void kaos_key_to_state(const uint8_t* key_256bit, const uint8_t* nonce_96bit, 
-                       double* x, double* y, double* z) {
+static inline void kaos_mix_key(const uint8_t* key_256bit, uint64_t h[3]) {
     uint64_t h1 = 0, h2 = 0, h3 = 0;
     
-    // Mix key bytes (256 bits = 32 bytes)
     for (int i = 0; i < 32; i++) {
         h1 = ((h1 << 5) | (h1 >> 59)) ^ (key_256bit[i] * 0x9E3779B97F4A7C15ULL);
         h2 = ((h2 << 7) | (h2 >> 57)) ^ (key_256bit[i] * 0xBF58476D1CE4E5B9ULL);
         h3 = ((h3 << 11) | (h3 >> 53)) ^ (key_256bit[i] * 0x94D049BB133111EBULL);
     }
     
+    h[0] = h1;
+    h[1] = h2;
+    h[2] = h3;
+}
+
+/*
+ * NONCE MIXING - nonce-dependent half, from the key accumulators
+ */
+static inline void kaos_mix_nonce(const uint64_t h[3], const uint8_t* nonce_96bit,
+                                  double* x, double* y, double* z) {
+    uint64_t h1 = h[0], h2 = h[1], h3 = h[2];
+    
     // Mix nonce bytes (96 bits = 12 bytes)  
+    // Shift is done as a 32-bit int with the count taken mod 32, sign-extended
+    // into h1 (the reference semantics - a plain int shift by 33 is undefined)
     for (int i = 0; i < 12; i++) {
-        h1 ^= (nonce_96bit[i] << (i * 3));
+        h1 ^= (uint64_t)(int64_t)(int32_t)((uint32_t)nonce_96bit[i] << ((i * 3) & 31));
         h2 += (nonce_96bit[i] * (i + 1));
         h3 = ((h3 << 13) | (h3 >> 51)) ^ nonce_96bit[i];
     }
@@ -72,34 +85,273 @@ void kaos_key_to_state(const uint8_t* key_256bit, const uint8_t* nonce_96bit,
     if (*z == 0.0) *z = 0.5555555555555555;
 }
 
+/*
+ * KEY & NONCE TO INITIAL STATE
+ * Transforms 256-bit key + 96-bit nonce into initial conditions
+ * Uses cryptographic mixing for sensitivity
+ */
+void kaos_key_to_state(const uint8_t* key_256bit, const uint8_t* nonce_96bit, 
+                       double* x, double* y, double* z) {
+    KAOS_STATS_START(start);
+    uint64_t h[3];
+    kaos_mix_key(key_256bit, h);
+    kaos_mix_nonce(h, nonce_96bit, x, y, z);
+    KAOS_STATS_STOP(KAOS_PHASE_KEY_SETUP, start, 1, 0);
+}
+
+/*
+ * PREPARED KEY - key mixing done once, reused for every nonce
+ */
+void kaos_prepare_key(KaosPreparedKey* prepared, const uint8_t* key_256bit) {
+    kaos_mix_key(key_256bit, prepared->h);
+}
+
+void kaos_prepared_key_wipe(KaosPreparedKey* prepared) {
+    kaos_wipe(prepared, sizeof(KaosPreparedKey));
+}
+
+void kaos_key_to_state_prepared(const KaosPreparedKey* prepared, const uint8_t* nonce_96bit,
+                                double* x, double* y, double* z) {
+    KAOS_STATS_START(start);
+    kaos_mix_nonce(prepared->h, nonce_96bit, x, y, z);
+    KAOS_STATS_STOP(KAOS_PHASE_KEY_SETUP, start, 1, 0);
+}
+
+/*
+ * BATCH KEY SETUP - initial states for count (key, nonce) pairs
+ * Key mixing runs KAOS_SETUP_LANES keys interleaved (independent
+ * rotate/multiply chains overlap); a key pointer equal to the previous
+ * message's key reuses its accumulators
+ */
+#define KAOS_SETUP_LANES 4
+
+void kaos_key_to_state_batch(const uint8_t* const* keys, const uint8_t* const* nonces,
+                             size_t count, KaosState* states) {
+    KAOS_STATS_START(start);
+    const uint8_t* last_key = NULL;
+    uint64_t last_h[3] = { 0, 0, 0 };
+    
+    for (size_t base = 0; base < count; base += KAOS_SETUP_LANES) {
+        size_t lanes = count - base < KAOS_SETUP_LANES ? count - base : KAOS_SETUP_LANES;
+        uint64_t h1[KAOS_SETUP_LANES] = { 0 }, h2[KAOS_SETUP_LANES] = { 0 };
+        uint64_t h3[KAOS_SETUP_LANES] = { 0 };
+        const uint8_t* k[KAOS_SETUP_LANES];
+        
+        // Repeated keys (all lanes, common case) skip the key mix entirely
+        int fresh = 0;
+        for (size_t l = 0; l < KAOS_SETUP_LANES; l++) {
+            k[l] = keys[base + (l < lanes ? l : 0)];
+            fresh |= k[l] != last_key;
+        }
+        
+        if (fresh) {
+            for (int i = 0; i < 32; i++) {
+                for (size_t l = 0; l < KAOS_SETUP_LANES; l++) {
+                    h1[l] = ((h1[l] << 5) | (h1[l] >> 59)) ^ (k[l][i] * 0x9E3779B97F4A7C15ULL);
+                    h2[l] = ((h2[l] << 7) | (h2[l] >> 57)) ^ (k[l][i] * 0xBF58476D1CE4E5B9ULL);
+                    h3[l] = ((h3[l] << 11) | (h3[l] >> 53)) ^ (k[l][i] * 0x94D049BB133111EBULL);
+                }
+            }
+        } else {
+            for (size_t l = 0; l < KAOS_SETUP_LANES; l++) {
+                h1[l] = last_h[0];
+                h2[l] = last_h[1];
+                h3[l] = last_h[2];
+            }
+        }
+        
+        for (size_t l = 0; l < lanes; l++) {
+            uint64_t h[3] = { h1[l], h2[l], h3[l] };
+            KaosState* s = &states[base + l];
+            kaos_mix_nonce(h, nonces[base + l], &s->x, &s->y, &s->z);
+        }
+        
+        last_key = k[lanes - 1];
+        last_h[0] = h1[lanes - 1];
+        last_h[1] = h2[lanes - 1];
+        last_h[2] = h3[lanes - 1];
+    }
+    
+    kaos_wipe(last_h, sizeof(last_h));
+    KAOS_STATS_STOP(KAOS_PHASE_KEY_SETUP, start, count, 0);
+}
+
 /*
  * KEYSTREAM GENERATION - CORE INNOVATION
  * Combines chaotic state variables with mathematical constants
  * Non-linear post-processing
  */
 uint8_t kaos_keystream_byte(double x, double y, double z, uint64_t counter) {
-    // Mathematical constants for mixing
-    const double phi = 1.6180339887498948482;   // Golden ratio
-    const double e = 2.71828182845904523536;    // Euler's number
-    const double pi = 3.14159265358979323846;   // Pi
+    // phi/e/pi combination, counter perturbation, non-linear post-processing
+    return kaos_keystream_inline(x, y, z, counter);
+}
+
+/*
+ * FUSED KEYSTREAM BLOCK - public entry to the selected kernel
+ */
+void kaos_keystream_block(KaosCipher* cipher, KaosState* state, uint64_t counter,
+                          uint8_t* out, size_t length) {
+    KAOS_STATS_START(start);
+    kaos_active_kernel()->block(cipher, state, counter, out, length);
+    KAOS_STATS_STOP(KAOS_PHASE_KEYSTREAM, start, 1, length);
+}
+
+/*
+ * STATE SETUP - key+nonce to initial state plus warmup
+ * Shared by one-shot encryption, the streaming API and the state cache
+ */
+void kaos_warm_state(KaosCipher* cipher, const uint8_t* key_256bit,
+                     const uint8_t* nonce_96bit, KaosState* state) {
+    // Initialize chaotic system from key+nonce
+    kaos_key_to_state(key_256bit, nonce_96bit, &state->x, &state->y, &state->z);
+    kaos_warmup(cipher, state);
+}
+
+/*
+ * WARMUP - cipher->warmup Lorenz steps on an initial state
+ * Kept scalar: SLP vectorization packs x and y into one register and
+ * puts the shuffles on the step's dependency chain (~15% slower)
+ */
+#if defined(__GNUC__) && !defined(__clang__)
+__attribute__((optimize("fp-contract=off", "no-tree-slp-vectorize")))
+#endif
+void kaos_warmup(KaosCipher* cipher, KaosState* state) {
+    KAOS_STATS_START(start);
+    double x = state->x, y = state->y, z = state->z;
+    
+    // Warmup phase - Critical for chaos development (state in registers)
+    for (int i = 0; i < cipher->warmup; i++) {
+        kaos_lorenz_inline(cipher, &x, &y, &z);
+    }
     
-    // Core Lorenz combination
-    double combined = (x * phi) + (y * e) + (z * pi);
-    double fractional = fabs(combined) - floor(fabs(combined));
+    state->x = x;
+    state->y = y;
+    state->z = z;
+    KAOS_STATS_STOP(KAOS_PHASE_WARMUP, start, 1, 0);
+}
+
+/*
+ * KEYSTREAM XOR - REFERENCE
+ * Advances the state and XORs length bytes
+ * counter is the absolute stream position of in[0]
+ * in and out may alias (in-place operation)
+ */
+void kaos_stream_reference(KaosCipher* cipher, KaosState* state, uint64_t counter,
+                           const uint8_t* in, uint8_t* out, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        lorenz_step(cipher, &state->x, &state->y, &state->z);
+        uint8_t k_byte = kaos_keystream_byte(state->x, state->y, state->z, counter + i);
+        out[i] = in[i] ^ k_byte;
+    }
+}
+
+/* Reference raw keystream (fallback kernel) */
+void kaos_block_reference(KaosCipher* cipher, KaosState* state, uint64_t counter,
+                          uint8_t* out, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        lorenz_step(cipher, &state->x, &state->y, &state->z);
+        out[i] = kaos_keystream_byte(state->x, state->y, state->z, counter + i);
+    }
+}
+
+/* Reference batch lanes: each lane stepped on its own (fallback kernel) */
+void kaos_lanes_reference(KaosCipher* cipher, KaosLanes* lanes,
+                          const KaosLaneEmit* emit, size_t steps) {
+    for (int l = 0; l < KAOS_REFERENCE_LANES; l++) {
+        KaosState state = { lanes->x[l], lanes->y[l], lanes->z[l] };
+        if (emit->in[l]) {
+            kaos_stream_reference(cipher, &state, emit->counter[l], emit->in[l],
+                                  emit->out[l], steps);
+        } else {
+            for (size_t k = 0; k < steps; k++) {
+                lorenz_step(cipher, &state.x, &state.y, &state.z);
+            }
+        }
+        lanes->x[l] = state.x;
+        lanes->y[l] = state.y;
+        lanes->z[l] = state.z;
+    }
+}
+
+/*
+ * PORTABLE FUSED KERNELS - KAOS_KERNEL_SCALAR
+ */
+void kaos_stream_fused(KaosCipher* cipher, KaosState* state, uint64_t counter,
+                       const uint8_t* in, uint8_t* out, size_t length) {
+    kaos_xor_tiled(cipher, state, counter, in, out, length, kaos_xor_scalar);
+}
+
+void kaos_block_fused(KaosCipher* cipher, KaosState* state, uint64_t counter,
+                      uint8_t* out, size_t length) {
+    kaos_keystream_fused(cipher, state, counter, out, length);
+}
+
+/* Eight bytes per step through memcpy (no alignment or aliasing assumptions) */
+void kaos_xor_scalar(uint8_t* out, const uint8_t* in, const uint8_t* keystream,
+                     size_t length) {
+    size_t i = 0;
+    
+    for (; i + 8 <= length; i += 8) {
+        uint64_t a, k;
+        memcpy(&a, in + i, 8);
+        memcpy(&k, keystream + i, 8);
+        a ^= k;
+        memcpy(out + i, &a, 8);
+    }
+    for (; i < length; i++) {
+        out[i] = in[i] ^ keystream[i];
+    }
+}
+
+/*
+ * KEYSTREAM XOR - routed to the dispatcher's kernel
+ */
+void kaos_xor_keystream(KaosCipher* cipher, KaosState* state, uint64_t counter,
+                        const uint8_t* in, uint8_t* out, size_t length) {
+    kaos_active_kernel()->stream(cipher, state, counter, in, out, length);
+}
+
+/*
+ * XOR - routed to the dispatcher's vector kernel
+ */
+void kaos_xor_bytes(const uint8_t* in, const uint8_t* keystream, uint8_t* out,
+                    size_t length) {
+    KAOS_STATS_START(start);
+    kaos_active_kernel()->apply(out, in, keystream, length);
+    KAOS_STATS_STOP(KAOS_PHASE_XOR, start, 1, length);
+}
+
+/*
+ * Wipe sensitive state - volatile writes survive dead store elimination
+ */
+void kaos_wipe(void* ptr, size_t length) {
+    volatile uint8_t* p = (volatile uint8_t*)ptr;
+    while (length--) {
+        *p++ = 0;
+    }
+}
+
+/*
+ * ENCRYPTION INTO CALLER BUFFER - no allocation
+ * out may be the same buffer as in (in-place operation)
+ */
+int kaos_encrypt_into(KaosCipher* cipher, const uint8_t* in, uint8_t* out,
+                      size_t length, const uint8_t* key_256bit,
+                      const uint8_t* nonce_96bit) {
     
-    // Counter-based perturbation for uniqueness
-    double perturbation = counter * 0.0000001; // Small perturbation
-    fractional = fmod(fractional + perturbation, 1.0);
+    // Validate inputs
+    if (!cipher || !in || !out || !key_256bit || !nonce_96bit || length <= 0) {
+        return 0;
+    }
     
-    // Convert to byte
-    uint8_t byte = (uint8_t)(fractional * 256.0);
+    // Initialize chaotic system and run warmup
+    KaosState state;
+    kaos_warm_state(cipher, key_256bit, nonce_96bit, &state);
     
-    // Non-linear post-processing
-    byte = (byte + (counter & 0xFF)) & 0xFF;           // Avalanche enhancement
-    byte ^= (byte >> 4) ^ (byte << 3) ^ (counter % 97); // Non-linearity
-    byte = (byte * 167 + 123) & 0xFF;                  // Random walk
+    // Encryption - XOR with keystream
+    kaos_xor_keystream(cipher, &state, 0, in, out, length);
     
-    return byte;
+    return 1;
 }
 
 /* 
@@ -115,26 +367,16 @@ uint8_t* kaos_encrypt(KaosCipher* cipher, const uint8_t* plaintext,
         return NULL;
     }
     
-    // Initialize chaotic system from key+nonce
-    double x, y, z;
-    kaos_key_to_state(key_256bit, nonce_96bit, &x, &y, &z);
-    
-    // Warmup phase - Critical for chaos development
-    for (int i = 0; i < cipher->warmup; i++) {
-        lorenz_step(cipher, &x, &y, &z);
-    }
-    
-    // Allocate ciphertext buffer
-    uint8_t* ciphertext = (uint8_t*)malloc(length);
+    // Allocate ciphertext buffer (installed allocator)
+    uint8_t* ciphertext = (uint8_t*)kaos_alloc(length);
     if (!ciphertext) {
         return NULL;
     }
     
-    // Encryption - XOR with keystream
-    for (size_t i = 0; i < length; i++) {
-        lorenz_step(cipher, &x, &y, &z);
-        uint8_t k_byte = kaos_keystream_byte(x, y, z, i);
-        ciphertext[i] = plaintext[i] ^ k_byte;
+    if (!kaos_encrypt_into(cipher, plaintext, ciphertext, length,
+                           key_256bit, nonce_96bit)) {
+        kaos_free(ciphertext, length);
+        return NULL;
     }
     
     return ciphertext;
@@ -151,6 +393,44 @@ uint8_t* kaos_decrypt(KaosCipher* cipher, const uint8_t* ciphertext,
     return kaos_encrypt(cipher, ciphertext, length, key_256bit, nonce_96bit);
 }
 
+/*
+ * DECRYPTION INTO CALLER BUFFER - identical to kaos_encrypt_into
+ */
+int kaos_decrypt_into(KaosCipher* cipher, const uint8_t* in, uint8_t* out,
+                      size_t length, const uint8_t* key_256bit,
+                      const uint8_t* nonce_96bit) {
+    // XOR symmetry - identical operation
+    return kaos_encrypt_into(cipher, in, out, length, key_256bit, nonce_96bit);
+}
+
+/*
+ * PREPARED-KEY ENCRYPTION - only the nonce is mixed per message
+ */
+int kaos_encrypt_prepared(KaosCipher* cipher, const uint8_t* in, uint8_t* out,
+                          size_t length, const KaosPreparedKey* prepared,
+                          const uint8_t* nonce_96bit) {
+    
+    // Validate inputs
+    if (!cipher || !in || !out || !prepared || !nonce_96bit || length <= 0) {
+        return 0;
+    }
+    
+    KaosState state;
+    kaos_key_to_state_prepared(prepared, nonce_96bit, &state.x, &state.y, &state.z);
+    kaos_warmup(cipher, &state);
+    
+    kaos_xor_keystream(cipher, &state, 0, in, out, length);
+    
+    return 1;
+}
+
+int kaos_decrypt_prepared(KaosCipher* cipher, const uint8_t* in, uint8_t* out,
+                          size_t length, const KaosPreparedKey* prepared,
+                          const uint8_t* nonce_96bit) {
+    // XOR symmetry - identical operation
+    return kaos_encrypt_prepared(cipher, in, out, length, prepared, nonce_96bit);
+}
+
 /*
  * INITIALIZATION - SECURE DEFAULTS ONLY
  * Parameters optimized and validated for cryptographic security
@@ -163,3 +443,193 @@ void kaos_init(KaosCipher* cipher) {
     cipher->dt = 0.01;           // Time step - VALIDATED
     cipher->warmup = KAOS_WARMUP_DEFAULT;  // Warmup iterations - VALIDATED
 }
+
+/*
+ * STREAMING CONTEXT - incremental encryption
+ * struct KaosStream is defined in kaos_internal.h (shared with kaos_index.c)
+ */
+
+/*
+ * Streaming context from an already warmed state (state cache path)
+ */
+KaosStream* kaos_stream_from_state(KaosCipher* cipher, const KaosState* state) {
+    KaosStream* stream = (KaosStream*)malloc(sizeof(KaosStream));
+    if (!stream) {
+        return NULL;
+    }
+    
+    stream->cipher = *cipher;
+    stream->state = *state;
+    stream->origin = *state;
+    stream->counter = 0;
+    stream->index = NULL;
+    
+    return stream;
+}
+
+KaosStream* kaos_stream_init(KaosCipher* cipher, const uint8_t* key_256bit,
+                             const uint8_t* nonce_96bit) {
+    // Validate inputs
+    if (!cipher || !key_256bit || !nonce_96bit) {
+        return NULL;
+    }
+    
+    // Key setup and warmup happen once per stream
+    KaosState state;
+    kaos_warm_state(cipher, key_256bit, nonce_96bit, &state);
+    
+    KaosStream* stream = kaos_stream_from_state(cipher, &state);
+    kaos_wipe(&state, sizeof(state));
+    
+    return stream;
+}
+
+/* Keystream XOR, or raw keystream when in is NULL */
+static void kaos_stream_run(KaosStream* stream, const uint8_t* in, uint8_t* out,
+                            size_t length) {
+    if (in) {
+        kaos_xor_keystream(&stream->cipher, &stream->state, stream->counter, in, out, length);
+    } else {
+        kaos_keystream_block(&stream->cipher, &stream->state, stream->counter, out, length);
+    }
+}
+
+static int kaos_stream_advance(KaosStream* stream, const uint8_t* in, uint8_t* out,
+                               size_t length) {
+    if (!stream->index) {
+        kaos_stream_run(stream, in, out, length);
+        stream->counter += length;
+        return 1;
+    }
+    
+    // Reserve every checkpoint this update can cross before writing output
+    if (!kaos_index_reserve(stream->index, stream->counter + length)) {
+        return 0;
+    }
+    
+    // Split at checkpoint boundaries, recording the state at each one
+    uint64_t interval = kaos_index_interval(stream->index);
+    while (length > 0) {
+        kaos_index_record(stream->index, stream->counter, &stream->state);
+        
+        size_t n = (size_t)(interval - stream->counter % interval);
+        if (n > length) n = length;
+        
+        kaos_stream_run(stream, in, out, n);
+        stream->counter += n;
+        if (in) in += n;
+        out += n;
+        length -= n;
+    }
+    
+    return 1;
+}
+
+int kaos_stream_update(KaosStream* stream, const uint8_t* in, uint8_t* out,
+                       size_t length) {
+    if (!stream || (length > 0 && (!in || !out))) {
+        return 0;
+    }
+    
+    return kaos_stream_advance(stream, in, out, length);
+}
+
+int kaos_stream_keystream(KaosStream* stream, uint8_t* out, size_t length) {
+    if (!stream || (length > 0 && !out)) {
+        return 0;
+    }
+    
+    return kaos_stream_advance(stream, NULL, out, length);
+}
+
+/*
+ * SCATTER-GATHER - iovec chains through one stream
+ */
+/* Total length of a segment chain; 0 on a malformed chain */
+static int kaos_iov_total(const struct iovec* iov, int count, size_t* total) {
+    if (count < 0 || (count > 0 && !iov)) {
+        return 0;
+    }
+    
+    *total = 0;
+    for (int i = 0; i < count; i++) {
+        if ((iov[i].iov_len > 0 && !iov[i].iov_base) || iov[i].iov_len > SIZE_MAX - *total) {
+            return 0;
+        }
+        *total += iov[i].iov_len;
+    }
+    return 1;
+}
+
+int kaos_encryptv(KaosStream* stream, const struct iovec* in, int n_in,
+                  struct iovec* out, int n_out) {
+    size_t in_total, out_total;
+    if (!stream || !kaos_iov_total(in, n_in, &in_total) ||
+        !kaos_iov_total(out, n_out, &out_total) || out_total < in_total) {
+        return 0;
+    }
+    if (in_total == 0) {
+        return 1;
+    }
+    
+    // Reserve the index for the whole chain up front so a failure cannot
+    // leave out partly written and the stream advanced
+    if (stream->index && !kaos_index_reserve(stream->index, stream->counter + in_total)) {
+        return 0;
+    }
+    
+    // One tile of keystream is generated, then applied across however many
+    // fragments it covers, so 1-byte segments cost an XOR call, not a kernel run
+    _Alignas(64) uint8_t tile[KAOS_TILE_SIZE];
+    size_t used = in_total < KAOS_TILE_SIZE ? in_total : KAOS_TILE_SIZE;
+    int i = 0, o = 0;
+    size_t in_offset = 0, out_offset = 0;
+    size_t remaining = in_total;
+    
+    while (remaining > 0) {
+        size_t n = remaining < KAOS_TILE_SIZE ? remaining : KAOS_TILE_SIZE;
+        if (!kaos_stream_advance(stream, NULL, tile, n)) {
+            kaos_wipe(tile, used);
+            return 0;
+        }
+        
+        for (size_t done = 0; done < n; ) {
+            while (in_offset == in[i].iov_len) { i++; in_offset = 0; }
+            while (out_offset == out[o].iov_len) { o++; out_offset = 0; }
+            
+            size_t run = n - done;
+            if (run > in[i].iov_len - in_offset) run = in[i].iov_len - in_offset;
+            if (run > out[o].iov_len - out_offset) run = out[o].iov_len - out_offset;
+            
+            kaos_xor_bytes((const uint8_t*)in[i].iov_base + in_offset, tile + done,
+                           (uint8_t*)out[o].iov_base + out_offset, run);
+            in_offset += run;
+            out_offset += run;
+            done += run;
+        }
+        remaining -= n;
+    }
+    
+    // Keystream is key-equivalent
+    kaos_wipe(tile, used);
+    return 1;
+}
+
+int kaos_decryptv(KaosStream* stream, const struct iovec* in, int n_in,
+                  struct iovec* out, int n_out) {
+    return kaos_encryptv(stream, in, n_in, out, n_out);
+}
+
+uint64_t kaos_stream_position(const KaosStream* stream) {
+    return stream ? stream->counter : 0;
+}
+
+void kaos_stream_final(KaosStream* stream) {
+    if (!stream) {
+        return;
+    }
+    
+    // Chaotic state is key-equivalent material
+    kaos_wipe(stream, sizeof(KaosStream));
+    free(stream);
+}
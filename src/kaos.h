@@ -11,12 +11,20 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <sys/uio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /* Cryptographic constants */
 #define KAOS_KEY_SIZE 32      // 256 bits
 #define KAOS_NONCE_SIZE 12    // 96 bits  
 #define KAOS_WARMUP_DEFAULT 5000
 
+/* Fused keystream block size (bytes) */
+#define KAOS_BLOCK_SIZE 64
+
 /* Cipher parameters structure */
 typedef struct {
     double sigma;      // 10.0 - Prandtl number (FIXED)
@@ -26,6 +34,11 @@ typedef struct {
     int warmup;        // Warmup iterations (FIXED)
 } KaosCipher;
 
+/* Lorenz system state */
+typedef struct {
+    double x, y, z;
+} KaosState;
+
 /* Core API Functions */
 
 /**
@@ -37,7 +50,8 @@ void kaos_init(KaosCipher* cipher);
 /**
  * Encrypt plaintext using 256-bit key and 96-bit nonce
  * Returns allocated ciphertext buffer or NULL on error
- * Caller must free() the returned buffer
+ * Caller must release it with kaos_free(buffer, length)
+ * (free() is enough while the default allocator is installed)
  */
 uint8_t* kaos_encrypt(KaosCipher* cipher, const uint8_t* plaintext, 
                       size_t length, const uint8_t* key_256bit, 
@@ -46,17 +60,50 @@ uint8_t* kaos_encrypt(KaosCipher* cipher, const uint8_t* plaintext,
 /**
  * Decrypt ciphertext (identical to encryption due to XOR symmetry)
  * Returns allocated plaintext buffer or NULL on error  
- * Caller must free() the returned buffer
+ * Caller must release it with kaos_free(buffer, length)
  */
 uint8_t* kaos_decrypt(KaosCipher* cipher, const uint8_t* ciphertext, 
                       size_t length, const uint8_t* key_256bit, 
                       const uint8_t* nonce_96bit);
 
+/**
+ * Encrypt into caller-owned buffer (no allocation)
+ * out must hold length bytes; out == in encrypts in place
+ * Returns 1 on success, 0 on error
+ */
+int kaos_encrypt_into(KaosCipher* cipher, const uint8_t* in, uint8_t* out,
+                      size_t length, const uint8_t* key_256bit,
+                      const uint8_t* nonce_96bit);
+
+/**
+ * Decrypt into caller-owned buffer (identical to kaos_encrypt_into)
+ * Returns 1 on success, 0 on error
+ */
+int kaos_decrypt_into(KaosCipher* cipher, const uint8_t* in, uint8_t* out,
+                      size_t length, const uint8_t* key_256bit,
+                      const uint8_t* nonce_96bit);
+
 /**
  * Generate single keystream byte
  */
 uint8_t kaos_keystream_byte(double x, double y, double z, uint64_t counter);
 
+/**
+ * Fused keystream block - advances state length times and writes
+ * length raw keystream bytes for positions counter .. counter+length-1
+ * Bit-exact with lorenz_step + kaos_keystream_byte per byte
+ * Typical use: length = KAOS_BLOCK_SIZE
+ */
+void kaos_keystream_block(KaosCipher* cipher, KaosState* state, uint64_t counter,
+                          uint8_t* out, size_t length);
+
+/**
+ * out[i] = in[i] ^ keystream[i] with the dispatcher's vector XOR kernel
+ * Second phase of generate-then-XOR; no alignment needed, out may equal in
+ */
+void kaos_xor_bytes(const uint8_t* in, const uint8_t* keystream, uint8_t* out,
+                    size_t length);
+
 /**
  * Lorenz system step - core chaotic dynamics
  */
@@ -68,4 +115,820 @@ void lorenz_step(KaosCipher* cipher, double* x, double* y, double* z);
 void kaos_key_to_state(const uint8_t* key_256bit, const uint8_t* nonce_96bit, 
                        double* x, double* y, double* z);
 
+/* Allocator hooks - where returned data buffers come from */
+
+/* alloc returns NULL on failure; free receives the size passed to alloc */
+typedef struct {
+    void* (*alloc)(void* context, size_t size);
+    void (*free)(void* context, void* ptr, size_t size);
+    void* context;
+} KaosAllocator;
+
+/**
+ * Install the allocator used for buffers returned by kaos_encrypt and
+ * kaos_decrypt and by kaos_alloc (NULL restores malloc/free)
+ * Not thread-safe: install before other threads use the library, and
+ * release buffers with the allocator that returned them
+ * Returns 1 on success, 0 on error
+ */
+int kaos_set_allocator(const KaosAllocator* allocator);
+
+/**
+ * Currently installed allocator
+ */
+void kaos_get_allocator(KaosAllocator* allocator);
+
+/**
+ * size bytes from the installed allocator, or NULL on error
+ */
+void* kaos_alloc(size_t size);
+
+/**
+ * Release a buffer from kaos_alloc / kaos_encrypt / kaos_decrypt
+ */
+void kaos_free(void* ptr, size_t size);
+
+/**
+ * Per-thread bump arena: every thread bumps through its own blocks of
+ * block_size bytes (0 = 1 MiB; larger requests get a block of their own),
+ * 64-byte aligned. free is a no-op; kaos_arena_reset() releases the
+ * calling thread's allocations at the end of a request. Blocks are
+ * returned to the system when the thread exits
+ */
+void kaos_arena_allocator(KaosAllocator* allocator, size_t block_size);
+
+/**
+ * Release everything the calling thread allocated from its arena
+ * (its first block is kept for the next request)
+ */
+void kaos_arena_reset(void);
+
+/**
+ * Bytes handed out by the calling thread's arena since the last reset
+ */
+size_t kaos_arena_used(void);
+
+/**
+ * Large-buffer allocator: requests of 2 MiB and more are mapped 2 MiB
+ * aligned with transparent huge pages requested (madvise MADV_HUGEPAGE)
+ * and touched page by page by the allocating thread, so page faults
+ * happen here rather than in the keystream loop. Smaller requests use
+ * malloc
+ */
+void kaos_hugepage_allocator(KaosAllocator* allocator);
+
+/* Prepared keys - key mixing done once for many nonces */
+
+/**
+ * Key-dependent half of kaos_key_to_state (treat as opaque)
+ * Key-equivalent material: wipe with kaos_prepared_key_wipe()
+ */
+typedef struct {
+    uint64_t h[3];
+} KaosPreparedKey;
+
+/**
+ * Mix the 256-bit key once; reuse the result for every nonce
+ */
+void kaos_prepare_key(KaosPreparedKey* prepared, const uint8_t* key_256bit);
+
+/**
+ * Zeroize a prepared key
+ */
+void kaos_prepared_key_wipe(KaosPreparedKey* prepared);
+
+/**
+ * kaos_key_to_state from a prepared key - only the nonce is mixed
+ * Bit-identical to kaos_key_to_state with the original key
+ */
+void kaos_key_to_state_prepared(const KaosPreparedKey* prepared,
+                                const uint8_t* nonce_96bit,
+                                double* x, double* y, double* z);
+
+/**
+ * Initial states for count (key, nonce) pairs: states[i] equals
+ * kaos_key_to_state(keys[i], nonces[i]). Key mixing runs several
+ * keys interleaved and is skipped when keys[i] == keys[i - 1]
+ */
+void kaos_key_to_state_batch(const uint8_t* const* keys, const uint8_t* const* nonces,
+                             size_t count, KaosState* states);
+
+/**
+ * Encrypt into caller-owned buffer with a prepared key
+ * Same output as kaos_encrypt_into with the original key
+ * Returns 1 on success, 0 on error
+ */
+int kaos_encrypt_prepared(KaosCipher* cipher, const uint8_t* in, uint8_t* out,
+                          size_t length, const KaosPreparedKey* prepared,
+                          const uint8_t* nonce_96bit);
+
+/**
+ * Decrypt with a prepared key (identical to kaos_encrypt_prepared)
+ * Returns 1 on success, 0 on error
+ */
+int kaos_decrypt_prepared(KaosCipher* cipher, const uint8_t* in, uint8_t* out,
+                          size_t length, const KaosPreparedKey* prepared,
+                          const uint8_t* nonce_96bit);
+
+/* Streaming API - incremental encryption in constant memory */
+
+/* Opaque streaming context */
+typedef struct KaosStream KaosStream;
+
+/**
+ * Create streaming context for 256-bit key and 96-bit nonce
+ * Key setup and warmup run once here, not per update
+ * Returns allocated context or NULL on error
+ * Caller must release it with kaos_stream_final()
+ */
+KaosStream* kaos_stream_init(KaosCipher* cipher, const uint8_t* key_256bit,
+                             const uint8_t* nonce_96bit);
+
+/**
+ * Encrypt/decrypt the next length bytes of the stream
+ * Any split of the input gives the same bytes as one kaos_encrypt call
+ * in and out may point to the same buffer
+ * Returns 1 on success, 0 on error
+ */
+int kaos_stream_update(KaosStream* stream, const uint8_t* in, uint8_t* out,
+                       size_t length);
+
+/**
+ * Write the next length raw keystream bytes and advance the stream
+ * (generate phase only; apply later with kaos_xor_bytes)
+ * Returns 1 on success, 0 on error
+ */
+int kaos_stream_keystream(KaosStream* stream, uint8_t* out, size_t length);
+
+/**
+ * Encrypt the concatenation of the n_in segments of in into the n_out
+ * segments of out, continuing the stream (scatter-gather, no coalescing)
+ * Segment sizes are arbitrary and the two chains may split differently;
+ * the result equals kaos_stream_update over the concatenated buffers
+ * out must hold at least as many bytes as in; segments may alias only
+ * at the same stream position (in place)
+ * Returns 1 on success, 0 on error (nothing is written)
+ */
+int kaos_encryptv(KaosStream* stream, const struct iovec* in, int n_in,
+                  struct iovec* out, int n_out);
+
+/**
+ * Scatter-gather decryption (identical to kaos_encryptv)
+ * Returns 1 on success, 0 on error
+ */
+int kaos_decryptv(KaosStream* stream, const struct iovec* in, int n_in,
+                  struct iovec* out, int n_out);
+
+/**
+ * Number of bytes processed by the stream so far
+ */
+uint64_t kaos_stream_position(const KaosStream* stream);
+
+/**
+ * Wipe chaotic state and release streaming context
+ */
+void kaos_stream_final(KaosStream* stream);
+
+/* File API - memory-mapped encryption, no read/write copies */
+
+#define KAOS_FILE_WINDOW (64u << 20)  // Default bytes mapped at a time
+
+/**
+ * Encrypt the file at in_path into out_path (created or truncated)
+ * through memory mappings: the output is sized with ftruncate and the
+ * keystream is XORed straight from the input mapping into the output
+ * mapping, window bytes at a time (0 = KAOS_FILE_WINDOW, rounded up to
+ * pages), so files larger than RAM work. Same bytes as kaos_encrypt
+ * over the whole file. Other processes must not truncate either file
+ * meanwhile (SIGBUS); the output is not fsynced
+ * Returns 1 on success, 0 on error
+ */
+int kaos_encrypt_file(KaosCipher* cipher, const char* in_path, const char* out_path,
+                      const uint8_t* key_256bit, const uint8_t* nonce_96bit,
+                      size_t window);
+
+/**
+ * Decrypt a file into another (identical to kaos_encrypt_file)
+ * Returns 1 on success, 0 on error
+ */
+int kaos_decrypt_file(KaosCipher* cipher, const char* in_path, const char* out_path,
+                      const uint8_t* key_256bit, const uint8_t* nonce_96bit,
+                      size_t window);
+
+/**
+ * Encrypt the file at path in place through one shared writable
+ * mapping per window (window as for kaos_encrypt_file). An error
+ * part-way leaves the file partly encrypted
+ * Returns 1 on success, 0 on error
+ */
+int kaos_encrypt_file_inplace(KaosCipher* cipher, const char* path,
+                              const uint8_t* key_256bit, const uint8_t* nonce_96bit,
+                              size_t window);
+
+/**
+ * Decrypt a file in place (identical to kaos_encrypt_file_inplace)
+ * Returns 1 on success, 0 on error
+ */
+int kaos_decrypt_file_inplace(KaosCipher* cipher, const char* path,
+                              const uint8_t* key_256bit, const uint8_t* nonce_96bit,
+                              size_t window);
+
+/* Descriptor pipeline - reads, encryption and writes overlapped */
+
+/* I/O engine of the pipeline */
+typedef enum {
+    KAOS_IO_AUTO = 0,     // io_uring when the kernel allows it, else threads
+    KAOS_IO_URING,        // io_uring only (error if unavailable)
+    KAOS_IO_THREADS       // Reader and writer threads, pread/pwrite
+} KaosIoBackend;
+
+/* Pipeline settings (zeroed = defaults) */
+typedef struct {
+    size_t chunk_size;        // Bytes per buffer (0 = 1 MiB, rounded up to pages)
+    int depth;                // Buffers in flight (0 = 4, at least 3)
+    KaosIoBackend backend;
+} KaosPipelineOptions;
+
+/* What a pipeline run did */
+typedef struct {
+    KaosIoBackend backend;    // Engine that ran
+    int registered_buffers;   // io_uring: buffers registered with the ring
+    int fixed_files;          // io_uring: descriptors registered with the ring
+    uint64_t bytes;           // Bytes encrypted
+    uint64_t chunks;          // Buffers encrypted
+    uint64_t stalls;          // Times the encrypting thread had no chunk ready
+    double stall_seconds;     // Time it spent waiting for I/O
+} KaosPipelineStats;
+
+/**
+ * Encrypt everything readable from in_fd into out_fd with depth chunk
+ * buffers in flight: while chunk N+1 is encrypted, chunk N is being
+ * written and chunk N+2 read. Regular files are read and written at
+ * explicit offsets from their current positions (left after the data);
+ * pipes and sockets are read and written in order. Same bytes as
+ * kaos_encrypt over the whole input. options and stats may be NULL
+ * Returns 1 on success, 0 on error
+ */
+int kaos_encrypt_fd(KaosCipher* cipher, int in_fd, int out_fd,
+                    const uint8_t* key_256bit, const uint8_t* nonce_96bit,
+                    const KaosPipelineOptions* options, KaosPipelineStats* stats);
+
+/**
+ * Decrypt through the pipeline (identical to kaos_encrypt_fd)
+ * Returns 1 on success, 0 on error
+ */
+int kaos_decrypt_fd(KaosCipher* cipher, int in_fd, int out_fd,
+                    const uint8_t* key_256bit, const uint8_t* nonce_96bit,
+                    const KaosPipelineOptions* options, KaosPipelineStats* stats);
+
+/**
+ * Short name of a pipeline backend ("auto", "io_uring", "threads")
+ */
+const char* kaos_io_backend_name(KaosIoBackend backend);
+
+/* KAOS-P segmented mode - one large message on many cores */
+
+/* Container format */
+#define KAOS_P_VERSION 1
+#define KAOS_P_MODE_SEGMENTED 1
+#define KAOS_P_HEADER_SIZE 32              // Header bytes before the ciphertext
+#define KAOS_P_SEGMENT_DEFAULT (1u << 20)  // 1 MiB segments
+
+/* Parsed container header */
+typedef struct {
+    uint8_t version;                 // KAOS_P_VERSION
+    uint8_t mode;                    // KAOS_P_MODE_SEGMENTED
+    uint32_t segment_size;           // Bytes per segment (last may be shorter)
+    uint64_t length;                 // Plaintext length
+    uint8_t nonce[KAOS_NONCE_SIZE];  // Message nonce
+} KaosPHeader;
+
+/**
+ * Container size for a length-byte message (header + ciphertext)
+ */
+size_t kaos_p_container_size(size_t length);
+
+/**
+ * Nonce of segment index: message nonce with bytes 4..11 XORed with a
+ * 64-bit mix of index + 1 (segment 0 never reuses the message nonce)
+ * Each segment is a plain KAOS stream under (key, segment nonce)
+ */
+void kaos_p_segment_nonce(const uint8_t* nonce_96bit, uint64_t index,
+                          uint8_t* segment_nonce);
+
+/**
+ * Encrypt into a KAOS-P container; segments are warmed up and encrypted
+ * independently on threads threads (0 = one per online CPU)
+ * out must hold kaos_p_container_size(length) bytes
+ * segment_size 0 selects KAOS_P_SEGMENT_DEFAULT
+ * Output does not depend on the thread count
+ * Returns 1 on success, 0 on error
+ */
+int kaos_p_encrypt(KaosCipher* cipher, const uint8_t* in, size_t length,
+                   uint8_t* out, size_t out_capacity,
+                   const uint8_t* key_256bit, const uint8_t* nonce_96bit,
+                   uint32_t segment_size, int threads);
+
+/**
+ * Parse and validate a container header
+ * Returns 1 on success, 0 on malformed or unsupported container
+ */
+int kaos_p_parse_header(const uint8_t* container, size_t container_length,
+                        KaosPHeader* header);
+
+/**
+ * Decrypt a KAOS-P container in parallel (threads as in kaos_p_encrypt)
+ * out must hold header.length bytes
+ * Returns 1 on success, 0 on error
+ */
+int kaos_p_decrypt(KaosCipher* cipher, const uint8_t* container,
+                   size_t container_length, uint8_t* out, size_t out_capacity,
+                   const uint8_t* key_256bit, int threads);
+
+/* Checkpoint index - random access into a keystream */
+
+/* Serialized index layout: header, then one entry per checkpoint */
+#define KAOS_INDEX_HEADER_SIZE 24   // "KIDX", version, interval, reserved, count
+#define KAOS_INDEX_ENTRY_SIZE 24    // x, y, z as little-endian IEEE-754 doubles
+
+/* Opaque list of Lorenz states recorded every interval bytes */
+typedef struct KaosIndex KaosIndex;
+
+/**
+ * Create an empty index with one checkpoint every interval bytes
+ * Larger intervals give a smaller index, smaller ones a faster seek
+ * (a seek replays at most interval - 1 Lorenz steps)
+ * Returns allocated index or NULL on error
+ * Caller must release it with kaos_index_free()
+ */
+KaosIndex* kaos_index_new(uint32_t interval);
+
+/**
+ * Wipe checkpoints and release the index
+ */
+void kaos_index_free(KaosIndex* index);
+
+/**
+ * Checkpoint spacing in bytes
+ */
+uint32_t kaos_index_interval(const KaosIndex* index);
+
+/**
+ * Number of checkpoints recorded (checkpoint i is at byte i * interval)
+ */
+uint64_t kaos_index_count(const KaosIndex* index);
+
+/**
+ * Serialize the index into out (capacity bytes)
+ * Checkpoints are key-equivalent: store the index as secretly as the key
+ * Returns bytes required; nothing is written if out is NULL or too small
+ */
+size_t kaos_index_serialize(const KaosIndex* index, uint8_t* out, size_t capacity);
+
+/**
+ * Rebuild an index from kaos_index_serialize output
+ * Returns allocated index or NULL on malformed input
+ */
+KaosIndex* kaos_index_deserialize(const uint8_t* data, size_t length);
+
+/**
+ * Attach index to stream (NULL detaches); the stream does not own it
+ * While attached, updates and seeks append checkpoints as they pass
+ * them and seeks restore the nearest recorded checkpoint
+ * The index must come from the same cipher parameters, key and nonce
+ * Returns 1 on success, 0 on error
+ */
+int kaos_stream_attach_index(KaosStream* stream, KaosIndex* index);
+
+/**
+ * Move the stream to byte offset (forward or backward)
+ * Restores the closest checkpoint at or before offset and replays
+ * the remaining Lorenz steps without generating keystream
+ * Returns 1 on success, 0 on error
+ */
+int kaos_seek(KaosStream* stream, uint64_t offset);
+
+/* Indexed container - self-describing file with byte-range decryption */
+
+/* Container format */
+#define KAOS_CONTAINER_VERSION 1
+#define KAOS_CONTAINER_MODE_INDEXED 2             // KAOS-P containers are mode 1
+#define KAOS_CONTAINER_HEADER_SIZE 32             // Header bytes before the ciphertext
+#define KAOS_CONTAINER_FOOTER_SIZE 16             // Plaintext length, index size
+#define KAOS_CONTAINER_CHUNK_DEFAULT (64u << 10)  // Bytes between checkpoints
+
+/* Opaque reader over an open container descriptor */
+typedef struct KaosContainer KaosContainer;
+
+/**
+ * Encrypt everything readable from in_fd into a container on out_fd:
+ * header (magic, version, mode, chunk size, nonce), ciphertext, the
+ * Lorenz state at every chunk boundary (encrypted under a nonce derived
+ * from nonce_96bit), then the footer. Written front to back, so out_fd
+ * may be a pipe. chunk_size 0 = KAOS_CONTAINER_CHUNK_DEFAULT
+ * Returns 1 on success, 0 on error
+ */
+int kaos_container_encrypt_fd(KaosCipher* cipher, int in_fd, int out_fd,
+                              const uint8_t* key_256bit, const uint8_t* nonce_96bit,
+                              uint32_t chunk_size);
+
+/**
+ * Open a container for range reads; fd must support pread and stays
+ * owned by the caller. Reads the header, footer and checkpoint table
+ * (one warmup to decrypt the table; a wrong key fails here)
+ * Returns allocated reader or NULL on error
+ * Caller must release it with kaos_container_free()
+ */
+KaosContainer* kaos_container_open(KaosCipher* cipher, int fd, const uint8_t* key_256bit);
+
+/**
+ * Wipe the checkpoints and stream state and release the reader
+ */
+void kaos_container_free(KaosContainer* container);
+
+/**
+ * Plaintext length of the container
+ */
+uint64_t kaos_container_length(const KaosContainer* container);
+
+/**
+ * Decrypt plaintext bytes [offset, offset + length) into out
+ * Starts from the nearest checkpoint at or before offset (at most
+ * chunk_size - 1 Lorenz steps replayed), or continues from the end of
+ * the previous read when that is closer; sequential reads replay nothing
+ * One thread at a time per reader
+ * Returns 1 on success, 0 on error or a range past the end
+ */
+int kaos_container_pread(KaosContainer* container, uint64_t offset, size_t length,
+                         uint8_t* out);
+
+/* State cache - warmed states reused across calls with the same key+nonce */
+
+/* Opaque bounded LRU cache (thread-safe) */
+typedef struct KaosCache KaosCache;
+
+/* Cache counters */
+typedef struct {
+    uint64_t hits;           // Lookups served from the cache
+    uint64_t misses;         // Lookups that ran key setup + warmup
+    uint64_t evictions;      // Least recently used entries dropped
+    size_t entries;          // Entries currently stored
+    size_t capacity;         // Maximum number of entries
+} KaosCacheStats;
+
+/**
+ * Create a cache holding at most capacity warmed states
+ * Entries are indexed by a keyed hash of key || nonce (random secret per
+ * cache); raw keys are never stored
+ * Returns allocated cache or NULL on error
+ * Caller must release it with kaos_cache_free()
+ */
+KaosCache* kaos_cache_new(size_t capacity);
+
+/**
+ * Wipe every entry and release the cache
+ */
+void kaos_cache_free(KaosCache* cache);
+
+/**
+ * Drop the entry for key+nonce (e.g. after key rotation)
+ * Returns 1 if an entry was removed, 0 otherwise
+ */
+int kaos_cache_invalidate(KaosCache* cache, const uint8_t* key_256bit,
+                          const uint8_t* nonce_96bit);
+
+/**
+ * Wipe and drop every entry (counters are kept)
+ */
+void kaos_cache_clear(KaosCache* cache);
+
+/**
+ * Snapshot of the cache counters
+ */
+void kaos_cache_stats(KaosCache* cache, KaosCacheStats* stats);
+
+/**
+ * Decrypt into caller-owned buffer, reusing the warmed state for
+ * key+nonce when cached (identical output to kaos_decrypt_into)
+ * Returns 1 on success, 0 on error
+ */
+int kaos_decrypt_cached(KaosCipher* cipher, KaosCache* cache,
+                        const uint8_t* in, uint8_t* out, size_t length,
+                        const uint8_t* key_256bit, const uint8_t* nonce_96bit);
+
+/**
+ * kaos_stream_init through the state cache
+ * Returns allocated context or NULL on error
+ */
+KaosStream* kaos_stream_init_cached(KaosCipher* cipher, KaosCache* cache,
+                                    const uint8_t* key_256bit,
+                                    const uint8_t* nonce_96bit);
+
+/* Batch API - many independent messages advanced in lockstep */
+
+/* One message of a batch (in == out allowed) */
+typedef struct {
+    const uint8_t* in;       // Plaintext (or ciphertext)
+    uint8_t* out;            // Output buffer, length bytes
+    size_t length;           // Message length in bytes
+    const uint8_t* key;      // 256-bit key
+    const uint8_t* nonce;    // 96-bit nonce
+} KaosMessage;
+
+/**
+ * Encrypt count independent messages
+ * Uses SIMD lanes (AVX2: 4, AVX-512: 8 streams) when available,
+ * otherwise interleaves 2-8 scalar streams per loop body
+ * Each message is bit-identical to kaos_encrypt_into on its own
+ * Returns 1 on success, 0 on error (no output written)
+ */
+int kaos_encrypt_batch(KaosCipher* cipher, KaosMessage* msgs, size_t count);
+
+/**
+ * Decrypt count independent messages (identical to kaos_encrypt_batch)
+ * Returns 1 on success, 0 on error
+ */
+int kaos_decrypt_batch(KaosCipher* cipher, KaosMessage* msgs, size_t count);
+
+/**
+ * Streams per loop body of the interleaved scalar batch engine
+ * Used when no vector kernel is available (or KAOS_KERNEL_SCALAR is forced)
+ * width must be 2, 4 or 8 (default 4)
+ * Returns 1 on success, 0 on invalid width
+ */
+int kaos_set_interleave(int width);
+
+/**
+ * Current interleave width of the scalar batch engine
+ */
+int kaos_get_interleave(void);
+
+/* Thread pool - concurrent batches with work stealing */
+
+/* Opaque pool of worker threads, one deque per worker */
+typedef struct KaosPool KaosPool;
+
+/* Completion handle of one submitted batch */
+typedef struct KaosFuture KaosFuture;
+
+/**
+ * Called as soon as msgs[index] is finished, normally from a worker thread
+ * Empty messages (and any a full deque cannot take) complete on the thread
+ * calling kaos_pool_submit_batch, before it returns
+ */
+typedef void (*KaosPoolCallback)(void* user, size_t index);
+
+/**
+ * Start a pool of workers threads (0 = one per online CPU)
+ * cpus: NULL, or workers CPU ids; worker i is pinned to cpus[i]
+ * (a negative id leaves that worker unpinned); must be NULL if workers <= 0
+ * Returns allocated pool or NULL on error
+ * Caller must release it with kaos_pool_free()
+ */
+KaosPool* kaos_pool_new(int workers, const int* cpus);
+
+/**
+ * Finish every submitted task, stop the workers and release the pool
+ */
+void kaos_pool_free(KaosPool* pool);
+
+/**
+ * Number of worker threads
+ */
+int kaos_pool_workers(const KaosPool* pool);
+
+/**
+ * Encrypt (or decrypt) count independent messages on the pool
+ * Messages longer than one chunk are split into a warmup task and
+ * keystream chunk tasks, so short messages never wait behind a long one
+ * msgs and their buffers must stay valid until the future completes
+ * callback may be NULL
+ * Returns a future, or NULL on error (nothing submitted)
+ */
+KaosFuture* kaos_pool_submit_batch(KaosPool* pool, KaosCipher* cipher,
+                                   KaosMessage* msgs, size_t count,
+                                   KaosPoolCallback callback, void* user);
+
+/**
+ * Returns 1 if every message of the batch is finished, 0 otherwise
+ */
+int kaos_future_done(KaosFuture* future);
+
+/**
+ * Block until every message of the batch is finished
+ */
+void kaos_future_wait(KaosFuture* future);
+
+/**
+ * Wait for completion, then release the future
+ */
+void kaos_future_free(KaosFuture* future);
+
+/* Warmup pre-staging - states for reserved nonces warmed in the background */
+
+/* Opaque pre-stager for one key: bounded lock-free queue + warmup threads */
+typedef struct KaosPrestager KaosPrestager;
+
+/* Pre-stager counters */
+typedef struct {
+    size_t depth;            // Warmed states ready to use now
+    size_t reserved;         // Reserved nonces not used yet (incl. depth)
+    size_t capacity;         // Maximum outstanding reservations
+    uint64_t hits;           // Encryptions that found their state ready
+    uint64_t waits;          // Waited for a warmup already in progress
+    uint64_t starved;        // Reserved but unstarted: warmed on the caller
+    uint64_t unreserved;     // Nonce never reserved: warmed on the caller
+    uint64_t discarded;      // Reservations skipped by a later nonce
+} KaosPrestageStats;
+
+/**
+ * Create a pre-stager for key with room for capacity reserved nonces and
+ * threads warmup threads (0 = 1). Only a prepared key is kept
+ * Returns allocated pre-stager or NULL on error
+ * Caller must release it with kaos_prestager_free()
+ */
+KaosPrestager* kaos_prestager_new(KaosCipher* cipher, const uint8_t* key_256bit,
+                                  size_t capacity, int threads);
+
+/**
+ * Stop the warmup threads, wipe every staged state and release
+ */
+void kaos_prestager_free(KaosPrestager* prestager);
+
+/**
+ * Reserve the next nonce; its state is warmed in the background
+ * Nonces are used in reservation order (e.g. a nonce counter)
+ * Returns 1 on success, 0 if the queue is full or on error
+ */
+int kaos_prestager_reserve(KaosPrestager* prestager, const uint8_t* nonce_96bit);
+
+/**
+ * Encrypt into caller-owned buffer with the staged state for nonce
+ * Same output as kaos_encrypt_into. Earlier reservations that were never
+ * used are discarded; a nonce that was not reserved is warmed inline
+ * Reserve and encrypt may run on different threads, each from one
+ * thread at a time
+ * Returns 1 on success, 0 on error
+ */
+int kaos_encrypt_prestaged(KaosPrestager* prestager, const uint8_t* in,
+                           uint8_t* out, size_t length, const uint8_t* nonce_96bit);
+
+/**
+ * Decrypt with a staged state (identical to kaos_encrypt_prestaged)
+ * Returns 1 on success, 0 on error
+ */
+int kaos_decrypt_prestaged(KaosPrestager* prestager, const uint8_t* in,
+                           uint8_t* out, size_t length, const uint8_t* nonce_96bit);
+
+/**
+ * Snapshot of queue depth and starvation counters
+ */
+void kaos_prestager_stats(KaosPrestager* prestager, KaosPrestageStats* stats);
+
+/* Keystream prefetcher - a producer thread generates ahead of the consumer */
+
+/* Opaque prefetcher: one stream, one producer thread, one SPSC ring */
+typedef struct KaosPrefetcher KaosPrefetcher;
+
+/* What either side does once the ring is empty (consumer) or full (producer) */
+typedef enum {
+    KAOS_WAIT_SPIN = 0,      // Poll, yielding the CPU between polls
+    KAOS_WAIT_BLOCK = 1      // Poll briefly, then sleep until woken
+} KaosWaitPolicy;
+
+/**
+ * Start a producer thread for the key+nonce stream; it runs the warmup
+ * and keeps up to ring_size keystream bytes ahead (rounded up to a power
+ * of two, at least 4096)
+ * Returns allocated prefetcher or NULL on error
+ * Caller must release it with kaos_prefetcher_free()
+ */
+KaosPrefetcher* kaos_prefetcher_new(KaosCipher* cipher, const uint8_t* key_256bit,
+                                    const uint8_t* nonce_96bit, size_t ring_size,
+                                    KaosWaitPolicy policy);
+
+/**
+ * Stop the producer, wipe the ring and release
+ */
+void kaos_prefetcher_free(KaosPrefetcher* prefetcher);
+
+/**
+ * Encrypt/decrypt the next length bytes of the stream with prefetched
+ * keystream. Any split gives the same bytes as one kaos_encrypt call
+ * Single consumer: one thread at a time
+ * Returns 1 on success, 0 on error
+ */
+int kaos_prefetcher_xor(KaosPrefetcher* prefetcher, const uint8_t* in, uint8_t* out,
+                        size_t length);
+
+/**
+ * Bytes consumed so far (stream position)
+ */
+uint64_t kaos_prefetcher_position(KaosPrefetcher* prefetcher);
+
+/**
+ * Keystream bytes generated but not consumed yet
+ */
+size_t kaos_prefetcher_buffered(KaosPrefetcher* prefetcher);
+
+/* Kernel dispatch - CPU features detected once at load time */
+
+/* Compiled kernel variants */
+typedef enum {
+    KAOS_KERNEL_SCALAR = 0,   // Portable C, interleaved batch streams
+    KAOS_KERNEL_SSE2 = 1,     // Interleaved batch streams
+    KAOS_KERNEL_AVX2 = 2,     // 4 batch lanes
+    KAOS_KERNEL_AVX512 = 3,   // 8 batch lanes
+    KAOS_KERNEL_COUNT
+} KaosKernelId;
+
+/**
+ * Kernel currently used by kaos_encrypt, streaming and batch paths
+ * Best verified kernel, or the one forced with KAOS_KERNEL=<name>
+ */
+KaosKernelId kaos_get_kernel(void);
+
+/**
+ * Force a kernel (for benchmarking)
+ * Returns 1 on success, 0 if the CPU lacks it or its self-check failed
+ */
+int kaos_set_kernel(KaosKernelId id);
+
+/**
+ * Returns 1 if kernel is supported by this CPU and passed the startup
+ * bit-exactness self-check against the scalar reference
+ */
+int kaos_kernel_available(KaosKernelId id);
+
+/**
+ * Kernel name ("scalar", "sse2", "avx2", "avx512")
+ */
+const char* kaos_kernel_name(KaosKernelId id);
+
+/* Phase statistics - optional instrumentation, library built with -DKAOS_STATS */
+
+/* Instrumented phases */
+typedef enum {
+    KAOS_PHASE_KEY_SETUP = 0, // kaos_key_to_state and its prepared/batch forms
+    KAOS_PHASE_WARMUP = 1,    // Warmup steps (batch: runs with no lane emitting)
+    KAOS_PHASE_KEYSTREAM = 2, // Keystream generation (batch: XOR fused in)
+    KAOS_PHASE_XOR = 3,       // Keystream tile XOR
+    KAOS_PHASE_COUNT
+} KaosPhase;
+
+/* Counters of one phase */
+typedef struct {
+    uint64_t calls;           // Kernel invocations (tiles, states, lane runs)
+    uint64_t bytes;           // Bytes produced (0 for key setup and warmup)
+    uint64_t ticks;           // TSC cycles on x86, nanoseconds elsewhere
+    double seconds;           // ticks / ticks_per_second
+} KaosPhaseStats;
+
+/* Snapshot of every phase */
+typedef struct {
+    int enabled;              // 0: library built without KAOS_STATS (all zero)
+    uint32_t threads;         // Live threads that recorded anything (exited: counts kept)
+    double ticks_per_second;
+    KaosPhaseStats phase[KAOS_PHASE_COUNT];
+} KaosStats;
+
+/* Output of kaos_stats_format */
+typedef enum {
+    KAOS_STATS_TEXT = 0,      // Aligned table, one line per phase
+    KAOS_STATS_JSON = 1       // One JSON object
+} KaosStatsFormat;
+
+/**
+ * Counters of every thread since the last kaos_stats_reset, summed
+ * Each thread counts privately; threads that exited are included
+ */
+void kaos_stats_snapshot(KaosStats* stats);
+
+/**
+ * Counters of the calling thread only, since the last kaos_stats_reset
+ */
+void kaos_stats_thread_snapshot(KaosStats* stats);
+
+/**
+ * Start counting from zero (safe while other threads are recording)
+ */
+void kaos_stats_reset(void);
+
+/**
+ * Render a snapshot as text or JSON into buffer (NUL-terminated, truncated
+ * to size); buffer may be NULL with size 0 to query the length
+ * Returns the full length excluding the NUL
+ */
+size_t kaos_stats_format(const KaosStats* stats, KaosStatsFormat format,
+                         char* buffer, size_t size);
+
+/**
+ * Phase name ("key_setup", "warmup", "keystream", "xor")
+ */
+const char* kaos_phase_name(KaosPhase phase);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* KAOS_CIPHER_H */
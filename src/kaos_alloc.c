@@ -0,0 +1,262 @@
+/**
+ * KAOS CIPHER - Stream Cipher Based on Lorenz Chaotic System
+ * Allocator Hooks - per-thread arena and huge-page buffers
+ * Author: Simón M. Guiñazú
+ * Github: https://github.com/sysphersec/kaos-cipher
+ *
+ * Buffers the library returns come from an installable allocator.
+ * Two implementations ship with it: a per-thread bump arena for
+ * request-scoped buffers (no locking, no per-buffer free) and a
+ * large-buffer allocator backed by 2 MiB transparent huge pages, touched
+ * at allocation so keystream loops run without page faults and with one
+ * TLB entry per 2 MiB.
+ */
+
+#include "kaos_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/* Arena defaults; every arena allocation is cache-line aligned */
+#define KAOS_ARENA_BLOCK_DEFAULT (1u << 20)
+#define KAOS_ARENA_ALIGN 64
+
+/* Transparent huge page size (x86-64 / AArch64 with 4 KiB base pages) */
+#define KAOS_HUGEPAGE_SIZE ((size_t)2 << 20)
+
+/*
+ * INSTALLED ALLOCATOR
+ */
+static void* kaos_default_alloc(void* context, size_t size) {
+    (void)context;
+    return malloc(size);
+}
+
+static void kaos_default_free(void* context, void* ptr, size_t size) {
+    (void)context;
+    (void)size;
+    free(ptr);
+}
+
+static KaosAllocator kaos_allocator = { kaos_default_alloc, kaos_default_free, NULL };
+
+int kaos_set_allocator(const KaosAllocator* allocator) {
+    if (!allocator) {
+        kaos_allocator.alloc = kaos_default_alloc;
+        kaos_allocator.free = kaos_default_free;
+        kaos_allocator.context = NULL;
+        return 1;
+    }
+    if (!allocator->alloc || !allocator->free) {
+        return 0;
+    }
+
+    kaos_allocator = *allocator;
+    return 1;
+}
+
+void kaos_get_allocator(KaosAllocator* allocator) {
+    if (allocator) {
+        *allocator = kaos_allocator;
+    }
+}
+
+void* kaos_alloc(size_t size) {
+    return kaos_allocator.alloc(kaos_allocator.context, size);
+}
+
+void kaos_free(void* ptr, size_t size) {
+    if (ptr) {
+        kaos_allocator.free(kaos_allocator.context, ptr, size);
+    }
+}
+
+/*
+ * PER-THREAD BUMP ARENA
+ */
+/* Block header; data starts KAOS_ARENA_ALIGN bytes in */
+typedef struct KaosArenaBlock {
+    struct KaosArenaBlock* next;   // Older block
+    size_t size;                   // Data bytes
+    size_t used;                   // Data bytes handed out
+} KaosArenaBlock;
+
+typedef struct {
+    KaosArenaBlock* blocks;        // Newest first
+    size_t used;                   // Bytes handed out since the last reset
+} KaosThreadArena;
+
+static _Thread_local KaosThreadArena* kaos_thread_arena = NULL;
+static pthread_key_t kaos_arena_key;
+static pthread_once_t kaos_arena_once = PTHREAD_ONCE_INIT;
+
+/* Thread exit: return every block */
+static void kaos_arena_destroy(void* arg) {
+    KaosThreadArena* arena = (KaosThreadArena*)arg;
+
+    while (arena->blocks) {
+        KaosArenaBlock* block = arena->blocks;
+        arena->blocks = block->next;
+        free(block);
+    }
+    free(arena);
+}
+
+static void kaos_arena_key_init(void) {
+    pthread_key_create(&kaos_arena_key, kaos_arena_destroy);
+}
+
+static KaosThreadArena* kaos_arena_get(void) {
+    if (!kaos_thread_arena) {
+        pthread_once(&kaos_arena_once, kaos_arena_key_init);
+
+        KaosThreadArena* arena = (KaosThreadArena*)calloc(1, sizeof(KaosThreadArena));
+        if (!arena) {
+            return NULL;
+        }
+        pthread_setspecific(kaos_arena_key, arena);
+        kaos_thread_arena = arena;
+    }
+    return kaos_thread_arena;
+}
+
+static void* kaos_arena_alloc(void* context, size_t size) {
+    size_t block_size = (size_t)(uintptr_t)context;
+    KaosThreadArena* arena = kaos_arena_get();
+
+    if (!arena || size > SIZE_MAX - 2 * KAOS_ARENA_ALIGN) {
+        return NULL;
+    }
+    size = (size + KAOS_ARENA_ALIGN - 1) & ~(size_t)(KAOS_ARENA_ALIGN - 1);
+
+    KaosArenaBlock* block = arena->blocks;
+    if (!block || block->size - block->used < size) {
+        size_t data = size > block_size ? size : block_size;
+        block = (KaosArenaBlock*)aligned_alloc(KAOS_ARENA_ALIGN, KAOS_ARENA_ALIGN + data);
+        if (!block) {
+            return NULL;
+        }
+        block->size = data;
+        block->used = 0;
+        block->next = arena->blocks;
+        arena->blocks = block;
+    }
+
+    void* ptr = (uint8_t*)block + KAOS_ARENA_ALIGN + block->used;
+    block->used += size;
+    arena->used += size;
+    return ptr;
+}
+
+/* Individual buffers are released together by kaos_arena_reset */
+static void kaos_arena_free(void* context, void* ptr, size_t size) {
+    (void)context;
+    (void)ptr;
+    (void)size;
+}
+
+void kaos_arena_allocator(KaosAllocator* allocator, size_t block_size) {
+    if (!allocator) {
+        return;
+    }
+    if (block_size == 0) {
+        block_size = KAOS_ARENA_BLOCK_DEFAULT;
+    }
+
+    allocator->alloc = kaos_arena_alloc;
+    allocator->free = kaos_arena_free;
+    allocator->context = (void*)(uintptr_t)block_size;
+}
+
+void kaos_arena_reset(void) {
+    KaosThreadArena* arena = kaos_thread_arena;
+    if (!arena || !arena->blocks) {
+        return;
+    }
+
+    // Keep the oldest block, free the rest
+    while (arena->blocks->next) {
+        KaosArenaBlock* block = arena->blocks;
+        arena->blocks = block->next;
+        free(block);
+    }
+    arena->blocks->used = 0;
+    arena->used = 0;
+}
+
+size_t kaos_arena_used(void) {
+    return kaos_thread_arena ? kaos_thread_arena->used : 0;
+}
+
+/*
+ * HUGE-PAGE ALLOCATOR
+ */
+static size_t kaos_hugepage_span(size_t size) {
+    return (size + KAOS_HUGEPAGE_SIZE - 1) & ~(KAOS_HUGEPAGE_SIZE - 1);
+}
+
+static void* kaos_hugepage_alloc(void* context, size_t size) {
+    (void)context;
+
+    if (size < KAOS_HUGEPAGE_SIZE) {
+        return malloc(size);
+    }
+    if (size > SIZE_MAX - 2 * KAOS_HUGEPAGE_SIZE) {
+        return NULL;
+    }
+
+    // Over-map by one huge page, then trim to a 2 MiB aligned span
+    size_t span = kaos_hugepage_span(size);
+    size_t mapped = span + KAOS_HUGEPAGE_SIZE;
+    uint8_t* base = (uint8_t*)mmap(NULL, mapped, PROT_READ | PROT_WRITE,
+                                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+
+    uint8_t* aligned = (uint8_t*)(((uintptr_t)base + KAOS_HUGEPAGE_SIZE - 1) &
+                                  ~(uintptr_t)(KAOS_HUGEPAGE_SIZE - 1));
+    size_t lead = (size_t)(aligned - base);
+    if (lead > 0) {
+        munmap(base, lead);
+    }
+    if (mapped - lead - span > 0) {
+        munmap(aligned + span, mapped - lead - span);
+    }
+
+#ifdef MADV_HUGEPAGE
+    madvise(aligned, span, MADV_HUGEPAGE);
+#endif
+
+    // First touch: fault every page in now, from the allocating thread
+    long page = sysconf(_SC_PAGESIZE);
+    if (page <= 0) page = 4096;
+    volatile uint8_t* touch = aligned;
+    for (size_t offset = 0; offset < span; offset += (size_t)page) {
+        touch[offset] = 0;
+    }
+
+    return aligned;
+}
+
+static void kaos_hugepage_free(void* context, void* ptr, size_t size) {
+    (void)context;
+
+    if (size < KAOS_HUGEPAGE_SIZE) {
+        free(ptr);
+    } else {
+        munmap(ptr, kaos_hugepage_span(size));
+    }
+}
+
+void kaos_hugepage_allocator(KaosAllocator* allocator) {
+    if (!allocator) {
+        return;
+    }
+
+    allocator->alloc = kaos_hugepage_alloc;
+    allocator->free = kaos_hugepage_free;
+    allocator->context = NULL;
+}
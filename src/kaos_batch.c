@@ -0,0 +1,283 @@
+/**
+ * KAOS CIPHER - Stream Cipher Based on Lorenz Chaotic System
+ * Batch Engine - many independent messages in lockstep
+ * Author: Simón M. Guiñazú
+ * Github: https://github.com/sysphersec/kaos-cipher
+ *
+ * A single Lorenz stream is one long chain of dependent FP operations.
+ * Independent (key, nonce) messages are packed into structure-of-arrays
+ * lanes so one vector instruction advances 4 (AVX2) or 8 (AVX-512)
+ * streams at once. Output is bit-identical to kaos_encrypt.
+ *
+ * Scalar and SSE2 hosts use the interleaved scalar engine instead: 2-8
+ * streams advanced round-robin in one loop body, so the out-of-order
+ * core overlaps their independent dependency chains (faster than
+ * 2-wide SSE2 lanes, which still serialize on one chain per lane).
+ */
+
+/* Every multiply and add must round exactly like the scalar reference */
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#include "kaos_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/*
+ * INTERLEAVED SCALAR KERNEL - width independent streams per loop body
+ * width is a compile-time constant in each wrapper, so the lane loops
+ * unroll into straight-line code with width parallel dependency chains.
+ * Keystream arithmetic is the strength-reduced form of the fused kernel.
+ */
+__attribute__((always_inline))
+static inline void kaos_lanes_interleaved(KaosCipher* cipher, KaosLanes* lanes,
+                                          const KaosLaneEmit* emit, size_t steps,
+                                          const int width) {
+    const double sigma = cipher->sigma, rho = cipher->rho;
+    const double beta = cipher->beta, dt = cipher->dt;
+    double x[KAOS_MAX_LANES], y[KAOS_MAX_LANES], z[KAOS_MAX_LANES];
+    double position[KAOS_MAX_LANES];
+    unsigned residue[KAOS_MAX_LANES];
+    uint8_t low[KAOS_MAX_LANES];
+
+    for (int l = 0; l < width; l++) {
+        x[l] = lanes->x[l];
+        y[l] = lanes->y[l];
+        z[l] = lanes->z[l];
+        position[l] = (double)emit->counter[l];
+        residue[l] = (unsigned)(emit->counter[l] % 97);
+        low[l] = (uint8_t)emit->counter[l];
+    }
+
+    for (size_t k = 0; k < steps; k++) {
+        for (int l = 0; l < width; l++) {
+            double dx = sigma * (y[l] - x[l]) * dt;
+            double dy = (x[l] * (rho - z[l]) - y[l]) * dt;
+            double dz = (x[l] * y[l] - beta * z[l]) * dt;
+            x[l] += dx;
+            y[l] += dy;
+            z[l] += dz;
+        }
+
+        if (emit->emitting == 0) continue;
+
+        for (int l = 0; l < width; l++) {
+            double combined = (x[l] * KAOS_PHI) + (y[l] * KAOS_E) + (z[l] * KAOS_PI);
+            double magnitude = fabs(combined);
+            double fractional = magnitude < KAOS_TWO52 ?
+                                magnitude - (double)(int64_t)magnitude : 0.0;
+            double sum = fractional + position[l] * KAOS_PERTURBATION;
+            fractional = sum - (double)(int64_t)sum;
+
+            uint8_t byte = (uint8_t)(int32_t)(fractional * 256.0);
+            byte = (uint8_t)(byte + low[l]);
+            byte ^= (uint8_t)((byte >> 4) ^ (byte << 3) ^ residue[l]);
+            byte = (uint8_t)(byte * 167 + 123);
+
+            if (emit->in[l]) {
+                emit->out[l][k] = emit->in[l][k] ^ byte;
+            }
+
+            position[l] += 1.0;
+            low[l]++;
+            residue[l] = (residue[l] == 96) ? 0 : residue[l] + 1;
+        }
+    }
+
+    for (int l = 0; l < width; l++) {
+        lanes->x[l] = x[l];
+        lanes->y[l] = y[l];
+        lanes->z[l] = z[l];
+    }
+}
+
+void kaos_lanes_scalar2(KaosCipher* cipher, KaosLanes* lanes,
+                        const KaosLaneEmit* emit, size_t steps) {
+    kaos_lanes_interleaved(cipher, lanes, emit, steps, 2);
+}
+
+void kaos_lanes_scalar4(KaosCipher* cipher, KaosLanes* lanes,
+                        const KaosLaneEmit* emit, size_t steps) {
+    kaos_lanes_interleaved(cipher, lanes, emit, steps, 4);
+}
+
+void kaos_lanes_scalar8(KaosCipher* cipher, KaosLanes* lanes,
+                        const KaosLaneEmit* emit, size_t steps) {
+    kaos_lanes_interleaved(cipher, lanes, emit, steps, 8);
+}
+
+/* Streams per interleaved loop body (2, 4 or 8) */
+static int kaos_interleave_width = 4;
+
+int kaos_set_interleave(int width) {
+    if (width != 2 && width != 4 && width != 8) {
+        return 0;
+    }
+    kaos_interleave_width = width;
+    return 1;
+}
+
+int kaos_get_interleave(void) {
+    return kaos_interleave_width;
+}
+
+/* Initial states for the next (up to) KAOS_MAX_LANES non-empty messages */
+static size_t kaos_batch_stage(KaosMessage* msgs, size_t count, size_t* next,
+                               KaosState* states, size_t* indices) {
+    const uint8_t* keys[KAOS_MAX_LANES];
+    const uint8_t* nonces[KAOS_MAX_LANES];
+    size_t staged = 0;
+
+    while (staged < KAOS_MAX_LANES && *next < count) {
+        KaosMessage* m = &msgs[(*next)++];
+        if (m->length == 0) continue;
+
+        keys[staged] = m->key;
+        nonces[staged] = m->nonce;
+        indices[staged++] = *next - 1;
+    }
+
+    kaos_key_to_state_batch(keys, nonces, staged, states);
+    return staged;
+}
+
+/*
+ * LANE SCHEDULER - refills a lane as soon as its message ends
+ * pos < 0 counts remaining warmup steps, pos >= 0 is the byte position.
+ * Each kernel run lasts until the next lane changes phase, so messages
+ * of unequal length never need per-byte masking.
+ */
+void kaos_batch_run(KaosCipher* cipher, KaosMessage* msgs, size_t count,
+                    int width, KaosLaneKernel kernel) {
+    KaosLanes lanes;
+    KaosLaneEmit emit;
+    size_t msg_index[KAOS_MAX_LANES];
+    int64_t pos[KAOS_MAX_LANES];
+    int active[KAOS_MAX_LANES];
+    size_t next = 0;
+
+    // Key setup runs a lane-group ahead, batched across messages
+    KaosState staged[KAOS_MAX_LANES];
+    size_t staged_index[KAOS_MAX_LANES];
+    size_t staged_next = 0, staged_count = 0;
+
+    // Idle lanes sit on the (0,0,0) fixed point
+    memset(&lanes, 0, sizeof(lanes));
+    memset(active, 0, sizeof(active));
+
+    for (;;) {
+        int running = 0;
+        int64_t run = INT64_MAX;
+
+        for (int l = 0; l < width; l++) {
+            // Refill idle lane with the next non-empty message
+            if (!active[l] && staged_next == staged_count) {
+                staged_count = kaos_batch_stage(msgs, count, &next, staged, staged_index);
+                staged_next = 0;
+            }
+            if (!active[l] && staged_next < staged_count) {
+                lanes.x[l] = staged[staged_next].x;
+                lanes.y[l] = staged[staged_next].y;
+                lanes.z[l] = staged[staged_next].z;
+                msg_index[l] = staged_index[staged_next++];
+                pos[l] = -(int64_t)cipher->warmup;
+                active[l] = 1;
+            }
+            if (!active[l]) continue;
+
+            // Steps until this lane finishes warmup or its message
+            int64_t until = pos[l] < 0 ? -pos[l]
+                                       : (int64_t)msgs[msg_index[l]].length - pos[l];
+            if (until < run) run = until;
+            running++;
+        }
+
+        if (running == 0) break;
+
+        emit.emitting = 0;
+        for (int l = 0; l < KAOS_MAX_LANES; l++) {
+            if (l < width && active[l] && pos[l] >= 0) {
+                KaosMessage* m = &msgs[msg_index[l]];
+                emit.in[l] = m->in + pos[l];
+                emit.out[l] = m->out + pos[l];
+                emit.counter[l] = (uint64_t)pos[l];
+                emit.emitting++;
+            } else {
+                emit.in[l] = NULL;
+                emit.out[l] = NULL;
+                emit.counter[l] = 0;
+            }
+        }
+
+        KAOS_STATS_START(start);
+        kernel(cipher, &lanes, &emit, (size_t)run);
+        KAOS_STATS_STOP(emit.emitting ? KAOS_PHASE_KEYSTREAM : KAOS_PHASE_WARMUP, start,
+                        1, (uint64_t)run * (uint64_t)emit.emitting);
+
+        for (int l = 0; l < width; l++) {
+            if (!active[l]) continue;
+            pos[l] += run;
+            if (pos[l] >= 0 && (uint64_t)pos[l] == msgs[msg_index[l]].length) {
+                active[l] = 0;
+            }
+        }
+    }
+
+    kaos_wipe(staged, sizeof(staged));
+}
+
+/*
+ * BATCH ON A GIVEN KERNEL
+ * Kernels without vector lanes use the interleaved scalar engine
+ */
+void kaos_batch_with_kernel(KaosCipher* cipher, KaosMessage* msgs, size_t count,
+                            const KaosKernel* kernel) {
+    if (kernel->lanes > 0) {
+        kaos_batch_run(cipher, msgs, count, kernel->lanes, kernel->lane);
+        return;
+    }
+    
+    switch (kaos_interleave_width) {
+    case 2:
+        kaos_batch_run(cipher, msgs, count, 2, kaos_lanes_scalar2);
+        break;
+    case 8:
+        kaos_batch_run(cipher, msgs, count, 8, kaos_lanes_scalar8);
+        break;
+    default:
+        kaos_batch_run(cipher, msgs, count, 4, kaos_lanes_scalar4);
+        break;
+    }
+}
+
+/*
+ * BATCH ENCRYPTION - every message gets its own key/nonce stream
+ * Runs on the dispatcher's kernel (widest verified vector unit)
+ */
+int kaos_encrypt_batch(KaosCipher* cipher, KaosMessage* msgs, size_t count) {
+    if (!cipher || (count > 0 && !msgs)) {
+        return 0;
+    }
+
+    // Validate every message before touching any output
+    for (size_t i = 0; i < count; i++) {
+        if (msgs[i].length > 0 &&
+            (!msgs[i].in || !msgs[i].out || !msgs[i].key || !msgs[i].nonce)) {
+            return 0;
+        }
+    }
+
+    kaos_batch_with_kernel(cipher, msgs, count, kaos_active_kernel());
+    return 1;
+}
+
+/*
+ * BATCH DECRYPTION - identical to batch encryption (XOR symmetry)
+ */
+int kaos_decrypt_batch(KaosCipher* cipher, KaosMessage* msgs, size_t count) {
+    return kaos_encrypt_batch(cipher, msgs, count);
+}
@@ -0,0 +1,399 @@
+/**
+ * KAOS CIPHER - Stream Cipher Based on Lorenz Chaotic System
+ * Warmed State Cache - bounded, thread-safe LRU
+ * Author: Simón M. Guiñazú
+ * Github: https://github.com/sysphersec/kaos-cipher
+ *
+ * Every message pays key setup plus cipher->warmup Lorenz steps before
+ * its first byte. Readers that decrypt the same object repeatedly can
+ * keep the warmed (x, y, z) state here and skip that cost.
+ *
+ * Entries are found by a 128-bit SipHash-2-4 tag of key || nonce under a
+ * random per-cache secret, so neither raw keys nor predictable bucket
+ * indices are kept. The warmed state is key-equivalent material: it is
+ * zeroized on eviction, invalidation, clear and free.
+ */
+
+#include "kaos_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+/* End of list / chain marker */
+#define KAOS_CACHE_NONE ((size_t)-1)
+
+/* Hashed input: key || nonce */
+#define KAOS_CACHE_INPUT (KAOS_KEY_SIZE + KAOS_NONCE_SIZE)
+
+typedef struct {
+    uint64_t tag[2];       // Keyed hash of key || nonce
+    KaosCipher params;     // Parameters the state was warmed with
+    KaosState state;       // State after warmup
+    size_t prev, next;     // LRU list (head = most recently used)
+    size_t chain;          // Next entry in the same hash bucket
+} KaosCacheEntry;
+
+struct KaosCache {
+    pthread_mutex_t lock;
+    uint64_t secret[4];        // SipHash keys for the two tag halves
+    KaosCacheEntry* entries;   // capacity preallocated entries
+    size_t* buckets;           // Hash bucket heads
+    size_t capacity;
+    size_t bucket_mask;        // bucket count - 1 (power of two)
+    size_t head, tail;         // LRU list ends
+    size_t free_list;          // Unused entries, linked through next
+    size_t count;
+    uint64_t hits, misses, evictions;
+};
+
+/*
+ * SIPHASH-2-4 - keyed 64-bit hash
+ */
+#define KAOS_ROTL(v, r) (((v) << (r)) | ((v) >> (64 - (r))))
+
+#define KAOS_SIPROUND(v0, v1, v2, v3)                                       \
+    do {                                                                    \
+        v0 += v1; v1 = KAOS_ROTL(v1, 13); v1 ^= v0; v0 = KAOS_ROTL(v0, 32); \
+        v2 += v3; v3 = KAOS_ROTL(v3, 16); v3 ^= v2;                         \
+        v0 += v3; v3 = KAOS_ROTL(v3, 21); v3 ^= v0;                         \
+        v2 += v1; v1 = KAOS_ROTL(v1, 17); v1 ^= v2; v2 = KAOS_ROTL(v2, 32); \
+    } while (0)
+
+static uint64_t kaos_siphash(uint64_t k0, uint64_t k1, const uint8_t* data, size_t length) {
+    uint64_t v0 = k0 ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = k1 ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = k0 ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = k1 ^ 0x7465646279746573ULL;
+    uint64_t m;
+    size_t i = 0;
+
+    for (; i + 8 <= length; i += 8) {
+        m = 0;
+        for (int b = 7; b >= 0; b--) m = (m << 8) | data[i + b];
+        v3 ^= m;
+        KAOS_SIPROUND(v0, v1, v2, v3);
+        KAOS_SIPROUND(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+
+    // Last block: remaining bytes plus length in the top byte
+    m = (uint64_t)length << 56;
+    for (size_t b = 0; i + b < length; b++) {
+        m |= (uint64_t)data[i + b] << (8 * b);
+    }
+    v3 ^= m;
+    KAOS_SIPROUND(v0, v1, v2, v3);
+    KAOS_SIPROUND(v0, v1, v2, v3);
+    v0 ^= m;
+
+    v2 ^= 0xFF;
+    KAOS_SIPROUND(v0, v1, v2, v3);
+    KAOS_SIPROUND(v0, v1, v2, v3);
+    KAOS_SIPROUND(v0, v1, v2, v3);
+    KAOS_SIPROUND(v0, v1, v2, v3);
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+/*
+ * PER-CACHE SECRET - /dev/urandom, clock/address mix as fallback
+ */
+static void kaos_cache_seed(uint64_t secret[4]) {
+    FILE* random = fopen("/dev/urandom", "rb");
+    size_t got = 0;
+
+    if (random) {
+        got = fread(secret, sizeof(uint64_t), 4, random);
+        fclose(random);
+    }
+    if (got == 4) {
+        return;
+    }
+
+    // splitmix64 over time, clock and a stack address
+    uint64_t seed = (uint64_t)time(NULL) ^ ((uint64_t)clock() << 32) ^
+                    (uint64_t)(uintptr_t)&seed;
+    for (int i = 0; i < 4; i++) {
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        secret[i] = z ^ (z >> 31);
+    }
+}
+
+static void kaos_cache_tag(const KaosCache* cache, const uint8_t* key_256bit,
+                           const uint8_t* nonce_96bit, uint64_t tag[2]) {
+    uint8_t input[KAOS_CACHE_INPUT];
+    memcpy(input, key_256bit, KAOS_KEY_SIZE);
+    memcpy(input + KAOS_KEY_SIZE, nonce_96bit, KAOS_NONCE_SIZE);
+
+    tag[0] = kaos_siphash(cache->secret[0], cache->secret[1], input, sizeof(input));
+    tag[1] = kaos_siphash(cache->secret[2], cache->secret[3], input, sizeof(input));
+
+    kaos_wipe(input, sizeof(input));
+}
+
+static int kaos_cache_same_params(const KaosCipher* a, const KaosCipher* b) {
+    return a->sigma == b->sigma && a->rho == b->rho && a->beta == b->beta &&
+           a->dt == b->dt && a->warmup == b->warmup;
+}
+
+/*
+ * LRU LIST AND HASH CHAIN MAINTENANCE - caller holds the lock
+ */
+static void kaos_cache_unlink(KaosCache* cache, size_t e) {
+    KaosCacheEntry* entry = &cache->entries[e];
+
+    if (entry->prev != KAOS_CACHE_NONE) cache->entries[entry->prev].next = entry->next;
+    else cache->head = entry->next;
+
+    if (entry->next != KAOS_CACHE_NONE) cache->entries[entry->next].prev = entry->prev;
+    else cache->tail = entry->prev;
+}
+
+static void kaos_cache_push_front(KaosCache* cache, size_t e) {
+    KaosCacheEntry* entry = &cache->entries[e];
+
+    entry->prev = KAOS_CACHE_NONE;
+    entry->next = cache->head;
+    if (cache->head != KAOS_CACHE_NONE) cache->entries[cache->head].prev = e;
+    else cache->tail = e;
+    cache->head = e;
+}
+
+static size_t kaos_cache_find(const KaosCache* cache, const uint64_t tag[2]) {
+    size_t e = cache->buckets[tag[0] & cache->bucket_mask];
+
+    while (e != KAOS_CACHE_NONE) {
+        const KaosCacheEntry* entry = &cache->entries[e];
+        if (entry->tag[0] == tag[0] && entry->tag[1] == tag[1]) {
+            return e;
+        }
+        e = entry->chain;
+    }
+    return KAOS_CACHE_NONE;
+}
+
+/* Removes e from its bucket and the LRU list, wipes it, returns it to the free list */
+static void kaos_cache_remove(KaosCache* cache, size_t e) {
+    KaosCacheEntry* entry = &cache->entries[e];
+    size_t* link = &cache->buckets[entry->tag[0] & cache->bucket_mask];
+
+    while (*link != e) {
+        link = &cache->entries[*link].chain;
+    }
+    *link = entry->chain;
+
+    kaos_cache_unlink(cache, e);
+    kaos_wipe(entry, sizeof(KaosCacheEntry));
+
+    entry->next = cache->free_list;
+    cache->free_list = e;
+    cache->count--;
+}
+
+/*
+ * CACHE LIFETIME
+ */
+KaosCache* kaos_cache_new(size_t capacity) {
+    if (capacity == 0 || capacity > ((size_t)-1 >> 2) / sizeof(KaosCacheEntry)) {
+        return NULL;
+    }
+
+    KaosCache* cache = (KaosCache*)calloc(1, sizeof(KaosCache));
+    if (!cache) {
+        return NULL;
+    }
+
+    // At least two buckets per entry keeps chains short
+    size_t buckets = 1;
+    while (buckets < capacity * 2) buckets <<= 1;
+
+    cache->entries = (KaosCacheEntry*)calloc(capacity, sizeof(KaosCacheEntry));
+    cache->buckets = (size_t*)malloc(buckets * sizeof(size_t));
+    if (!cache->entries || !cache->buckets ||
+        pthread_mutex_init(&cache->lock, NULL) != 0) {
+        free(cache->entries);
+        free(cache->buckets);
+        free(cache);
+        return NULL;
+    }
+
+    cache->capacity = capacity;
+    cache->bucket_mask = buckets - 1;
+    cache->head = cache->tail = KAOS_CACHE_NONE;
+    for (size_t b = 0; b < buckets; b++) cache->buckets[b] = KAOS_CACHE_NONE;
+
+    cache->free_list = KAOS_CACHE_NONE;
+    for (size_t e = capacity; e-- > 0;) {
+        cache->entries[e].next = cache->free_list;
+        cache->free_list = e;
+    }
+
+    kaos_cache_seed(cache->secret);
+    return cache;
+}
+
+void kaos_cache_free(KaosCache* cache) {
+    if (!cache) {
+        return;
+    }
+
+    kaos_cache_clear(cache);
+    pthread_mutex_destroy(&cache->lock);
+
+    kaos_wipe(cache->secret, sizeof(cache->secret));
+    free(cache->entries);
+    free(cache->buckets);
+    free(cache);
+}
+
+int kaos_cache_invalidate(KaosCache* cache, const uint8_t* key_256bit,
+                          const uint8_t* nonce_96bit) {
+    if (!cache || !key_256bit || !nonce_96bit) {
+        return 0;
+    }
+
+    uint64_t tag[2];
+    kaos_cache_tag(cache, key_256bit, nonce_96bit, tag);
+
+    pthread_mutex_lock(&cache->lock);
+    size_t e = kaos_cache_find(cache, tag);
+    if (e != KAOS_CACHE_NONE) {
+        kaos_cache_remove(cache, e);
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    return e != KAOS_CACHE_NONE;
+}
+
+void kaos_cache_clear(KaosCache* cache) {
+    if (!cache) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    while (cache->head != KAOS_CACHE_NONE) {
+        kaos_cache_remove(cache, cache->head);
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void kaos_cache_stats(KaosCache* cache, KaosCacheStats* stats) {
+    if (!stats) {
+        return;
+    }
+    memset(stats, 0, sizeof(KaosCacheStats));
+    if (!cache) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    stats->hits = cache->hits;
+    stats->misses = cache->misses;
+    stats->evictions = cache->evictions;
+    stats->entries = cache->count;
+    stats->capacity = cache->capacity;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+/*
+ * WARMED STATE THROUGH THE CACHE
+ * Warmup on a miss runs outside the lock so other threads keep hitting
+ */
+static void kaos_cache_warm_state(KaosCache* cache, KaosCipher* cipher,
+                                  const uint8_t* key_256bit, const uint8_t* nonce_96bit,
+                                  KaosState* state) {
+    uint64_t tag[2];
+    kaos_cache_tag(cache, key_256bit, nonce_96bit, tag);
+
+    pthread_mutex_lock(&cache->lock);
+    size_t e = kaos_cache_find(cache, tag);
+    if (e != KAOS_CACHE_NONE && kaos_cache_same_params(&cache->entries[e].params, cipher)) {
+        *state = cache->entries[e].state;
+        kaos_cache_unlink(cache, e);
+        kaos_cache_push_front(cache, e);
+        cache->hits++;
+        pthread_mutex_unlock(&cache->lock);
+        return;
+    }
+    cache->misses++;
+    pthread_mutex_unlock(&cache->lock);
+
+    kaos_warm_state(cipher, key_256bit, nonce_96bit, state);
+
+    pthread_mutex_lock(&cache->lock);
+    // Another thread may have inserted the same tag meanwhile
+    e = kaos_cache_find(cache, tag);
+    if (e == KAOS_CACHE_NONE) {
+        if (cache->free_list == KAOS_CACHE_NONE) {
+            kaos_cache_remove(cache, cache->tail);
+            cache->evictions++;
+        }
+
+        e = cache->free_list;
+        cache->free_list = cache->entries[e].next;
+        cache->count++;
+
+        KaosCacheEntry* entry = &cache->entries[e];
+        entry->tag[0] = tag[0];
+        entry->tag[1] = tag[1];
+        entry->chain = cache->buckets[tag[0] & cache->bucket_mask];
+        cache->buckets[tag[0] & cache->bucket_mask] = e;
+    } else {
+        kaos_cache_unlink(cache, e);
+    }
+    cache->entries[e].params = *cipher;
+    cache->entries[e].state = *state;
+    kaos_cache_push_front(cache, e);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+/*
+ * CACHED DECRYPTION - identical output to kaos_decrypt_into
+ */
+int kaos_decrypt_cached(KaosCipher* cipher, KaosCache* cache,
+                        const uint8_t* in, uint8_t* out, size_t length,
+                        const uint8_t* key_256bit, const uint8_t* nonce_96bit) {
+    if (!cache) {
+        return kaos_decrypt_into(cipher, in, out, length, key_256bit, nonce_96bit);
+    }
+
+    // Validate inputs
+    if (!cipher || !in || !out || !key_256bit || !nonce_96bit || length <= 0) {
+        return 0;
+    }
+
+    KaosState state;
+    kaos_cache_warm_state(cache, cipher, key_256bit, nonce_96bit, &state);
+    kaos_xor_keystream(cipher, &state, 0, in, out, length);
+    kaos_wipe(&state, sizeof(state));
+
+    return 1;
+}
+
+/*
+ * CACHED STREAM SETUP - same stream as kaos_stream_init
+ */
+KaosStream* kaos_stream_init_cached(KaosCipher* cipher, KaosCache* cache,
+                                    const uint8_t* key_256bit,
+                                    const uint8_t* nonce_96bit) {
+    if (!cache) {
+        return kaos_stream_init(cipher, key_256bit, nonce_96bit);
+    }
+
+    // Validate inputs
+    if (!cipher || !key_256bit || !nonce_96bit) {
+        return NULL;
+    }
+
+    KaosState state;
+    kaos_cache_warm_state(cache, cipher, key_256bit, nonce_96bit, &state);
+
+    KaosStream* stream = kaos_stream_from_state(cipher, &state);
+    kaos_wipe(&state, sizeof(state));
+
+    return stream;
+}
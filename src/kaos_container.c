@@ -0,0 +1,269 @@
+/**
+ * KAOS CIPHER - Stream Cipher Based on Lorenz Chaotic System
+ * Indexed Container - self-describing files with range reads
+ * Author: Simón M. Guiñazú
+ * Github: https://github.com/sysphersec/kaos-cipher
+ *
+ * Byte N of a stream needs N Lorenz steps from the warmed state, so a
+ * raw ciphertext can only be decrypted from the start. The container
+ * stores the state at every chunk boundary after the ciphertext, which
+ * turns a read at any offset into one warmup plus at most chunk_size - 1
+ * replayed steps. Checkpoints are key-equivalent, so the table is itself
+ * encrypted, under a nonce derived from the message nonce.
+ *
+ * Container (little-endian):
+ *   0      "KAOS"         4 bytes magic
+ *   4      version        1 byte (KAOS_CONTAINER_VERSION)
+ *   5      mode           1 byte (KAOS_CONTAINER_MODE_INDEXED)
+ *   6      reserved       2 bytes, zero
+ *   8      chunk size     4 bytes, bytes between checkpoints
+ *   12     reserved       8 bytes, zero (length is in the footer)
+ *   20     nonce          12 bytes, message nonce
+ *   32     ciphertext     length bytes
+ *   32+L   index          kaos_index_serialize output, encrypted
+ *   end-16 length         8 bytes, plaintext length
+ *   end-8  index size     8 bytes
+ *
+ * The length goes last so the writer never seeks: pipes work as output.
+ */
+
+#include "kaos_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define KAOS_CONTAINER_MAGIC "KAOS"
+
+/* Read/write unit of kaos_container_encrypt_fd */
+#define KAOS_CONTAINER_BUFFER (1u << 20)
+
+/* Segment number whose KAOS-P nonce encrypts the checkpoint table */
+#define KAOS_CONTAINER_INDEX_SEGMENT (UINT64_MAX - 1)
+
+struct KaosContainer {
+    int fd;
+    uint64_t length;       // Plaintext bytes
+    uint32_t chunk_size;
+    KaosIndex* index;      // Every checkpoint, attached to stream
+    KaosStream* stream;    // Warmed once; seeks between reads
+};
+
+static void kaos_container_put(uint8_t* p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint64_t kaos_container_get(const uint8_t* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static int kaos_container_write(int fd, const uint8_t* data, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        data += n;
+        length -= (size_t)n;
+    }
+    return 1;
+}
+
+/* Reads up to length bytes, fewer only at end of input; -1 on error */
+static ssize_t kaos_container_read(int fd, uint8_t* data, size_t length) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = read(fd, data + done, length - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n == 0) break;
+        done += (size_t)n;
+    }
+    return (ssize_t)done;
+}
+
+static int kaos_container_pread_all(int fd, uint8_t* data, size_t length, uint64_t offset) {
+    while (length > 0) {
+        ssize_t n = pread(fd, data, length, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        data += n;
+        length -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return 1;
+}
+
+/* Checkpoint table in or out of its encrypted form (XOR symmetry) */
+static int kaos_container_crypt_index(KaosCipher* cipher, uint8_t* table, size_t size,
+                                      const uint8_t* key, const uint8_t* nonce) {
+    uint8_t index_nonce[KAOS_NONCE_SIZE];
+    kaos_p_segment_nonce(nonce, KAOS_CONTAINER_INDEX_SEGMENT, index_nonce);
+    return kaos_encrypt_into(cipher, table, table, size, key, index_nonce);
+}
+
+/*
+ * WRITER - header, ciphertext with checkpoints recorded as it passes,
+ * encrypted table, footer
+ */
+int kaos_container_encrypt_fd(KaosCipher* cipher, int in_fd, int out_fd,
+                              const uint8_t* key_256bit, const uint8_t* nonce_96bit,
+                              uint32_t chunk_size) {
+    if (!cipher || in_fd < 0 || out_fd < 0 || !key_256bit || !nonce_96bit) {
+        return 0;
+    }
+
+    if (chunk_size == 0) {
+        chunk_size = KAOS_CONTAINER_CHUNK_DEFAULT;
+    }
+
+    uint8_t header[KAOS_CONTAINER_HEADER_SIZE];
+    memset(header, 0, sizeof(header));
+    memcpy(header, KAOS_CONTAINER_MAGIC, 4);
+    header[4] = KAOS_CONTAINER_VERSION;
+    header[5] = KAOS_CONTAINER_MODE_INDEXED;
+    kaos_container_put(header + 8, chunk_size, 4);
+    memcpy(header + 20, nonce_96bit, KAOS_NONCE_SIZE);
+
+    KaosIndex* index = kaos_index_new(chunk_size);
+    KaosStream* stream = kaos_stream_init(cipher, key_256bit, nonce_96bit);
+    uint8_t* buffer = (uint8_t*)malloc(KAOS_CONTAINER_BUFFER);
+    int ok = index && stream && buffer && kaos_stream_attach_index(stream, index) &&
+             kaos_container_write(out_fd, header, sizeof(header));
+
+    uint64_t length = 0;
+    ssize_t n = 0;
+    while (ok && (n = kaos_container_read(in_fd, buffer, KAOS_CONTAINER_BUFFER)) > 0) {
+        ok = kaos_stream_update(stream, buffer, buffer, (size_t)n) &&
+             kaos_container_write(out_fd, buffer, (size_t)n);
+        length += (uint64_t)n;
+    }
+    ok = ok && n == 0;
+
+    // Table is normally far smaller than the buffer (24 bytes per chunk)
+    size_t size = ok ? kaos_index_serialize(index, NULL, 0) : 0;
+    uint8_t* table = size > KAOS_CONTAINER_BUFFER ? (uint8_t*)malloc(size) : buffer;
+    ok = ok && size > 0 && table &&
+         kaos_index_serialize(index, table, size) == size &&
+         kaos_container_crypt_index(cipher, table, size, key_256bit, nonce_96bit) &&
+         kaos_container_write(out_fd, table, size);
+
+    uint8_t footer[KAOS_CONTAINER_FOOTER_SIZE];
+    kaos_container_put(footer, length, 8);
+    kaos_container_put(footer + 8, size, 8);
+    ok = ok && kaos_container_write(out_fd, footer, sizeof(footer));
+
+    // Plaintext and checkpoints are sensitive until overwritten
+    if (table && table != buffer) {
+        kaos_wipe(table, size);
+        free(table);
+    }
+    if (buffer) {
+        kaos_wipe(buffer, KAOS_CONTAINER_BUFFER);
+        free(buffer);
+    }
+    kaos_stream_final(stream);
+    kaos_index_free(index);
+    return ok;
+}
+
+/*
+ * READER
+ */
+KaosContainer* kaos_container_open(KaosCipher* cipher, int fd, const uint8_t* key_256bit) {
+    if (!cipher || fd < 0 || !key_256bit) {
+        return NULL;
+    }
+
+    // Header and footer must agree with the file size
+    struct stat st;
+    uint8_t header[KAOS_CONTAINER_HEADER_SIZE];
+    uint8_t footer[KAOS_CONTAINER_FOOTER_SIZE];
+    uint64_t file_size;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+        (file_size = (uint64_t)st.st_size) <
+            KAOS_CONTAINER_HEADER_SIZE + KAOS_CONTAINER_FOOTER_SIZE ||
+        !kaos_container_pread_all(fd, header, sizeof(header), 0) ||
+        !kaos_container_pread_all(fd, footer, sizeof(footer), file_size - sizeof(footer)) ||
+        memcmp(header, KAOS_CONTAINER_MAGIC, 4) != 0 ||
+        header[4] != KAOS_CONTAINER_VERSION || header[5] != KAOS_CONTAINER_MODE_INDEXED) {
+        return NULL;
+    }
+
+    uint32_t chunk_size = (uint32_t)kaos_container_get(header + 8, 4);
+    uint64_t length = kaos_container_get(footer, 8);
+    uint64_t size = kaos_container_get(footer + 8, 8);
+    uint64_t body = file_size - KAOS_CONTAINER_HEADER_SIZE - KAOS_CONTAINER_FOOTER_SIZE;
+    if (chunk_size == 0 || length > body || size != body - length ||
+        size < KAOS_INDEX_HEADER_SIZE || size > SIZE_MAX) {
+        return NULL;
+    }
+
+    KaosContainer* container = (KaosContainer*)calloc(1, sizeof(KaosContainer));
+    uint8_t* table = (uint8_t*)malloc((size_t)size);
+    int ok = container && table &&
+             kaos_container_pread_all(fd, table, (size_t)size,
+                                      KAOS_CONTAINER_HEADER_SIZE + length) &&
+             kaos_container_crypt_index(cipher, table, (size_t)size, key_256bit, header + 20);
+
+    // A wrong key leaves the table's own magic garbled
+    if (ok) {
+        container->fd = fd;
+        container->length = length;
+        container->chunk_size = chunk_size;
+        container->index = kaos_index_deserialize(table, (size_t)size);
+        ok = container->index != NULL &&
+             kaos_index_interval(container->index) == chunk_size &&
+             kaos_index_count(container->index) ==
+                 (length == 0 ? 0 : (length - 1) / chunk_size + 1);
+    }
+    if (ok) {
+        container->stream = kaos_stream_init(cipher, key_256bit, header + 20);
+        ok = container->stream != NULL &&
+             kaos_stream_attach_index(container->stream, container->index);
+    }
+
+    if (table) {
+        kaos_wipe(table, (size_t)size);
+        free(table);
+    }
+    if (!ok) {
+        kaos_container_free(container);
+        return NULL;
+    }
+    return container;
+}
+
+void kaos_container_free(KaosContainer* container) {
+    if (!container) {
+        return;
+    }
+
+    kaos_stream_final(container->stream);
+    kaos_index_free(container->index);
+    kaos_wipe(container, sizeof(KaosContainer));
+    free(container);
+}
+
+uint64_t kaos_container_length(const KaosContainer* container) {
+    return container ? container->length : 0;
+}
+
+int kaos_container_pread(KaosContainer* container, uint64_t offset, size_t length,
+                         uint8_t* out) {
+    if (!container || (length > 0 && !out) || offset > container->length ||
+        length > container->length - offset) {
+        return 0;
+    }
+    if (length == 0) {
+        return 1;
+    }
+
+    // Ciphertext straight into out, then decrypted in place
+    return kaos_seek(container->stream, offset) &&
+           kaos_container_pread_all(container->fd, out, length,
+                                    KAOS_CONTAINER_HEADER_SIZE + offset) &&
+           kaos_stream_update(container->stream, out, out, length);
+}
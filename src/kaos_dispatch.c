@@ -0,0 +1,288 @@
+/**
+ * KAOS CIPHER - Stream Cipher Based on Lorenz Chaotic System
+ * Runtime Kernel Dispatch
+ * Author: Simón M. Guiñazú
+ * Github: https://github.com/sysphersec/kaos-cipher
+ *
+ * CPU features are detected once at load time (cpuid + xgetbv).
+ * Every supported kernel, the portable scalar one included, is checked
+ * bit for bit against the reference lorenz_step + kaos_keystream_byte
+ * before it can be selected. A scalar kernel that fails (e.g. built with
+ * contraction or fast-math) is replaced by the reference itself.
+ * KAOS_KERNEL=<name> in the environment or kaos_set_kernel() forces a
+ * kernel for benchmarking.
+ */
+
+#include "kaos_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#ifdef KAOS_HAVE_X86
+#include <cpuid.h>
+#endif
+
+/* Self-check parameters - short warmup keeps startup cheap */
+#define KAOS_SELFCHECK_WARMUP 64
+#define KAOS_SELFCHECK_LENGTH 509
+#define KAOS_SELFCHECK_MESSAGES 11
+
+/* Kernel table, indexed by KaosKernelId */
+static const KaosKernel kaos_kernels[KAOS_KERNEL_COUNT] = {
+    { KAOS_KERNEL_SCALAR, "scalar", 0, kaos_stream_fused,  kaos_block_fused,  NULL,
+      kaos_xor_scalar },
+#ifdef KAOS_HAVE_X86
+    { KAOS_KERNEL_SSE2,   "sse2",   0, kaos_stream_sse2,   kaos_block_sse2,   NULL,
+      kaos_xor_sse2 },
+    { KAOS_KERNEL_AVX2,   "avx2",   4, kaos_stream_avx2,   kaos_block_avx2,   kaos_lanes_avx2,
+      kaos_xor_avx2 },
+    { KAOS_KERNEL_AVX512, "avx512", 8, kaos_stream_avx512, kaos_block_avx512, kaos_lanes_avx512,
+      kaos_xor_avx512 },
+#else
+    { KAOS_KERNEL_SSE2,   "sse2",   0, NULL, NULL, NULL, NULL },
+    { KAOS_KERNEL_AVX2,   "avx2",   0, NULL, NULL, NULL, NULL },
+    { KAOS_KERNEL_AVX512, "avx512", 0, NULL, NULL, NULL, NULL },
+#endif
+};
+
+/* Scalar slot when the fused scalar kernel fails its self-check */
+static const KaosKernel kaos_kernel_reference = {
+    KAOS_KERNEL_SCALAR, "scalar", KAOS_REFERENCE_LANES, kaos_stream_reference,
+    kaos_block_reference, kaos_lanes_reference, kaos_xor_scalar
+};
+
+/* Verified implementation per id (NULL = unsupported or failed) */
+static const KaosKernel* kaos_kernel_ok[KAOS_KERNEL_COUNT];
+
+static pthread_once_t kaos_dispatch_once = PTHREAD_ONCE_INIT;
+
+/* Selected kernel - written at load time or by kaos_set_kernel */
+static const KaosKernel* volatile kaos_selected = NULL;
+
+#ifdef KAOS_HAVE_X86
+/*
+ * CPU FEATURE DETECTION
+ * AVX/AVX-512 also need the OS to save YMM/ZMM state (XCR0)
+ */
+static uint64_t kaos_xgetbv(void) {
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+}
+
+static void kaos_detect_cpu(int supported[KAOS_KERNEL_COUNT]) {
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return;
+    }
+
+    supported[KAOS_KERNEL_SSE2] = (edx >> 26) & 1;
+
+    int osxsave = (ecx >> 27) & 1;
+    int avx = (ecx >> 28) & 1;
+    int sse41 = (ecx >> 19) & 1;
+    uint64_t xcr0 = osxsave ? kaos_xgetbv() : 0;
+    int ymm_state = (xcr0 & 0x6) == 0x6;
+    int zmm_state = (xcr0 & 0xE6) == 0xE6;
+
+    if (__get_cpuid_max(0, NULL) < 7) {
+        return;
+    }
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+
+    supported[KAOS_KERNEL_AVX2] = avx && sse41 && ymm_state && ((ebx >> 5) & 1);
+    supported[KAOS_KERNEL_AVX512] = supported[KAOS_KERNEL_AVX2] && zmm_state &&
+                                    ((ebx >> 16) & 1);
+}
+#endif
+
+/*
+ * SELF-CHECK - kernel must match lorenz_step + kaos_keystream_byte
+ * Covers a single stream at a large counter offset and a batch of
+ * unequal messages (lane refill)
+ */
+/* Batch with unequal lengths - lanes refill at different times */
+static int kaos_selfcheck_batch(KaosCipher* cipher, const uint8_t* key, const uint8_t* nonce,
+                                const uint8_t* in, size_t length, int width,
+                                KaosLaneKernel lane) {
+    KaosMessage msgs[KAOS_SELFCHECK_MESSAGES];
+    uint8_t nonces[KAOS_SELFCHECK_MESSAGES][KAOS_NONCE_SIZE];
+    uint8_t expected[KAOS_SELFCHECK_LENGTH];
+    uint8_t actual[KAOS_SELFCHECK_LENGTH];
+    size_t offset = 0;
+    for (int m = 0; m < KAOS_SELFCHECK_MESSAGES; m++) {
+        size_t len = (size_t)(m * 9 + 1);
+        if (offset + len > length) len = length - offset;
+        memcpy(nonces[m], nonce, KAOS_NONCE_SIZE);
+        nonces[m][0] ^= (uint8_t)m;
+
+        msgs[m].in = in + offset;
+        msgs[m].out = actual + offset;
+        msgs[m].length = len;
+        msgs[m].key = key;
+        msgs[m].nonce = nonces[m];
+
+        KaosState reference;
+        kaos_key_to_state(key, nonces[m], &reference.x, &reference.y, &reference.z);
+        for (int i = 0; i < cipher->warmup; i++) {
+            lorenz_step(cipher, &reference.x, &reference.y, &reference.z);
+        }
+        kaos_stream_reference(cipher, &reference, 0, in + offset, expected + offset, len);
+        offset += len;
+    }
+
+    kaos_batch_run(cipher, msgs, KAOS_SELFCHECK_MESSAGES, width, lane);
+
+    return memcmp(expected, actual, offset) == 0;
+}
+
+static int kaos_kernel_selfcheck(const KaosKernel* kernel) {
+    KaosCipher cipher;
+    kaos_init(&cipher);
+    cipher.warmup = KAOS_SELFCHECK_WARMUP;
+
+    uint8_t key[KAOS_KEY_SIZE];
+    uint8_t nonce[KAOS_NONCE_SIZE];
+    uint8_t in[KAOS_SELFCHECK_LENGTH];
+    uint8_t expected[KAOS_SELFCHECK_LENGTH];
+    uint8_t actual[KAOS_SELFCHECK_LENGTH];
+
+    for (int i = 0; i < KAOS_KEY_SIZE; i++) key[i] = (uint8_t)(i * 37 + 11);
+    for (int i = 0; i < KAOS_NONCE_SIZE; i++) nonce[i] = (uint8_t)(i * 101 + 3);
+    for (int i = 0; i < KAOS_SELFCHECK_LENGTH; i++) in[i] = (uint8_t)(i * 7);
+
+    // Single stream (XOR and raw block), counters near zero, far from zero
+    // and past 2^53 where the fused kernel switches arithmetic
+    const uint64_t offsets[3] = { 0, (1ULL << 40) + 12345, KAOS_EXACT_COUNTER - 100 };
+    for (int o = 0; o < 3; o++) {
+        KaosState reference, state, block_state;
+        kaos_key_to_state(key, nonce, &reference.x, &reference.y, &reference.z);
+        state = reference;
+        block_state = reference;
+
+        kaos_stream_reference(&cipher, &reference, offsets[o], in, expected, sizeof(in));
+        kernel->stream(&cipher, &state, offsets[o], in, actual, sizeof(in));
+
+        if (memcmp(expected, actual, sizeof(in)) != 0 ||
+            memcmp(&reference, &state, sizeof(KaosState)) != 0) {
+            return 0;
+        }
+
+        kernel->block(&cipher, &block_state, offsets[o], actual, sizeof(in));
+        for (size_t i = 0; i < sizeof(in); i++) {
+            if ((uint8_t)(actual[i] ^ in[i]) != expected[i]) {
+                return 0;
+            }
+        }
+        if (memcmp(&reference, &block_state, sizeof(KaosState)) != 0) {
+            return 0;
+        }
+    }
+
+    // Tile XOR at output/keystream misalignments, out of place then in place
+    for (size_t shift = 0; shift < 64; shift += 7) {
+        const uint8_t* keystream = expected + (shift % 5);
+        size_t n = sizeof(in) - 64;
+
+        kernel->apply(actual + shift, in + shift, keystream, n);
+        for (size_t i = 0; i < n; i++) {
+            if (actual[shift + i] != (uint8_t)(in[shift + i] ^ keystream[i])) {
+                return 0;
+            }
+        }
+        kernel->apply(actual + shift, actual + shift, keystream, n);
+        if (memcmp(actual + shift, in + shift, n) != 0) {
+            return 0;
+        }
+    }
+
+    // Vector kernels batch in their own lanes; scalar hosts use the
+    // interleaved engine, checked at every width kaos_set_interleave allows
+    if (kernel->lanes > 0) {
+        return kaos_selfcheck_batch(&cipher, key, nonce, in, sizeof(in),
+                                    kernel->lanes, kernel->lane);
+    }
+    return kaos_selfcheck_batch(&cipher, key, nonce, in, sizeof(in), 2, kaos_lanes_scalar2) &&
+           kaos_selfcheck_batch(&cipher, key, nonce, in, sizeof(in), 4, kaos_lanes_scalar4) &&
+           kaos_selfcheck_batch(&cipher, key, nonce, in, sizeof(in), 8, kaos_lanes_scalar8);
+}
+
+/*
+ * LOAD-TIME INITIALIZATION - exactly once (pthread_once)
+ * Detect, verify, then pick the forced (KAOS_KERNEL) or widest kernel
+ */
+static void kaos_dispatch_init(void) {
+    int supported[KAOS_KERNEL_COUNT] = { 1 };  // Scalar always present
+
+#ifdef KAOS_HAVE_X86
+    kaos_detect_cpu(supported);
+#endif
+
+    // Self-check work is not the application's: kept out of kaos_stats
+    KAOS_STATS_PAUSE(1);
+
+    kaos_kernel_ok[KAOS_KERNEL_SCALAR] = kaos_kernel_selfcheck(&kaos_kernels[KAOS_KERNEL_SCALAR]) ?
+                                         &kaos_kernels[KAOS_KERNEL_SCALAR] :
+                                         &kaos_kernel_reference;
+    const KaosKernel* best = kaos_kernel_ok[KAOS_KERNEL_SCALAR];
+
+    for (int k = KAOS_KERNEL_SCALAR + 1; k < KAOS_KERNEL_COUNT; k++) {
+        if (supported[k] && kaos_kernels[k].stream &&
+            kaos_kernel_selfcheck(&kaos_kernels[k])) {
+            kaos_kernel_ok[k] = &kaos_kernels[k];
+            best = kaos_kernel_ok[k];
+        }
+    }
+
+    KAOS_STATS_PAUSE(0);
+
+    const char* forced = getenv("KAOS_KERNEL");
+    if (forced) {
+        for (int k = 0; k < KAOS_KERNEL_COUNT; k++) {
+            if (kaos_kernel_ok[k] && strcmp(forced, kaos_kernels[k].name) == 0) {
+                best = kaos_kernel_ok[k];
+            }
+        }
+    }
+
+    kaos_selected = best;
+}
+
+__attribute__((constructor))
+static void kaos_dispatch_constructor(void) {
+    pthread_once(&kaos_dispatch_once, kaos_dispatch_init);
+}
+
+const KaosKernel* kaos_active_kernel(void) {
+    // Covers calls made before constructors ran (e.g. from other constructors)
+    pthread_once(&kaos_dispatch_once, kaos_dispatch_init);
+    return kaos_selected;
+}
+
+KaosKernelId kaos_get_kernel(void) {
+    return kaos_active_kernel()->id;
+}
+
+int kaos_set_kernel(KaosKernelId id) {
+    kaos_active_kernel();
+
+    if (id < 0 || id >= KAOS_KERNEL_COUNT || !kaos_kernel_ok[id]) {
+        return 0;
+    }
+
+    kaos_selected = kaos_kernel_ok[id];
+    return 1;
+}
+
+int kaos_kernel_available(KaosKernelId id) {
+    kaos_active_kernel();
+    return id >= 0 && id < KAOS_KERNEL_COUNT && kaos_kernel_ok[id] != NULL;
+}
+
+const char* kaos_kernel_name(KaosKernelId id) {
+    if (id < 0 || id >= KAOS_KERNEL_COUNT) {
+        return "unknown";
+    }
+    return kaos_kernels[id].name;
+}
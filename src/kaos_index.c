@@ -0,0 +1,294 @@
+/**
+ * KAOS CIPHER - Stream Cipher Based on Lorenz Chaotic System
+ * Checkpoint Index and Stream Seeking
+ * Author: Simón M. Guiñazú
+ * Github: https://github.com/sysphersec/kaos-cipher
+ *
+ * The Lorenz state at byte N only exists after N steps from the warmed
+ * state. An index stores the state every `interval` bytes so reaching
+ * byte N costs at most interval - 1 steps from the closest checkpoint.
+ * Keystream generation is skipped while replaying: the state update does
+ * not depend on the emitted bytes.
+ */
+
+/* Replayed steps must round exactly like the scalar reference */
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#include "kaos_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Serialization format */
+#define KAOS_INDEX_MAGIC "KIDX"
+#define KAOS_INDEX_VERSION 1
+
+struct KaosIndex {
+    uint32_t interval;     // Bytes between checkpoints
+    uint64_t count;        // Checkpoints recorded
+    uint64_t capacity;     // Checkpoints allocated
+    KaosState* states;     // states[i] = state before byte i * interval
+};
+
+/*
+ * INDEX LIFETIME
+ */
+KaosIndex* kaos_index_new(uint32_t interval) {
+    if (interval == 0) {
+        return NULL;
+    }
+
+    KaosIndex* index = (KaosIndex*)calloc(1, sizeof(KaosIndex));
+    if (!index) {
+        return NULL;
+    }
+
+    index->interval = interval;
+    return index;
+}
+
+void kaos_index_free(KaosIndex* index) {
+    if (!index) {
+        return;
+    }
+
+    // Checkpoints are key-equivalent material
+    if (index->states) {
+        kaos_wipe(index->states, (size_t)index->capacity * sizeof(KaosState));
+        free(index->states);
+    }
+    kaos_wipe(index, sizeof(KaosIndex));
+    free(index);
+}
+
+uint32_t kaos_index_interval(const KaosIndex* index) {
+    return index ? index->interval : 0;
+}
+
+uint64_t kaos_index_count(const KaosIndex* index) {
+    return index ? index->count : 0;
+}
+
+/*
+ * RECORDING - checkpoints are appended in order, never with gaps
+ */
+int kaos_index_reserve(KaosIndex* index, uint64_t end) {
+    if (end == 0) {
+        return 1;
+    }
+
+    uint64_t needed = (end - 1) / index->interval + 1;
+    if (needed <= index->capacity) {
+        return 1;
+    }
+
+    uint64_t capacity = index->capacity ? index->capacity : 16;
+    while (capacity < needed) capacity *= 2;
+    if (capacity > SIZE_MAX / sizeof(KaosState)) {
+        return 0;
+    }
+
+    // Copy instead of realloc so the old block can be wiped
+    KaosState* states = (KaosState*)malloc((size_t)capacity * sizeof(KaosState));
+    if (!states) {
+        return 0;
+    }
+
+    if (index->states) {
+        memcpy(states, index->states, (size_t)index->count * sizeof(KaosState));
+        kaos_wipe(index->states, (size_t)index->capacity * sizeof(KaosState));
+        free(index->states);
+    }
+
+    index->states = states;
+    index->capacity = capacity;
+    return 1;
+}
+
+void kaos_index_record(KaosIndex* index, uint64_t position, const KaosState* state) {
+    if (position % index->interval != 0 || position / index->interval != index->count ||
+        index->count == index->capacity) {
+        return;
+    }
+
+    index->states[index->count++] = *state;
+}
+
+/*
+ * SERIALIZATION - fixed little-endian layout, independent of host
+ */
+static void kaos_put_u32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static void kaos_put_u64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint32_t kaos_get_u32(const uint8_t* p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static uint64_t kaos_get_u64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static void kaos_put_double(uint8_t* p, double d) {
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    kaos_put_u64(p, bits);
+}
+
+static double kaos_get_double(const uint8_t* p) {
+    uint64_t bits = kaos_get_u64(p);
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+size_t kaos_index_serialize(const KaosIndex* index, uint8_t* out, size_t capacity) {
+    if (!index || index->count > (SIZE_MAX - KAOS_INDEX_HEADER_SIZE) / KAOS_INDEX_ENTRY_SIZE) {
+        return 0;
+    }
+
+    size_t size = KAOS_INDEX_HEADER_SIZE + (size_t)index->count * KAOS_INDEX_ENTRY_SIZE;
+    if (!out || capacity < size) {
+        return size;
+    }
+
+    memcpy(out, KAOS_INDEX_MAGIC, 4);
+    kaos_put_u32(out + 4, KAOS_INDEX_VERSION);
+    kaos_put_u32(out + 8, index->interval);
+    kaos_put_u32(out + 12, 0);
+    kaos_put_u64(out + 16, index->count);
+
+    uint8_t* p = out + KAOS_INDEX_HEADER_SIZE;
+    for (uint64_t i = 0; i < index->count; i++, p += KAOS_INDEX_ENTRY_SIZE) {
+        kaos_put_double(p, index->states[i].x);
+        kaos_put_double(p + 8, index->states[i].y);
+        kaos_put_double(p + 16, index->states[i].z);
+    }
+
+    return size;
+}
+
+KaosIndex* kaos_index_deserialize(const uint8_t* data, size_t length) {
+    if (!data || length < KAOS_INDEX_HEADER_SIZE ||
+        memcmp(data, KAOS_INDEX_MAGIC, 4) != 0 ||
+        kaos_get_u32(data + 4) != KAOS_INDEX_VERSION) {
+        return NULL;
+    }
+
+    uint64_t count = kaos_get_u64(data + 16);
+    if (count > (length - KAOS_INDEX_HEADER_SIZE) / KAOS_INDEX_ENTRY_SIZE ||
+        length != KAOS_INDEX_HEADER_SIZE + (size_t)count * KAOS_INDEX_ENTRY_SIZE) {
+        return NULL;
+    }
+
+    KaosIndex* index = kaos_index_new(kaos_get_u32(data + 8));
+    if (!index) {
+        return NULL;
+    }
+    if (count > 0 && !kaos_index_reserve(index, count * index->interval)) {
+        kaos_index_free(index);
+        return NULL;
+    }
+
+    const uint8_t* p = data + KAOS_INDEX_HEADER_SIZE;
+    for (uint64_t i = 0; i < count; i++, p += KAOS_INDEX_ENTRY_SIZE) {
+        KaosState* state = &index->states[i];
+        state->x = kaos_get_double(p);
+        state->y = kaos_get_double(p + 8);
+        state->z = kaos_get_double(p + 16);
+
+        if (!isfinite(state->x) || !isfinite(state->y) || !isfinite(state->z)) {
+            kaos_index_free(index);
+            return NULL;
+        }
+    }
+    index->count = count;
+
+    return index;
+}
+
+/*
+ * STREAM SEEKING
+ */
+int kaos_stream_attach_index(KaosStream* stream, KaosIndex* index) {
+    if (!stream) {
+        return 0;
+    }
+
+    stream->index = index;
+    return 1;
+}
+
+/* Lorenz steps only - state kept in registers */
+static void kaos_replay(const KaosCipher* cipher, KaosState* state, uint64_t steps) {
+    double x = state->x, y = state->y, z = state->z;
+
+    for (uint64_t i = 0; i < steps; i++) {
+        kaos_lorenz_inline(cipher, &x, &y, &z);
+    }
+
+    state->x = x;
+    state->y = y;
+    state->z = z;
+}
+
+int kaos_seek(KaosStream* stream, uint64_t offset) {
+    if (!stream) {
+        return 0;
+    }
+
+    KaosIndex* index = stream->index;
+    if (index && !kaos_index_reserve(index, offset)) {
+        return 0;
+    }
+
+    // Closest known state at or before offset
+    uint64_t position = 0;
+    KaosState state = stream->origin;
+
+    if (stream->counter <= offset) {
+        position = stream->counter;
+        state = stream->state;
+    }
+    if (index && index->count > 0) {
+        uint64_t checkpoint = offset / index->interval;
+        if (checkpoint >= index->count) checkpoint = index->count - 1;
+
+        if (checkpoint * index->interval > position) {
+            position = checkpoint * index->interval;
+            state = index->states[checkpoint];
+        }
+    }
+
+    // Replay to offset, extending the index across any boundary passed
+    while (position < offset) {
+        uint64_t n = offset - position;
+
+        if (index) {
+            kaos_index_record(index, position, &state);
+            uint64_t to_boundary = index->interval - position % index->interval;
+            if (n > to_boundary) n = to_boundary;
+        }
+
+        kaos_replay(&stream->cipher, &state, n);
+        position += n;
+    }
+
+    stream->state = state;
+    stream->counter = offset;
+    kaos_wipe(&state, sizeof(state));
+
+    return 1;
+}
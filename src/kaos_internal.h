@@ -0,0 +1,343 @@
+/**
+ * KAOS CIPHER - Stream Cipher Based on Lorenz Chaotic System
+ * Internal definitions shared by the library sources
+ * NOT part of the public API - do not include from applications
+ * Author: Simón M. Guiñazú
+ * Github: https://github.com/sysphersec/kaos-cipher
+ */
+
+#ifndef KAOS_INTERNAL_H
+#define KAOS_INTERNAL_H
+
+#include "kaos.h"
+#include <math.h>
+
+/* Keystream mixing constants */
+#define KAOS_PHI 1.6180339887498948482      // Golden ratio
+#define KAOS_E   2.71828182845904523536     // Euler's number
+#define KAOS_PI  3.14159265358979323846     // Pi
+#define KAOS_PERTURBATION 0.0000001         // Counter perturbation scale
+
+/* Position counters stay exact as doubles below 2^53 */
+#define KAOS_EXACT_COUNTER (1ULL << 53)
+
+/* Non-negative doubles at or above 2^52 have no fractional part */
+#define KAOS_TWO52 4503599627370496.0
+
+/* Widest lane group advanced in lockstep (AVX-512: 8 doubles) */
+#define KAOS_MAX_LANES 8
+
+/*
+ * Non-linear post-processing of the raw keystream byte
+ * Integer tail of kaos_keystream_byte, shared by every engine
+ */
+static inline uint8_t kaos_byte_finish(uint8_t byte, uint64_t counter) {
+    byte = (byte + (counter & 0xFF)) & 0xFF;           // Avalanche enhancement
+    byte ^= (byte >> 4) ^ (byte << 3) ^ (counter % 97); // Non-linearity
+    byte = (byte * 167 + 123) & 0xFF;                  // Random walk
+    return byte;
+}
+
+/*
+ * Inline Lorenz step - same operation order as lorenz_step
+ * Always inlined into every ISA-specific kernel build, also across
+ * per-function optimize attributes (kaos_warmup)
+ */
+__attribute__((always_inline))
+static inline void kaos_lorenz_inline(const KaosCipher* cipher,
+                                      double* x, double* y, double* z) {
+    double dx = cipher->sigma * (*y - *x) * cipher->dt;
+    double dy = (*x * (cipher->rho - *z) - *y) * cipher->dt;
+    double dz = (*x * *y - cipher->beta * *z) * cipher->dt;
+    
+    *x += dx;
+    *y += dy;
+    *z += dz;
+}
+
+/*
+ * Inline keystream byte - same operation order as kaos_keystream_byte
+ */
+static inline uint8_t kaos_keystream_inline(double x, double y, double z,
+                                            uint64_t counter) {
+    // Core Lorenz combination
+    double combined = (x * KAOS_PHI) + (y * KAOS_E) + (z * KAOS_PI);
+    double fractional = fabs(combined) - floor(fabs(combined));
+    
+    // Counter-based perturbation for uniqueness
+    double perturbation = counter * KAOS_PERTURBATION;
+    fractional = fmod(fractional + perturbation, 1.0);
+    
+    // Convert to byte, then non-linear post-processing
+    return kaos_byte_finish((uint8_t)(fractional * 256.0), counter);
+}
+
+/*
+ * PHASE STATISTICS - compiled out unless built with -DKAOS_STATS
+ * KAOS_STATS_START(t) reads the tick counter into a new variable t,
+ * KAOS_STATS_STOP charges the ticks since then to the calling thread
+ */
+#ifdef KAOS_STATS
+/* Monotonic nanoseconds (tick source without a TSC) */
+uint64_t kaos_stats_clock(void);
+
+static inline uint64_t kaos_stats_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return kaos_stats_clock();
+#endif
+}
+
+void kaos_stats_record(KaosPhase phase, uint64_t calls, uint64_t bytes, uint64_t ticks);
+
+/* Non-zero: the calling thread's work is not recorded (library self-checks) */
+void kaos_stats_pause(int paused);
+
+#define KAOS_STATS_START(t) uint64_t t = kaos_stats_ticks()
+#define KAOS_STATS_STOP(phase, t, calls, bytes) \
+    kaos_stats_record((phase), (calls), (bytes), kaos_stats_ticks() - (t))
+#define KAOS_STATS_PAUSE(paused) kaos_stats_pause(paused)
+#else
+#define KAOS_STATS_START(t) ((void)0)
+#define KAOS_STATS_STOP(phase, t, calls, bytes) ((void)0)
+#define KAOS_STATS_PAUSE(paused) ((void)0)
+#endif
+
+/*
+ * FUSED KEYSTREAM - length raw keystream bytes, state kept in registers
+ * Strength-reduced but bit-exact with lorenz_step + kaos_keystream_byte:
+ *  - floor and fmod of non-negative values become integer truncation
+ *  - counter % 97 is a running residue, counter & 0xFF a byte wrap
+ *  - the perturbation uses a running double position (exact below 2^53)
+ * Always inlined so each ISA build of a kernel gets its own copy
+ */
+__attribute__((always_inline))
+static inline void kaos_keystream_fused(const KaosCipher* cipher, KaosState* state,
+                                        uint64_t counter, uint8_t* out, size_t length) {
+    double x = state->x, y = state->y, z = state->z;
+
+    if (counter >= KAOS_EXACT_COUNTER || length > KAOS_EXACT_COUNTER - counter) {
+        // Astronomically far into a stream - per-byte reference arithmetic
+        for (size_t i = 0; i < length; i++) {
+            kaos_lorenz_inline(cipher, &x, &y, &z);
+            out[i] = kaos_keystream_inline(x, y, z, counter + i);
+        }
+        state->x = x; state->y = y; state->z = z;
+        return;
+    }
+
+    const double sigma = cipher->sigma, rho = cipher->rho;
+    const double beta = cipher->beta, dt = cipher->dt;
+    double position = (double)counter;
+    unsigned residue = (unsigned)(counter % 97);
+    uint8_t low = (uint8_t)counter;
+
+    for (size_t i = 0; i < length; i++) {
+        double dx = sigma * (y - x) * dt;
+        double dy = (x * (rho - z) - y) * dt;
+        double dz = (x * y - beta * z) * dt;
+        x += dx;
+        y += dy;
+        z += dz;
+
+        double combined = (x * KAOS_PHI) + (y * KAOS_E) + (z * KAOS_PI);
+        double magnitude = fabs(combined);
+        double fractional = magnitude < KAOS_TWO52 ?
+                            magnitude - (double)(int64_t)magnitude : 0.0;
+        double sum = fractional + position * KAOS_PERTURBATION;
+        fractional = sum - (double)(int64_t)sum;
+
+        uint8_t byte = (uint8_t)(int32_t)(fractional * 256.0);
+        byte = (uint8_t)(byte + low);
+        byte ^= (uint8_t)((byte >> 4) ^ (byte << 3) ^ residue);
+        out[i] = (uint8_t)(byte * 167 + 123);
+
+        position += 1.0;
+        low++;
+        residue = (residue == 96) ? 0 : residue + 1;
+    }
+
+    state->x = x; state->y = y; state->z = z;
+}
+
+/* Zeroize key-equivalent material (not removed by dead store elimination) */
+void kaos_wipe(void* ptr, size_t length);
+
+/* Keystream tile: generated in one pass, then XORed in one pass.
+ * 8 KiB leaves most of a 32 KiB L1D for the input and output lines */
+#define KAOS_TILE_SIZE 8192
+
+/* out[i] = in[i] ^ keystream[i]; in and out may alias, no alignment needed */
+typedef void (*KaosXorKernel)(uint8_t* out, const uint8_t* in,
+                              const uint8_t* keystream, size_t length);
+
+/*
+ * TILED XOR - generate a keystream tile into aligned scratch, then apply
+ * it with the vector XOR kernel, so the XOR never waits on the Lorenz
+ * dependency chain. in and out may alias
+ */
+__attribute__((always_inline))
+static inline void kaos_xor_tiled(const KaosCipher* cipher, KaosState* state,
+                                  uint64_t counter, const uint8_t* in,
+                                  uint8_t* out, size_t length, KaosXorKernel apply) {
+    _Alignas(64) uint8_t tile[KAOS_TILE_SIZE];
+    size_t used = length < KAOS_TILE_SIZE ? length : KAOS_TILE_SIZE;
+
+    while (length > 0) {
+        size_t n = length < KAOS_TILE_SIZE ? length : KAOS_TILE_SIZE;
+        KAOS_STATS_START(generate_start);
+        kaos_keystream_fused(cipher, state, counter, tile, n);
+        KAOS_STATS_STOP(KAOS_PHASE_KEYSTREAM, generate_start, 1, n);
+        KAOS_STATS_START(apply_start);
+        apply(out, in, tile, n);
+        KAOS_STATS_STOP(KAOS_PHASE_XOR, apply_start, 1, n);
+        in += n;
+        out += n;
+        counter += n;
+        length -= n;
+    }
+
+    // Keystream is key-equivalent
+    kaos_wipe(tile, used);
+}
+
+/* ===== KERNELS ===== */
+
+/* Structure-of-arrays Lorenz state for one lane group */
+typedef struct {
+    _Alignas(64) double x[KAOS_MAX_LANES];
+    _Alignas(64) double y[KAOS_MAX_LANES];
+    _Alignas(64) double z[KAOS_MAX_LANES];
+} KaosLanes;
+
+/* Per-lane output of one run - in[l] == NULL means lane l only steps */
+typedef struct {
+    const uint8_t* in[KAOS_MAX_LANES];
+    uint8_t* out[KAOS_MAX_LANES];
+    uint64_t counter[KAOS_MAX_LANES];
+    int emitting;                      // Number of lanes with in[l] != NULL
+} KaosLaneEmit;
+
+/* Advances every lane `steps` times, XORing keystream for emitting lanes */
+typedef void (*KaosLaneKernel)(KaosCipher* cipher, KaosLanes* lanes,
+                               const KaosLaneEmit* emit, size_t steps);
+
+/* Advances one stream length times, out[i] = in[i] ^ keystream(counter + i) */
+typedef void (*KaosStreamKernel)(KaosCipher* cipher, KaosState* state, uint64_t counter,
+                                 const uint8_t* in, uint8_t* out, size_t length);
+
+/* Advances one stream length times, out[i] = keystream(counter + i) */
+typedef void (*KaosBlockKernel)(KaosCipher* cipher, KaosState* state, uint64_t counter,
+                                uint8_t* out, size_t length);
+
+/* One compiled kernel variant */
+typedef struct {
+    KaosKernelId id;
+    const char* name;
+    int lanes;                 // Batch lane width, 0 = one message at a time
+    KaosStreamKernel stream;   // Single-stream keystream XOR
+    KaosBlockKernel block;     // Single-stream raw keystream
+    KaosLaneKernel lane;       // Batch lane group (NULL if lanes == 0)
+    KaosXorKernel apply;       // Keystream tile XOR
+} KaosKernel;
+
+/* Kernel selected by the dispatcher (never NULL) */
+const KaosKernel* kaos_active_kernel(void);
+
+/* Reference - out-of-line lorenz_step + kaos_keystream_byte per byte */
+void kaos_stream_reference(KaosCipher* cipher, KaosState* state, uint64_t counter,
+                           const uint8_t* in, uint8_t* out, size_t length);
+
+/* Reference fallback for a scalar kernel that fails its self-check */
+#define KAOS_REFERENCE_LANES 1
+void kaos_block_reference(KaosCipher* cipher, KaosState* state, uint64_t counter,
+                          uint8_t* out, size_t length);
+void kaos_lanes_reference(KaosCipher* cipher, KaosLanes* lanes,
+                          const KaosLaneEmit* emit, size_t steps);
+
+/* Portable fused kernels (KAOS_KERNEL_SCALAR) */
+void kaos_stream_fused(KaosCipher* cipher, KaosState* state, uint64_t counter,
+                       const uint8_t* in, uint8_t* out, size_t length);
+void kaos_block_fused(KaosCipher* cipher, KaosState* state, uint64_t counter,
+                      uint8_t* out, size_t length);
+void kaos_xor_scalar(uint8_t* out, const uint8_t* in, const uint8_t* keystream,
+                     size_t length);
+
+/* Interleaved scalar lane kernels (2, 4, 8 streams per loop body) */
+void kaos_lanes_scalar2(KaosCipher* cipher, KaosLanes* lanes,
+                        const KaosLaneEmit* emit, size_t steps);
+void kaos_lanes_scalar4(KaosCipher* cipher, KaosLanes* lanes,
+                        const KaosLaneEmit* emit, size_t steps);
+void kaos_lanes_scalar8(KaosCipher* cipher, KaosLanes* lanes,
+                        const KaosLaneEmit* emit, size_t steps);
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KAOS_HAVE_X86 1
+
+#define KAOS_DECLARE_STREAM_KERNELS(isa)                                            \
+    void kaos_stream_##isa(KaosCipher* cipher, KaosState* state, uint64_t counter,  \
+                           const uint8_t* in, uint8_t* out, size_t length);         \
+    void kaos_block_##isa(KaosCipher* cipher, KaosState* state, uint64_t counter,   \
+                          uint8_t* out, size_t length);                             \
+    void kaos_xor_##isa(uint8_t* out, const uint8_t* in, const uint8_t* keystream,  \
+                        size_t length);
+
+KAOS_DECLARE_STREAM_KERNELS(sse2)
+KAOS_DECLARE_STREAM_KERNELS(avx2)
+KAOS_DECLARE_STREAM_KERNELS(avx512)
+
+void kaos_lanes_avx2(KaosCipher* cipher, KaosLanes* lanes,
+                     const KaosLaneEmit* emit, size_t steps);
+void kaos_lanes_avx512(KaosCipher* cipher, KaosLanes* lanes,
+                       const KaosLaneEmit* emit, size_t steps);
+#endif
+
+/* Key+nonce to initial state plus cipher->warmup Lorenz steps */
+void kaos_warm_state(KaosCipher* cipher, const uint8_t* key_256bit,
+                     const uint8_t* nonce_96bit, KaosState* state);
+
+/* cipher->warmup Lorenz steps on an initial state, in place */
+void kaos_warmup(KaosCipher* cipher, KaosState* state);
+
+/* Keystream XOR on the dispatcher's kernel */
+void kaos_xor_keystream(KaosCipher* cipher, KaosState* state, uint64_t counter,
+                        const uint8_t* in, uint8_t* out, size_t length);
+
+/* Streaming context (opaque in kaos.h) */
+struct KaosStream {
+    KaosCipher cipher;     // Copy of the (fixed) parameters
+    KaosState state;       // Current Lorenz state
+    KaosState origin;      // State at position 0 (backward seeks)
+    uint64_t counter;      // Current stream position in bytes
+    KaosIndex* index;      // Attached checkpoint index or NULL
+};
+
+/* Streaming context starting at position 0 of a warmed state */
+KaosStream* kaos_stream_from_state(KaosCipher* cipher, const KaosState* state);
+
+/* Grows the index to hold every checkpoint below end, returns 1/0 */
+int kaos_index_reserve(KaosIndex* index, uint64_t end);
+
+/* Stores state as the checkpoint at position if it is the next one due */
+void kaos_index_record(KaosIndex* index, uint64_t position, const KaosState* state);
+
+/* One task of a parallel loop */
+typedef void (*KaosTaskFn)(void* ctx, size_t task);
+
+/* Online CPU count (at least 1) */
+int kaos_default_threads(void);
+
+/* Runs fn(ctx, task) for task = 0 .. count-1 on up to threads threads
+ * (threads <= 0: one per online CPU); returns when all tasks are done */
+void kaos_parallel_for(size_t count, int threads, KaosTaskFn fn, void* ctx);
+
+/* Batch lane scheduler driving one lane kernel */
+void kaos_batch_run(KaosCipher* cipher, KaosMessage* msgs, size_t count,
+                    int width, KaosLaneKernel kernel);
+
+/* Batch on an explicit kernel (used by the dispatcher self-check) */
+void kaos_batch_with_kernel(KaosCipher* cipher, KaosMessage* msgs, size_t count,
+                            const KaosKernel* kernel);
+
+#endif /* KAOS_INTERNAL_H */
@@ -0,0 +1,675 @@
+/**
+ * KAOS CIPHER - Stream Cipher Based on Lorenz Chaotic System
+ * Descriptor Pipeline - overlapped read, encrypt and write
+ * Author: Simón M. Guiñazú
+ * Github: https://github.com/sysphersec/kaos-cipher
+ *
+ * A ring of depth chunk buffers cycles through FREE -> READING -> READY
+ * -> ENCRYPTED -> WRITING -> FREE. Chunk i always uses buffer i % depth,
+ * so buffers are recycled in stream order and the single encrypting
+ * thread only ever waits for one specific chunk. I/O goes through an
+ * io_uring (raw system calls, buffers and descriptors registered when
+ * the kernel and RLIMIT_MEMLOCK allow) or, where io_uring is missing or
+ * disabled, through a reader and a writer thread using pread/pwrite.
+ * Regular files take concurrent I/O at explicit offsets; pipes keep one
+ * read and one write in flight so their byte order is preserved.
+ */
+
+#define _GNU_SOURCE
+#include "kaos_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(IORING_FEAT_RW_CUR_POS)
+#define KAOS_HAVE_URING 1
+#endif
+#endif
+#endif
+
+/* Defaults */
+#define KAOS_PIPE_CHUNK (1u << 20)
+#define KAOS_PIPE_DEPTH 4
+#define KAOS_PIPE_MIN_DEPTH 3     // One reading, one encrypting, one writing
+#define KAOS_PIPE_MAX_DEPTH 64
+#define KAOS_PIPE_UNKNOWN UINT64_MAX
+
+typedef enum {
+    SLOT_FREE,
+    SLOT_READING,
+    SLOT_READY,
+    SLOT_ENCRYPTED,
+    SLOT_WRITING
+} KaosSlotState;
+
+typedef struct {
+    uint8_t* data;
+    KaosSlotState state;
+    uint64_t index;            // Chunk number
+    uint64_t in_offset;        // Input position (regular files)
+    uint64_t out_offset;       // Output position (regular files)
+    size_t length;             // Bytes wanted from the read
+    size_t filled;             // Bytes read so far
+    size_t written;            // Bytes written so far
+} KaosSlot;
+
+typedef struct {
+    KaosStream* stream;
+    int in_fd, out_fd;
+    int in_regular, out_regular;
+    uint64_t in_start, out_start;
+    uint64_t in_length;        // Bytes to read (regular input)
+    size_t chunk;
+    int depth;
+    KaosSlot* slots;
+    uint64_t last;             // Chunk count, KAOS_PIPE_UNKNOWN until EOF is seen
+    uint64_t out_pos;          // Output bytes assigned so far
+    int failed;
+    KaosPipelineStats stats;
+} KaosPipeline;
+
+static double kaos_pipe_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static KaosSlot* kaos_pipe_slot(KaosPipeline* p, uint64_t index) {
+    return &p->slots[index % (uint64_t)p->depth];
+}
+
+/* Claim the slot for chunk index and describe the read it needs */
+static void kaos_pipe_begin_read(KaosPipeline* p, KaosSlot* s, uint64_t index) {
+    s->index = index;
+    s->filled = 0;
+    s->written = 0;
+    s->length = p->chunk;
+    if (p->in_regular) {
+        uint64_t offset = index * (uint64_t)p->chunk;
+        s->in_offset = p->in_start + offset;
+        if (p->in_length - offset < p->chunk) {
+            s->length = (size_t)(p->in_length - offset);
+        }
+    }
+    s->state = SLOT_READING;
+}
+
+/*
+ * Account a finished read of res bytes. Returns 1 if the read must be
+ * reissued for the rest of the chunk, 0 if the slot moved on
+ */
+static int kaos_pipe_read_done(KaosPipeline* p, KaosSlot* s, ssize_t res) {
+    if (res < 0) {
+        p->failed = 1;
+        return 0;
+    }
+    if (res == 0) {
+        // Regular input shrank under us; a pipe reached its end
+        if (p->in_regular) {
+            p->failed = 1;
+            return 0;
+        }
+        p->last = s->filled > 0 ? s->index + 1 : s->index;
+        s->state = s->filled > 0 ? SLOT_READY : SLOT_FREE;
+        return 0;
+    }
+    s->filled += (size_t)res;
+    if (s->filled < s->length) {
+        return 1;
+    }
+    s->state = SLOT_READY;
+    return 0;
+}
+
+/* Bookkeeping once a ready chunk has been encrypted in place */
+static void kaos_pipe_encrypted(KaosPipeline* p, KaosSlot* s, int ok) {
+    if (!ok) {
+        p->failed = 1;
+    }
+    s->out_offset = p->out_start + p->out_pos;
+    p->out_pos += s->filled;
+    p->stats.bytes += s->filled;
+    p->stats.chunks++;
+    s->state = SLOT_ENCRYPTED;
+}
+
+/* Returns 1 if the write must be reissued for the rest of the chunk */
+static int kaos_pipe_write_done(KaosPipeline* p, KaosSlot* s, ssize_t res) {
+    if (res <= 0) {
+        p->failed = 1;
+        return 0;
+    }
+    s->written += (size_t)res;
+    if (s->written < s->filled) {
+        return 1;
+    }
+    s->state = SLOT_FREE;
+    return 0;
+}
+
+#ifdef KAOS_HAVE_URING
+/*
+ * IO_URING BACKEND
+ */
+typedef struct {
+    int fd;
+    unsigned entries;
+    void* sq_ring;
+    size_t sq_ring_size;
+    void* cq_ring;
+    size_t cq_ring_size;
+    struct io_uring_sqe* sqes;
+    size_t sqes_size;
+    _Atomic unsigned* sq_tail;
+    unsigned sq_mask;
+    unsigned* sq_array;
+    _Atomic unsigned* cq_head;
+    _Atomic unsigned* cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe* cqes;
+    unsigned to_submit;        // Queued since the last io_uring_enter
+    unsigned inflight;         // Queued, not completed (at most depth: the SQ never fills)
+    int fixed_files;
+    int fixed_buffers;
+} KaosUring;
+
+/* user_data: slot number and direction */
+#define KAOS_URING_WRITE 1u
+
+static int kaos_uring_setup(KaosUring* r, unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(r, 0, sizeof(*r));
+
+    r->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (r->fd < 0) {
+        return 0;
+    }
+    // Plain READ/WRITE and off = -1 on pipes arrived together in 5.6; on
+    // older rings the first completion would be -EINVAL, so fall back now
+    if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+        return 0;
+    }
+    r->entries = params.sq_entries;
+
+    r->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    r->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (r->cq_ring_size > r->sq_ring_size) r->sq_ring_size = r->cq_ring_size;
+        r->cq_ring_size = r->sq_ring_size;
+    }
+
+    r->sq_ring = mmap(NULL, r->sq_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    if (r->sq_ring == MAP_FAILED) {
+        r->sq_ring = NULL;
+        return 0;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        r->cq_ring = r->sq_ring;
+    } else {
+        r->cq_ring = mmap(NULL, r->cq_ring_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+        if (r->cq_ring == MAP_FAILED) {
+            r->cq_ring = NULL;
+            return 0;
+        }
+    }
+    r->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = (struct io_uring_sqe*)mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE,
+                                         MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) {
+        r->sqes = NULL;
+        return 0;
+    }
+
+    uint8_t* sq = (uint8_t*)r->sq_ring;
+    uint8_t* cq = (uint8_t*)r->cq_ring;
+    r->sq_tail = (_Atomic unsigned*)(sq + params.sq_off.tail);
+    r->sq_mask = *(unsigned*)(sq + params.sq_off.ring_mask);
+    r->sq_array = (unsigned*)(sq + params.sq_off.array);
+    r->cq_head = (_Atomic unsigned*)(cq + params.cq_off.head);
+    r->cq_tail = (_Atomic unsigned*)(cq + params.cq_off.tail);
+    r->cq_mask = *(unsigned*)(cq + params.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    return 1;
+}
+
+static void kaos_uring_teardown(KaosUring* r) {
+    if (r->sqes) munmap(r->sqes, r->sqes_size);
+    if (r->cq_ring && r->cq_ring != r->sq_ring) munmap(r->cq_ring, r->cq_ring_size);
+    if (r->sq_ring) munmap(r->sq_ring, r->sq_ring_size);
+    if (r->fd >= 0) close(r->fd);
+}
+
+/* Descriptors 0 (input) and 1 (output) and one buffer per slot; best effort */
+static void kaos_uring_register(KaosUring* r, KaosPipeline* p) {
+    int fds[2] = { p->in_fd, p->out_fd };
+    r->fixed_files = syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_FILES, fds, 2) == 0;
+
+    struct iovec iov[KAOS_PIPE_MAX_DEPTH];
+    for (int i = 0; i < p->depth; i++) {
+        iov[i].iov_base = p->slots[i].data;
+        iov[i].iov_len = p->chunk;
+    }
+    r->fixed_buffers = syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_BUFFERS,
+                               iov, p->depth) == 0;
+}
+
+/* Queue one read or write for slot; the tail is published at once */
+static void kaos_uring_queue(KaosUring* r, KaosPipeline* p, KaosSlot* s, int write) {
+    unsigned tail = atomic_load_explicit(r->sq_tail, memory_order_relaxed);
+    unsigned index = tail & r->sq_mask;
+    struct io_uring_sqe* sqe = &r->sqes[index];
+    unsigned slot = (unsigned)(s - p->slots);
+    int regular = write ? p->out_regular : p->in_regular;
+    size_t done = write ? s->written : s->filled;
+
+    memset(sqe, 0, sizeof(*sqe));
+    if (r->fixed_buffers) {
+        sqe->opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+        sqe->buf_index = (uint16_t)slot;
+    } else {
+        sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+    }
+    if (r->fixed_files) {
+        sqe->fd = write ? 1 : 0;
+        sqe->flags = IOSQE_FIXED_FILE;
+    } else {
+        sqe->fd = write ? p->out_fd : p->in_fd;
+    }
+    sqe->addr = (uint64_t)(uintptr_t)(s->data + done);
+    sqe->len = (uint32_t)((write ? s->filled : s->length) - done);
+    // Pipes: -1 = the descriptor's own position, in submission order
+    sqe->off = regular ? (write ? s->out_offset : s->in_offset) + done : (uint64_t)-1;
+    sqe->user_data = (uint64_t)slot << 1 | (write ? KAOS_URING_WRITE : 0);
+
+    r->sq_array[index] = index;
+    atomic_store_explicit(r->sq_tail, tail + 1, memory_order_release);
+    r->to_submit++;
+    r->inflight++;
+    s->state = write ? SLOT_WRITING : SLOT_READING;
+}
+
+/* Submit everything queued; wait for at least one completion if asked */
+static int kaos_uring_enter(KaosUring* r, int wait) {
+    unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+    for (;;) {
+        long ret = syscall(__NR_io_uring_enter, r->fd, r->to_submit, wait ? 1 : 0, flags, NULL, 0);
+        if (ret >= 0) {
+            r->to_submit -= (unsigned)ret < r->to_submit ? (unsigned)ret : r->to_submit;
+            if (r->to_submit == 0 || !wait) return 1;
+            continue;
+        }
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY) return 0;
+    }
+}
+
+/* Apply every completion; short transfers are reissued for the rest */
+static void kaos_uring_reap(KaosUring* r, KaosPipeline* p, int* read_busy, int* write_busy) {
+    unsigned head = atomic_load_explicit(r->cq_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(r->cq_tail, memory_order_acquire);
+
+    for (; head != tail; head++) {
+        struct io_uring_cqe* cqe = &r->cqes[head & r->cq_mask];
+        KaosSlot* s = &p->slots[cqe->user_data >> 1];
+        int write = (cqe->user_data & KAOS_URING_WRITE) != 0;
+        ssize_t res = cqe->res;
+        r->inflight--;
+
+        if (res == -EINTR || res == -EAGAIN) {
+            if (!p->failed) kaos_uring_queue(r, p, s, write);
+            continue;
+        }
+        int again = write ? kaos_pipe_write_done(p, s, res) : kaos_pipe_read_done(p, s, res);
+        if (again && !p->failed) {
+            kaos_uring_queue(r, p, s, write);
+        } else if (write) {
+            *write_busy = 0;
+        } else {
+            *read_busy = 0;
+        }
+    }
+    atomic_store_explicit(r->cq_head, head, memory_order_release);
+}
+
+static int kaos_pipe_run_uring(KaosPipeline* p) {
+    KaosUring r;
+    if (!kaos_uring_setup(&r, (unsigned)(2 * p->depth))) {
+        kaos_uring_teardown(&r);
+        return -1;  // Not available: the caller may fall back
+    }
+    kaos_uring_register(&r, p);
+    p->stats.backend = KAOS_IO_URING;
+    p->stats.fixed_files = r.fixed_files;
+    p->stats.registered_buffers = r.fixed_buffers;
+
+    uint64_t next_read = 0, next_encrypt = 0, next_write = 0;
+    int read_busy = 0, write_busy = 0;  // Pipes: one transfer in flight per side
+    while (!p->failed) {
+        // Reads for every free buffer ahead of the encryptor
+        while (next_read < p->last && kaos_pipe_slot(p, next_read)->state == SLOT_FREE &&
+               (p->in_regular || !read_busy)) {
+            KaosSlot* s = kaos_pipe_slot(p, next_read);
+            kaos_pipe_begin_read(p, s, next_read++);
+            kaos_uring_queue(&r, p, s, 0);
+            read_busy = 1;
+        }
+
+        // Writes in chunk order as chunks get encrypted
+        while (next_write < next_encrypt &&
+               kaos_pipe_slot(p, next_write)->state == SLOT_ENCRYPTED &&
+               (p->out_regular || !write_busy)) {
+            kaos_uring_queue(&r, p, kaos_pipe_slot(p, next_write++), 1);
+            write_busy = 1;
+        }
+
+        if (next_encrypt >= p->last && r.inflight == 0) {
+            break;
+        }
+
+        KaosSlot* s = kaos_pipe_slot(p, next_encrypt);
+        if (next_encrypt < p->last && s->state == SLOT_READY && s->index == next_encrypt) {
+            // The kernel works on the queued I/O while this thread encrypts
+            if (!kaos_uring_enter(&r, 0)) {
+                p->failed = 1;
+                break;
+            }
+            kaos_pipe_encrypted(p, s, kaos_stream_update(p->stream, s->data, s->data, s->filled));
+            next_encrypt++;
+        } else {
+            double start = kaos_pipe_now();
+            if (!kaos_uring_enter(&r, 1)) {
+                p->failed = 1;
+                break;
+            }
+            if (next_encrypt < p->last) {
+                p->stats.stalls++;
+                p->stats.stall_seconds += kaos_pipe_now() - start;
+            }
+        }
+        kaos_uring_reap(&r, p, &read_busy, &write_busy);
+    }
+
+    // Nothing may land in a buffer after it is released
+    while (r.inflight > 0 && kaos_uring_enter(&r, 1)) {
+        kaos_uring_reap(&r, p, &read_busy, &write_busy);
+    }
+    kaos_uring_teardown(&r);
+    return !p->failed;
+}
+#endif
+
+/*
+ * THREAD BACKEND - reader and writer threads around the encrypting one
+ */
+typedef struct {
+    KaosPipeline* p;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} KaosPipeThreads;
+
+/* pread/read until the chunk is full or the input ends */
+static ssize_t kaos_pipe_read_some(KaosPipeline* p, KaosSlot* s) {
+    for (;;) {
+        ssize_t res = p->in_regular ?
+                      pread(p->in_fd, s->data + s->filled, s->length - s->filled,
+                            (off_t)(s->in_offset + s->filled)) :
+                      read(p->in_fd, s->data + s->filled, s->length - s->filled);
+        if (res >= 0 || (errno != EINTR && errno != EAGAIN)) return res;
+    }
+}
+
+static ssize_t kaos_pipe_write_some(KaosPipeline* p, KaosSlot* s) {
+    for (;;) {
+        ssize_t res = p->out_regular ?
+                      pwrite(p->out_fd, s->data + s->written, s->filled - s->written,
+                             (off_t)(s->out_offset + s->written)) :
+                      write(p->out_fd, s->data + s->written, s->filled - s->written);
+        if (res >= 0 || (errno != EINTR && errno != EAGAIN)) return res;
+    }
+}
+
+static void* kaos_pipe_reader(void* arg) {
+    KaosPipeThreads* t = (KaosPipeThreads*)arg;
+    KaosPipeline* p = t->p;
+
+    for (uint64_t index = 0; ; index++) {
+        KaosSlot* s = kaos_pipe_slot(p, index);
+        pthread_mutex_lock(&t->lock);
+        while (!p->failed && index < p->last && s->state != SLOT_FREE) {
+            pthread_cond_wait(&t->changed, &t->lock);
+        }
+        if (p->failed || index >= p->last) {
+            pthread_mutex_unlock(&t->lock);
+            return NULL;
+        }
+        kaos_pipe_begin_read(p, s, index);
+        pthread_mutex_unlock(&t->lock);
+
+        // Outside the lock: only this thread touches a READING slot
+        ssize_t res = 1;
+        while (s->filled < s->length && res > 0) {
+            res = kaos_pipe_read_some(p, s);
+            if (res > 0) s->filled += (size_t)res;
+        }
+
+        pthread_mutex_lock(&t->lock);
+        if (res < 0) {
+            p->failed = 1;
+        } else if (res == 0) {
+            kaos_pipe_read_done(p, s, 0);  // Input ended before the chunk did
+        } else {
+            s->state = SLOT_READY;
+        }
+        pthread_cond_broadcast(&t->changed);
+        pthread_mutex_unlock(&t->lock);
+    }
+}
+
+static void* kaos_pipe_writer(void* arg) {
+    KaosPipeThreads* t = (KaosPipeThreads*)arg;
+    KaosPipeline* p = t->p;
+
+    for (uint64_t index = 0; ; index++) {
+        KaosSlot* s = kaos_pipe_slot(p, index);
+        pthread_mutex_lock(&t->lock);
+        while (!p->failed && index < p->last &&
+               !(s->state == SLOT_ENCRYPTED && s->index == index)) {
+            pthread_cond_wait(&t->changed, &t->lock);
+        }
+        if (p->failed || index >= p->last) {
+            pthread_mutex_unlock(&t->lock);
+            return NULL;
+        }
+        s->state = SLOT_WRITING;
+        pthread_mutex_unlock(&t->lock);
+
+        ssize_t res = 1;
+        while (s->written < s->filled && res > 0) {
+            res = kaos_pipe_write_some(p, s);
+            if (res > 0) s->written += (size_t)res;
+        }
+
+        pthread_mutex_lock(&t->lock);
+        if (res <= 0) {
+            p->failed = 1;
+        } else {
+            s->state = SLOT_FREE;
+        }
+        pthread_cond_broadcast(&t->changed);
+        pthread_mutex_unlock(&t->lock);
+    }
+}
+
+static int kaos_pipe_run_threads(KaosPipeline* p) {
+    KaosPipeThreads t;
+    t.p = p;
+    pthread_mutex_init(&t.lock, NULL);
+    pthread_cond_init(&t.changed, NULL);
+    p->stats.backend = KAOS_IO_THREADS;
+
+    pthread_t reader, writer;
+    int have_reader = pthread_create(&reader, NULL, kaos_pipe_reader, &t) == 0;
+    int have_writer = have_reader && pthread_create(&writer, NULL, kaos_pipe_writer, &t) == 0;
+    if (!have_writer) {
+        pthread_mutex_lock(&t.lock);
+        p->failed = 1;
+        pthread_cond_broadcast(&t.changed);
+        pthread_mutex_unlock(&t.lock);
+    }
+
+    for (uint64_t index = 0; have_writer; index++) {
+        KaosSlot* s = kaos_pipe_slot(p, index);
+        pthread_mutex_lock(&t.lock);
+        if (!p->failed && index < p->last &&
+            !(s->state == SLOT_READY && s->index == index)) {
+            double start = kaos_pipe_now();
+            while (!p->failed && index < p->last &&
+                   !(s->state == SLOT_READY && s->index == index)) {
+                pthread_cond_wait(&t.changed, &t.lock);
+            }
+            if (index < p->last) {
+                p->stats.stalls++;
+                p->stats.stall_seconds += kaos_pipe_now() - start;
+            }
+        }
+        if (p->failed || index >= p->last) {
+            pthread_mutex_unlock(&t.lock);
+            break;
+        }
+        pthread_mutex_unlock(&t.lock);
+
+        // READY slots belong to this thread until marked ENCRYPTED
+        int ok = kaos_stream_update(p->stream, s->data, s->data, s->filled);
+
+        pthread_mutex_lock(&t.lock);
+        kaos_pipe_encrypted(p, s, ok);
+        pthread_cond_broadcast(&t.changed);
+        pthread_mutex_unlock(&t.lock);
+    }
+
+    if (have_reader) pthread_join(reader, NULL);
+    if (have_writer) pthread_join(writer, NULL);
+    pthread_cond_destroy(&t.changed);
+    pthread_mutex_destroy(&t.lock);
+    return !p->failed;
+}
+
+/*
+ * PUBLIC ENTRY POINTS
+ */
+static int kaos_pipe_regular(int fd, uint64_t* position, struct stat* st) {
+    if (fstat(fd, st) != 0 || !S_ISREG(st->st_mode)) {
+        return 0;
+    }
+    off_t pos = lseek(fd, 0, SEEK_CUR);
+    if (pos < 0) {
+        return 0;
+    }
+    *position = (uint64_t)pos;
+    return 1;
+}
+
+int kaos_encrypt_fd(KaosCipher* cipher, int in_fd, int out_fd,
+                    const uint8_t* key_256bit, const uint8_t* nonce_96bit,
+                    const KaosPipelineOptions* options, KaosPipelineStats* stats) {
+    KaosPipelineOptions defaults;
+    memset(&defaults, 0, sizeof(defaults));
+    if (!options) options = &defaults;
+    if (stats) memset(stats, 0, sizeof(*stats));
+
+    if (!cipher || in_fd < 0 || out_fd < 0 || !key_256bit || !nonce_96bit ||
+        options->depth < 0 || options->depth > KAOS_PIPE_MAX_DEPTH ||
+        options->chunk_size > (1u << 30)) {
+        return 0;
+    }
+
+    KaosPipeline p;
+    memset(&p, 0, sizeof(p));
+    p.in_fd = in_fd;
+    p.out_fd = out_fd;
+    p.last = KAOS_PIPE_UNKNOWN;
+
+    struct stat st;
+    p.in_regular = kaos_pipe_regular(in_fd, &p.in_start, &st);
+    if (p.in_regular) {
+        p.in_length = (uint64_t)st.st_size > p.in_start ? (uint64_t)st.st_size - p.in_start : 0;
+    }
+    p.out_regular = kaos_pipe_regular(out_fd, &p.out_start, &st);
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    if (page == 0 || page == (size_t)-1) page = 4096;
+    p.chunk = options->chunk_size ? options->chunk_size : KAOS_PIPE_CHUNK;
+    p.chunk = (p.chunk + page - 1) / page * page;
+    p.depth = options->depth ? options->depth : KAOS_PIPE_DEPTH;
+    if (p.depth < KAOS_PIPE_MIN_DEPTH) p.depth = KAOS_PIPE_MIN_DEPTH;
+    if (p.in_regular) {
+        p.last = (p.in_length + p.chunk - 1) / p.chunk;
+    }
+
+    p.slots = (KaosSlot*)calloc((size_t)p.depth, sizeof(KaosSlot));
+    int ok = p.slots != NULL;
+    for (int i = 0; ok && i < p.depth; i++) {
+        p.slots[i].data = (uint8_t*)aligned_alloc(page, p.chunk);
+        ok = p.slots[i].data != NULL;
+    }
+    p.stream = ok ? kaos_stream_init(cipher, key_256bit, nonce_96bit) : NULL;
+
+    if (p.stream) {
+        int ran = -1;
+#ifdef KAOS_HAVE_URING
+        if (options->backend != KAOS_IO_THREADS) {
+            ran = kaos_pipe_run_uring(&p);
+        }
+#endif
+        if (ran < 0 && options->backend != KAOS_IO_URING) {
+            ran = kaos_pipe_run_threads(&p);
+        }
+        ok = ran > 0;
+    } else {
+        ok = 0;
+    }
+
+    // Like read/write: regular files are left after the data
+    if (ok && p.in_regular) lseek(in_fd, (off_t)(p.in_start + p.in_length), SEEK_SET);
+    if (ok && p.out_regular) lseek(out_fd, (off_t)(p.out_start + p.out_pos), SEEK_SET);
+
+    if (stats) *stats = p.stats;
+    kaos_stream_final(p.stream);
+    for (int i = 0; p.slots && i < p.depth; i++) {
+        if (p.slots[i].data) {
+            // Plaintext of the last chunks may still be here
+            memset(p.slots[i].data, 0, p.chunk);
+            free(p.slots[i].data);
+        }
+    }
+    free(p.slots);
+    return ok;
+}
+
+int kaos_decrypt_fd(KaosCipher* cipher, int in_fd, int out_fd,
+                    const uint8_t* key_256bit, const uint8_t* nonce_96bit,
+                    const KaosPipelineOptions* options, KaosPipelineStats* stats) {
+    return kaos_encrypt_fd(cipher, in_fd, out_fd, key_256bit, nonce_96bit, options, stats);
+}
+
+const char* kaos_io_backend_name(KaosIoBackend backend) {
+    switch (backend) {
+    case KAOS_IO_AUTO: return "auto";
+    case KAOS_IO_URING: return "io_uring";
+    case KAOS_IO_THREADS: return "threads";
+    }
+    return "unknown";
+}
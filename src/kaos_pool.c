@@ -0,0 +1,513 @@
+/**
+ * KAOS CIPHER - Stream Cipher Based on Lorenz Chaotic System
+ * Thread Pool - parallel loops and a work-stealing batch pool
+ * Author: Simón M. Guiñazú
+ * Github: https://github.com/sysphersec/kaos-cipher
+ *
+ * Message cost varies wildly (5000 warmup steps for 20 bytes versus a
+ * multi-MB payload). Each worker owns a deque: it pops its own tasks at
+ * the bottom and idle workers steal from the top. Long messages are cut
+ * into a warmup task plus keystream chunk tasks; while other work is
+ * queued each chunk puts its continuation at the top, so short messages
+ * are not stuck behind one long stream and the stream itself is the
+ * first thing a thief takes.
+ */
+
+/* pthread_setaffinity_np */
+#define _GNU_SOURCE
+
+#include "kaos_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+/* Upper bound on worker threads per parallel loop */
+#define KAOS_POOL_MAX_THREADS 256
+
+typedef struct {
+    KaosTaskFn fn;
+    void* ctx;
+    size_t count;
+    atomic_size_t next;     // Next unclaimed task index
+} KaosParallelLoop;
+
+/* Workers claim task indices one at a time until none are left */
+static void* kaos_parallel_worker(void* arg) {
+    KaosParallelLoop* loop = (KaosParallelLoop*)arg;
+
+    for (;;) {
+        size_t task = atomic_fetch_add(&loop->next, 1);
+        if (task >= loop->count) break;
+        loop->fn(loop->ctx, task);
+    }
+    return NULL;
+}
+
+int kaos_default_threads(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) return 1;
+    if (cpus > KAOS_POOL_MAX_THREADS) return KAOS_POOL_MAX_THREADS;
+    return (int)cpus;
+}
+
+/*
+ * PARALLEL LOOP - fn(ctx, i) for every i < count
+ * The calling thread works too, so the loop completes even if no
+ * worker thread can be created
+ */
+void kaos_parallel_for(size_t count, int threads, KaosTaskFn fn, void* ctx) {
+    KaosParallelLoop loop;
+    pthread_t workers[KAOS_POOL_MAX_THREADS];
+    int started = 0;
+
+    loop.fn = fn;
+    loop.ctx = ctx;
+    loop.count = count;
+    atomic_init(&loop.next, 0);
+
+    if (threads <= 0) threads = kaos_default_threads();
+    if (threads > KAOS_POOL_MAX_THREADS) threads = KAOS_POOL_MAX_THREADS;
+    if ((size_t)threads > count) threads = (int)count;
+
+    for (int t = 1; t < threads; t++) {
+        if (pthread_create(&workers[started], NULL, kaos_parallel_worker, &loop) == 0) {
+            started++;
+        }
+    }
+
+    kaos_parallel_worker(&loop);
+
+    for (int t = 0; t < started; t++) {
+        pthread_join(workers[t], NULL);
+    }
+}
+
+/* ===== WORK-STEALING POOL ===== */
+
+/* Keystream bytes per task (~13x the cost of the default warmup) */
+#define KAOS_POOL_CHUNK 65536
+
+/* Initial deque capacity (grows by doubling) */
+#define KAOS_DEQUE_INITIAL 64
+
+/* One message of a submitted batch */
+typedef struct {
+    KaosFuture* future;
+    size_t index;
+    KaosState state;       // Stream state between chunk tasks
+    uint64_t position;     // Next byte to encrypt
+    int warmed;            // Warmup done
+} KaosPoolTask;
+
+struct KaosFuture {
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+    size_t remaining;          // Messages not finished yet
+    KaosCipher cipher;         // Copy of the submitted parameters
+    KaosMessage* msgs;
+    KaosPoolTask* tasks;
+    KaosPoolCallback callback;
+    void* user;
+};
+
+/* Ring buffer deque - owner uses the bottom, thieves the top */
+typedef struct {
+    pthread_mutex_t lock;
+    KaosPoolTask** tasks;
+    size_t capacity;           // Power of two
+    size_t top, bottom;        // Live tasks are top .. bottom-1
+} KaosDeque;
+
+typedef struct {
+    KaosPool* pool;
+    int id;
+    int cpu;                   // Pinned CPU or -1
+    pthread_t thread;
+    KaosDeque deque;
+} KaosWorker;
+
+struct KaosPool {
+    pthread_mutex_t lock;      // Guards sleeping and stop
+    pthread_cond_t wake;
+    atomic_size_t queued;      // Tasks sitting in any deque
+    atomic_size_t submit_next; // Round-robin target for submissions
+    int stop;
+    int count;
+    KaosWorker* workers;
+};
+
+/*
+ * DEQUE OPERATIONS
+ */
+static int kaos_deque_init(KaosDeque* deque) {
+    deque->tasks = (KaosPoolTask**)malloc(KAOS_DEQUE_INITIAL * sizeof(KaosPoolTask*));
+    if (!deque->tasks) {
+        return 0;
+    }
+    if (pthread_mutex_init(&deque->lock, NULL) != 0) {
+        free(deque->tasks);
+        return 0;
+    }
+    deque->capacity = KAOS_DEQUE_INITIAL;
+    deque->top = deque->bottom = 0;
+    return 1;
+}
+
+static void kaos_deque_destroy(KaosDeque* deque) {
+    pthread_mutex_destroy(&deque->lock);
+    free(deque->tasks);
+}
+
+/* Caller holds deque->lock */
+static int kaos_deque_grow(KaosDeque* deque) {
+    size_t capacity = deque->capacity * 2;
+    KaosPoolTask** tasks = (KaosPoolTask**)malloc(capacity * sizeof(KaosPoolTask*));
+    if (!tasks) {
+        return 0;
+    }
+
+    size_t n = deque->bottom - deque->top;
+    for (size_t i = 0; i < n; i++) {
+        tasks[i] = deque->tasks[(deque->top + i) & (deque->capacity - 1)];
+    }
+
+    free(deque->tasks);
+    deque->tasks = tasks;
+    deque->capacity = capacity;
+    deque->top = 0;
+    deque->bottom = n;
+    return 1;
+}
+
+/* New tasks go to the bottom, continuations to the top (behind queued work) */
+static int kaos_deque_push(KaosDeque* deque, KaosPoolTask* task, int at_top) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom - deque->top == deque->capacity && !kaos_deque_grow(deque)) {
+        pthread_mutex_unlock(&deque->lock);
+        return 0;
+    }
+    if (at_top) {
+        deque->tasks[--deque->top & (deque->capacity - 1)] = task;
+    } else {
+        deque->tasks[deque->bottom++ & (deque->capacity - 1)] = task;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return 1;
+}
+
+/* Owner side: newest task first */
+static KaosPoolTask* kaos_deque_pop(KaosDeque* deque) {
+    KaosPoolTask* task = NULL;
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom != deque->top) {
+        task = deque->tasks[--deque->bottom & (deque->capacity - 1)];
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return task;
+}
+
+/* Thief side: oldest task first */
+static KaosPoolTask* kaos_deque_steal(KaosDeque* deque) {
+    KaosPoolTask* task = NULL;
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom != deque->top) {
+        task = deque->tasks[deque->top++ & (deque->capacity - 1)];
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return task;
+}
+
+/*
+ * SCHEDULING
+ */
+/* Returns 0 if the deque could not grow (caller runs the task itself) */
+static int kaos_pool_enqueue(KaosPool* pool, KaosWorker* worker, KaosPoolTask* task,
+                             int at_top) {
+    // Counted before it is visible, so a thief's decrement cannot wrap queued
+    atomic_fetch_add(&pool->queued, 1);
+    if (!kaos_deque_push(&worker->deque, task, at_top)) {
+        atomic_fetch_sub(&pool->queued, 1);
+        return 0;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    return 1;
+}
+
+static KaosPoolTask* kaos_pool_take(KaosPool* pool, KaosWorker* self) {
+    KaosPoolTask* task = kaos_deque_pop(&self->deque);
+
+    for (int i = 1; !task && i < pool->count; i++) {
+        task = kaos_deque_steal(&pool->workers[(self->id + i) % pool->count].deque);
+    }
+    if (task) {
+        atomic_fetch_sub(&pool->queued, 1);
+    }
+    return task;
+}
+
+static void kaos_future_complete(KaosFuture* future, size_t index) {
+    if (future->callback) {
+        future->callback(future->user, index);
+    }
+
+    pthread_mutex_lock(&future->lock);
+    if (--future->remaining == 0) {
+        pthread_cond_broadcast(&future->finished);
+    }
+    pthread_mutex_unlock(&future->lock);
+}
+
+/* Runs one step of a message; returns 1 if a continuation is needed */
+static int kaos_pool_step(KaosPoolTask* task) {
+    KaosFuture* future = task->future;
+    KaosMessage* m = &future->msgs[task->index];
+
+    if (!task->warmed) {
+        kaos_warm_state(&future->cipher, m->key, m->nonce, &task->state);
+        task->warmed = 1;
+
+        // Long message: warmup is its own task
+        if (m->length > KAOS_POOL_CHUNK) {
+            return 1;
+        }
+    }
+
+    size_t n = (size_t)(m->length - task->position);
+    if (n > KAOS_POOL_CHUNK) n = KAOS_POOL_CHUNK;
+
+    kaos_xor_keystream(&future->cipher, &task->state, task->position,
+                       m->in + task->position, m->out + task->position, n);
+    task->position += n;
+
+    return task->position < m->length;
+}
+
+static void kaos_pool_finish(KaosPoolTask* task) {
+    kaos_wipe(&task->state, sizeof(KaosState));
+    kaos_future_complete(task->future, task->index);
+}
+
+static void* kaos_pool_worker(void* arg) {
+    KaosWorker* self = (KaosWorker*)arg;
+    KaosPool* pool = self->pool;
+
+#ifdef __linux__
+    if (self->cpu >= 0 && self->cpu < CPU_SETSIZE) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(self->cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+#endif
+
+    for (;;) {
+        KaosPoolTask* task = kaos_pool_take(pool, self);
+
+        if (task) {
+            // While other work is waiting the continuation goes behind it
+            // (thieves take it first); otherwise keep going inline
+            int requeued = 0;
+            while (kaos_pool_step(task)) {
+                if (atomic_load(&pool->queued) > 0 && kaos_pool_enqueue(pool, self, task, 1)) {
+                    requeued = 1;
+                    break;
+                }
+            }
+            if (!requeued) {
+                kaos_pool_finish(task);
+            }
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        while (atomic_load(&pool->queued) == 0 && !pool->stop) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        int done = pool->stop && atomic_load(&pool->queued) == 0;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (done) break;
+    }
+    return NULL;
+}
+
+/*
+ * POOL LIFETIME
+ */
+/* Stops and joins the first `started` workers, then releases everything */
+static void kaos_pool_shutdown(KaosPool* pool, int deques, int started) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int w = 0; w < started; w++) {
+        pthread_join(pool->workers[w].thread, NULL);
+    }
+    for (int w = 0; w < deques; w++) {
+        kaos_deque_destroy(&pool->workers[w].deque);
+    }
+
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->workers);
+    free(pool);
+}
+
+KaosPool* kaos_pool_new(int workers, const int* cpus) {
+    // cpus has exactly workers entries; with workers <= 0 its length is unknown
+    if (workers <= 0 && cpus) return NULL;
+    if (workers <= 0) workers = kaos_default_threads();
+    if (workers > KAOS_POOL_MAX_THREADS) return NULL;
+
+    KaosPool* pool = (KaosPool*)calloc(1, sizeof(KaosPool));
+    if (!pool) {
+        return NULL;
+    }
+    pool->workers = (KaosWorker*)calloc((size_t)workers, sizeof(KaosWorker));
+    if (!pool->workers || pthread_mutex_init(&pool->lock, NULL) != 0) {
+        free(pool->workers);
+        free(pool);
+        return NULL;
+    }
+    pthread_cond_init(&pool->wake, NULL);
+    atomic_init(&pool->queued, 0);
+    atomic_init(&pool->submit_next, 0);
+
+    // Every deque exists before any worker can try to steal from it
+    for (int w = 0; w < workers; w++) {
+        KaosWorker* worker = &pool->workers[w];
+        worker->pool = pool;
+        worker->id = w;
+        worker->cpu = cpus ? cpus[w] : -1;
+
+        if (!kaos_deque_init(&worker->deque)) {
+            kaos_pool_shutdown(pool, w, 0);
+            return NULL;
+        }
+    }
+    pool->count = workers;
+
+    for (int w = 0; w < workers; w++) {
+        if (pthread_create(&pool->workers[w].thread, NULL, kaos_pool_worker,
+                           &pool->workers[w]) != 0) {
+            kaos_pool_shutdown(pool, workers, w);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+void kaos_pool_free(KaosPool* pool) {
+    if (!pool) {
+        return;
+    }
+
+    // Workers drain every queued task before they see stop
+    kaos_pool_shutdown(pool, pool->count, pool->count);
+}
+
+int kaos_pool_workers(const KaosPool* pool) {
+    return pool ? pool->count : 0;
+}
+
+/*
+ * BATCH SUBMISSION - one task per message, spread round-robin
+ */
+KaosFuture* kaos_pool_submit_batch(KaosPool* pool, KaosCipher* cipher,
+                                   KaosMessage* msgs, size_t count,
+                                   KaosPoolCallback callback, void* user) {
+    if (!pool || !cipher || (count > 0 && !msgs)) {
+        return NULL;
+    }
+
+    // Validate every message before submitting any
+    for (size_t i = 0; i < count; i++) {
+        if (msgs[i].length > 0 &&
+            (!msgs[i].in || !msgs[i].out || !msgs[i].key || !msgs[i].nonce)) {
+            return NULL;
+        }
+    }
+
+    KaosFuture* future = (KaosFuture*)calloc(1, sizeof(KaosFuture));
+    if (!future) {
+        return NULL;
+    }
+    future->tasks = (KaosPoolTask*)calloc(count ? count : 1, sizeof(KaosPoolTask));
+    if (!future->tasks || pthread_mutex_init(&future->lock, NULL) != 0) {
+        free(future->tasks);
+        free(future);
+        return NULL;
+    }
+    pthread_cond_init(&future->finished, NULL);
+
+    future->remaining = count;
+    future->cipher = *cipher;
+    future->msgs = msgs;
+    future->callback = callback;
+    future->user = user;
+
+    for (size_t i = 0; i < count; i++) {
+        KaosPoolTask* task = &future->tasks[i];
+        task->future = future;
+        task->index = i;
+
+        // Empty messages complete immediately
+        if (msgs[i].length == 0) {
+            kaos_future_complete(future, i);
+            continue;
+        }
+
+        size_t w = atomic_fetch_add(&pool->submit_next, 1) % (size_t)pool->count;
+        if (!kaos_pool_enqueue(pool, &pool->workers[w], task, 0)) {
+            while (kaos_pool_step(task)) {}
+            kaos_pool_finish(task);
+        }
+    }
+
+    return future;
+}
+
+int kaos_future_done(KaosFuture* future) {
+    if (!future) {
+        return 1;
+    }
+
+    pthread_mutex_lock(&future->lock);
+    int done = future->remaining == 0;
+    pthread_mutex_unlock(&future->lock);
+    return done;
+}
+
+void kaos_future_wait(KaosFuture* future) {
+    if (!future) {
+        return;
+    }
+
+    pthread_mutex_lock(&future->lock);
+    while (future->remaining > 0) {
+        pthread_cond_wait(&future->finished, &future->lock);
+    }
+    pthread_mutex_unlock(&future->lock);
+}
+
+void kaos_future_free(KaosFuture* future) {
+    if (!future) {
+        return;
+    }
+
+    kaos_future_wait(future);
+    pthread_cond_destroy(&future->finished);
+    pthread_mutex_destroy(&future->lock);
+    free(future->tasks);
+    free(future);
+}
@@ -0,0 +1,280 @@
+/**
+ * KAOS CIPHER - Stream Cipher Based on Lorenz Chaotic System
+ * Keystream Prefetcher - generation ahead of the consumer
+ * Author: Simón M. Guiñazú
+ * Github: https://github.com/sysphersec/kaos-cipher
+ *
+ * A producer thread owns the Lorenz state of one (key, nonce) stream and
+ * keeps a single-producer/single-consumer ring of keystream bytes full.
+ * The consumer only XORs bytes that already exist. Both sides are
+ * lock-free: each publishes a monotonic byte count (written / read) on
+ * its own cache line and keeps a private copy of the other side's count,
+ * so the shared lines are only touched when the cached view runs out.
+ */
+
+#include "kaos_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+
+/* Smallest ring and the most bytes generated per publish */
+#define KAOS_PREFETCH_MIN_RING 4096
+#define KAOS_PREFETCH_CHUNK 4096
+
+/* Polls before yielding (spin) or sleeping (block) */
+#define KAOS_PREFETCH_SPINS 256
+
+/* Keeps the two sides' counters on separate cache lines */
+#define KAOS_CACHE_LINE 64
+
+struct KaosPrefetcher {
+    KaosCipher cipher;
+    KaosWaitPolicy policy;
+    size_t size;               // Ring bytes (power of two)
+    uint8_t* ring;             // Cache-line aligned
+    pthread_t thread;
+
+    /* Producer line */
+    atomic_uint_fast64_t written;
+    uint64_t producer_read;    // Producer's cached copy of read
+    KaosState state;           // Lorenz state after `written` bytes
+    char pad_producer[KAOS_CACHE_LINE];
+
+    /* Consumer line */
+    atomic_uint_fast64_t read;
+    uint64_t consumer_written; // Consumer's cached copy of written
+    char pad_consumer[KAOS_CACHE_LINE];
+
+    /* Blocking policy only */
+    pthread_mutex_t lock;
+    pthread_cond_t data;       // Consumer waits for keystream
+    pthread_cond_t space;      // Producer waits for free ring space
+    atomic_int consumer_sleeping;
+    atomic_int producer_sleeping;
+    atomic_int stop;
+};
+
+static inline void kaos_cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/* Free space at which a sleeping producer is woken */
+static inline size_t kaos_prefetch_low_water(const KaosPrefetcher* p) {
+    return p->size / 4;
+}
+
+/*
+ * PRODUCER THREAD
+ */
+/* Waits until at least `need` ring bytes are free; returns 0 on stop */
+static int kaos_prefetch_wait_space(KaosPrefetcher* p, uint64_t written, size_t need) {
+    for (int spins = 0; ; spins++) {
+        p->producer_read = atomic_load_explicit(&p->read, memory_order_acquire);
+        if (p->size - (size_t)(written - p->producer_read) >= need) return 1;
+        if (atomic_load_explicit(&p->stop, memory_order_relaxed)) return 0;
+
+        if (spins < KAOS_PREFETCH_SPINS) {
+            kaos_cpu_relax();
+        } else if (p->policy == KAOS_WAIT_SPIN) {
+            sched_yield();
+        } else {
+            pthread_mutex_lock(&p->lock);
+            atomic_store(&p->producer_sleeping, 1);
+            while (!atomic_load(&p->stop) &&
+                   p->size - (size_t)(written - atomic_load(&p->read)) < need) {
+                pthread_cond_wait(&p->space, &p->lock);
+            }
+            atomic_store(&p->producer_sleeping, 0);
+            pthread_mutex_unlock(&p->lock);
+            spins = 0;
+        }
+    }
+}
+
+static void* kaos_prefetch_producer(void* arg) {
+    KaosPrefetcher* p = (KaosPrefetcher*)arg;
+    uint64_t written = 0;
+
+    // Warmup runs here, not in kaos_prefetcher_new
+    kaos_warmup(&p->cipher, &p->state);
+
+    for (;;) {
+        // The cached read count is refreshed only once the cached view is full,
+        // then not before a quarter of the ring is free again
+        size_t free_bytes = p->size - (size_t)(written - p->producer_read);
+        if (free_bytes == 0) {
+            if (!kaos_prefetch_wait_space(p, written, kaos_prefetch_low_water(p))) break;
+            continue;
+        }
+
+        // One contiguous run, at most one chunk per publish
+        size_t offset = (size_t)written & (p->size - 1);
+        size_t n = p->size - offset;
+        if (n > free_bytes) n = free_bytes;
+        if (n > KAOS_PREFETCH_CHUNK) n = KAOS_PREFETCH_CHUNK;
+
+        kaos_keystream_block(&p->cipher, &p->state, written, p->ring + offset, n);
+        written += n;
+        atomic_store(&p->written, written);
+
+        if (atomic_load(&p->consumer_sleeping)) {
+            pthread_mutex_lock(&p->lock);
+            pthread_cond_signal(&p->data);
+            pthread_mutex_unlock(&p->lock);
+        }
+        if (atomic_load_explicit(&p->stop, memory_order_relaxed)) break;
+    }
+    return NULL;
+}
+
+/*
+ * PREFETCHER LIFETIME
+ */
+KaosPrefetcher* kaos_prefetcher_new(KaosCipher* cipher, const uint8_t* key_256bit,
+                                    const uint8_t* nonce_96bit, size_t ring_size,
+                                    KaosWaitPolicy policy) {
+    if (!cipher || !key_256bit || !nonce_96bit || ring_size > (SIZE_MAX >> 1) ||
+        (policy != KAOS_WAIT_SPIN && policy != KAOS_WAIT_BLOCK)) {
+        return NULL;
+    }
+
+    size_t size = KAOS_PREFETCH_MIN_RING;
+    while (size < ring_size) size *= 2;
+
+    KaosPrefetcher* p = (KaosPrefetcher*)calloc(1, sizeof(KaosPrefetcher));
+    if (!p) {
+        return NULL;
+    }
+    p->ring = (uint8_t*)aligned_alloc(KAOS_CACHE_LINE, size);
+    if (!p->ring || pthread_mutex_init(&p->lock, NULL) != 0) {
+        free(p->ring);
+        free(p);
+        return NULL;
+    }
+    pthread_cond_init(&p->data, NULL);
+    pthread_cond_init(&p->space, NULL);
+
+    p->cipher = *cipher;
+    p->policy = policy;
+    p->size = size;
+    kaos_key_to_state(key_256bit, nonce_96bit, &p->state.x, &p->state.y, &p->state.z);
+    atomic_init(&p->written, 0);
+    atomic_init(&p->read, 0);
+    atomic_init(&p->consumer_sleeping, 0);
+    atomic_init(&p->producer_sleeping, 0);
+    atomic_init(&p->stop, 0);
+
+    if (pthread_create(&p->thread, NULL, kaos_prefetch_producer, p) != 0) {
+        pthread_cond_destroy(&p->space);
+        pthread_cond_destroy(&p->data);
+        pthread_mutex_destroy(&p->lock);
+        kaos_wipe(&p->state, sizeof(KaosState));
+        free(p->ring);
+        free(p);
+        return NULL;
+    }
+
+    return p;
+}
+
+void kaos_prefetcher_free(KaosPrefetcher* prefetcher) {
+    if (!prefetcher) {
+        return;
+    }
+
+    KaosPrefetcher* p = prefetcher;
+    pthread_mutex_lock(&p->lock);
+    atomic_store(&p->stop, 1);
+    pthread_cond_broadcast(&p->space);
+    pthread_mutex_unlock(&p->lock);
+    pthread_join(p->thread, NULL);
+
+    // Unread keystream and the state are key-equivalent
+    kaos_wipe(p->ring, p->size);
+    free(p->ring);
+    pthread_cond_destroy(&p->space);
+    pthread_cond_destroy(&p->data);
+    pthread_mutex_destroy(&p->lock);
+    kaos_wipe(p, sizeof(KaosPrefetcher));
+    free(p);
+}
+
+/*
+ * CONSUMER - XOR with keystream the producer already generated
+ */
+/* Waits until keystream past `read` exists; returns the bytes available */
+static size_t kaos_prefetch_wait_data(KaosPrefetcher* p, uint64_t read) {
+    for (int spins = 0; ; spins++) {
+        p->consumer_written = atomic_load_explicit(&p->written, memory_order_acquire);
+        if (p->consumer_written != read) return (size_t)(p->consumer_written - read);
+
+        if (spins < KAOS_PREFETCH_SPINS) {
+            kaos_cpu_relax();
+        } else if (p->policy == KAOS_WAIT_SPIN) {
+            sched_yield();
+        } else {
+            pthread_mutex_lock(&p->lock);
+            atomic_store(&p->consumer_sleeping, 1);
+            while (atomic_load(&p->written) == read) {
+                pthread_cond_wait(&p->data, &p->lock);
+            }
+            atomic_store(&p->consumer_sleeping, 0);
+            pthread_mutex_unlock(&p->lock);
+            spins = 0;
+        }
+    }
+}
+
+int kaos_prefetcher_xor(KaosPrefetcher* prefetcher, const uint8_t* in, uint8_t* out,
+                        size_t length) {
+    if (!prefetcher || (length > 0 && (!in || !out))) {
+        return 0;
+    }
+
+    KaosPrefetcher* p = prefetcher;
+    uint64_t read = atomic_load_explicit(&p->read, memory_order_relaxed);
+
+    while (length > 0) {
+        size_t available = (size_t)(p->consumer_written - read);
+        if (available == 0) {
+            available = kaos_prefetch_wait_data(p, read);
+        }
+
+        size_t offset = (size_t)read & (p->size - 1);
+        size_t n = p->size - offset;
+        if (n > available) n = available;
+        if (n > length) n = length;
+
+        kaos_xor_bytes(in, p->ring + offset, out, n);
+
+        in += n;
+        out += n;
+        length -= n;
+        read += n;
+        atomic_store(&p->read, read);
+
+        if (atomic_load(&p->producer_sleeping) &&
+            p->size - (size_t)(p->consumer_written - read) >= kaos_prefetch_low_water(p)) {
+            pthread_mutex_lock(&p->lock);
+            pthread_cond_signal(&p->space);
+            pthread_mutex_unlock(&p->lock);
+        }
+    }
+
+    return 1;
+}
+
+uint64_t kaos_prefetcher_position(KaosPrefetcher* prefetcher) {
+    return prefetcher ? atomic_load(&prefetcher->read) : 0;
+}
+
+size_t kaos_prefetcher_buffered(KaosPrefetcher* prefetcher) {
+    if (!prefetcher) {
+        return 0;
+    }
+    return (size_t)(atomic_load(&prefetcher->written) - atomic_load(&prefetcher->read));
+}
@@ -0,0 +1,330 @@
+/**
+ * KAOS CIPHER - Stream Cipher Based on Lorenz Chaotic System
+ * Warmup Pre-staging - warmed states ready before the message exists
+ * Author: Simón M. Guiñazú
+ * Github: https://github.com/sysphersec/kaos-cipher
+ *
+ * For short messages the 5000 warmup steps are nearly the whole latency.
+ * When nonces come from a counter they are known ahead of time: the
+ * application reserves them, warmup threads turn each reservation into a
+ * warmed state, and kaos_encrypt_prestaged only pays for the keystream.
+ *
+ * The queue is a ring of slots with three monotonic indices:
+ *   head  <= claim <= tail
+ *   head  next slot to consume (encrypting thread)
+ *   claim next slot to warm (warmup threads, compare-and-swap)
+ *   tail  next slot to reserve (reserving thread)
+ * A slot is only reused once head has passed it, and head only passes a
+ * claimed slot after its warmup has finished.
+ */
+
+#include "kaos_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+
+/* Upper bound on warmup threads per pre-stager */
+#define KAOS_PRESTAGE_MAX_THREADS 64
+
+/* Keeps the hot indices on separate cache lines */
+#define KAOS_CACHE_LINE 64
+
+enum {
+    KAOS_SLOT_RESERVED = 0,    // Nonce stored, warmup pending or running
+    KAOS_SLOT_READY = 1        // Warmed state stored
+};
+
+typedef struct {
+    atomic_int status;
+    uint8_t nonce[KAOS_NONCE_SIZE];
+    KaosState state;
+} KaosStageSlot;
+
+struct KaosPrestager {
+    KaosCipher cipher;
+    KaosPreparedKey key;
+    size_t capacity;           // Maximum outstanding reservations
+    size_t mask;               // Slot count - 1 (power of two)
+    KaosStageSlot* slots;
+
+    atomic_size_t tail;
+    char pad_tail[KAOS_CACHE_LINE - sizeof(atomic_size_t)];
+    atomic_size_t claim;
+    char pad_claim[KAOS_CACHE_LINE - sizeof(atomic_size_t)];
+    atomic_size_t head;
+    char pad_head[KAOS_CACHE_LINE - sizeof(atomic_size_t)];
+
+    atomic_size_t ready;       // Slots in KAOS_SLOT_READY
+    _Atomic uint64_t hits;
+    _Atomic uint64_t waits;
+    _Atomic uint64_t starved;
+    _Atomic uint64_t unreserved;
+    _Atomic uint64_t discarded;
+
+    pthread_mutex_t lock;      // Sleeping warmup threads only
+    pthread_cond_t wake;
+    atomic_int sleepers;
+    atomic_int stop;
+    int count;
+    pthread_t threads[KAOS_PRESTAGE_MAX_THREADS];
+};
+
+/*
+ * WARMUP THREADS - claim the oldest unstarted reservation
+ */
+static void* kaos_prestage_worker(void* arg) {
+    KaosPrestager* p = (KaosPrestager*)arg;
+
+    for (;;) {
+        size_t c = atomic_load(&p->claim);
+
+        if (c != atomic_load(&p->tail)) {
+            if (!atomic_compare_exchange_weak(&p->claim, &c, c + 1)) continue;
+
+            KaosStageSlot* slot = &p->slots[c & p->mask];
+            KaosState state;
+            kaos_key_to_state_prepared(&p->key, slot->nonce, &state.x, &state.y, &state.z);
+            kaos_warmup(&p->cipher, &state);
+            slot->state = state;
+            kaos_wipe(&state, sizeof(state));
+
+            atomic_fetch_add(&p->ready, 1);
+            atomic_store_explicit(&slot->status, KAOS_SLOT_READY, memory_order_release);
+            continue;
+        }
+
+        // Nothing to claim: sleep until a reservation (or stop) arrives
+        pthread_mutex_lock(&p->lock);
+        atomic_fetch_add(&p->sleepers, 1);
+        while (!atomic_load(&p->stop) && atomic_load(&p->claim) == atomic_load(&p->tail)) {
+            pthread_cond_wait(&p->wake, &p->lock);
+        }
+        atomic_fetch_sub(&p->sleepers, 1);
+        int stop = atomic_load(&p->stop);
+        pthread_mutex_unlock(&p->lock);
+
+        if (stop) break;
+    }
+    return NULL;
+}
+
+/*
+ * PRE-STAGER LIFETIME
+ */
+/* Stops and joins the first `started` threads, then releases everything */
+static void kaos_prestage_shutdown(KaosPrestager* p, int started) {
+    pthread_mutex_lock(&p->lock);
+    atomic_store(&p->stop, 1);
+    pthread_cond_broadcast(&p->wake);
+    pthread_mutex_unlock(&p->lock);
+
+    for (int t = 0; t < started; t++) {
+        pthread_join(p->threads[t], NULL);
+    }
+
+    // Staged states and the prepared key are key-equivalent
+    kaos_wipe(p->slots, (p->mask + 1) * sizeof(KaosStageSlot));
+    free(p->slots);
+    pthread_cond_destroy(&p->wake);
+    pthread_mutex_destroy(&p->lock);
+    kaos_wipe(p, sizeof(KaosPrestager));
+    free(p);
+}
+
+KaosPrestager* kaos_prestager_new(KaosCipher* cipher, const uint8_t* key_256bit,
+                                  size_t capacity, int threads) {
+    if (!cipher || !key_256bit || capacity == 0 || capacity > SIZE_MAX / 2 / sizeof(KaosStageSlot) ||
+        threads > KAOS_PRESTAGE_MAX_THREADS) {
+        return NULL;
+    }
+    if (threads <= 0) threads = 1;
+
+    size_t slots = 1;
+    while (slots < capacity) slots *= 2;
+
+    KaosPrestager* p = (KaosPrestager*)calloc(1, sizeof(KaosPrestager));
+    if (!p) {
+        return NULL;
+    }
+    p->slots = (KaosStageSlot*)calloc(slots, sizeof(KaosStageSlot));
+    if (!p->slots || pthread_mutex_init(&p->lock, NULL) != 0) {
+        free(p->slots);
+        free(p);
+        return NULL;
+    }
+    pthread_cond_init(&p->wake, NULL);
+
+    p->cipher = *cipher;
+    kaos_prepare_key(&p->key, key_256bit);
+    p->capacity = capacity;
+    p->mask = slots - 1;
+    atomic_init(&p->tail, 0);
+    atomic_init(&p->claim, 0);
+    atomic_init(&p->head, 0);
+    atomic_init(&p->ready, 0);
+    atomic_init(&p->hits, 0);
+    atomic_init(&p->waits, 0);
+    atomic_init(&p->starved, 0);
+    atomic_init(&p->unreserved, 0);
+    atomic_init(&p->discarded, 0);
+    atomic_init(&p->sleepers, 0);
+    atomic_init(&p->stop, 0);
+
+    for (int t = 0; t < threads; t++) {
+        if (pthread_create(&p->threads[t], NULL, kaos_prestage_worker, p) != 0) {
+            kaos_prestage_shutdown(p, t);
+            return NULL;
+        }
+    }
+    p->count = threads;
+
+    return p;
+}
+
+void kaos_prestager_free(KaosPrestager* prestager) {
+    if (!prestager) {
+        return;
+    }
+
+    kaos_prestage_shutdown(prestager, prestager->count);
+}
+
+/*
+ * RESERVATION - single reserving thread, lock-free
+ */
+int kaos_prestager_reserve(KaosPrestager* prestager, const uint8_t* nonce_96bit) {
+    if (!prestager || !nonce_96bit) {
+        return 0;
+    }
+
+    KaosPrestager* p = prestager;
+    size_t t = atomic_load_explicit(&p->tail, memory_order_relaxed);
+    if (t - atomic_load(&p->head) >= p->capacity) {
+        return 0;
+    }
+
+    KaosStageSlot* slot = &p->slots[t & p->mask];
+    memcpy(slot->nonce, nonce_96bit, KAOS_NONCE_SIZE);
+    atomic_store_explicit(&slot->status, KAOS_SLOT_RESERVED, memory_order_relaxed);
+    atomic_store(&p->tail, t + 1);
+
+    // Sleepers re-check tail under the lock, so no wakeup is lost
+    if (atomic_load(&p->sleepers) > 0) {
+        pthread_mutex_lock(&p->lock);
+        pthread_cond_signal(&p->wake);
+        pthread_mutex_unlock(&p->lock);
+    }
+    return 1;
+}
+
+/*
+ * CONSUMPTION
+ */
+enum {
+    KAOS_SETTLE_UNCLAIMED,     // Taken from the warmup threads: caller warms
+    KAOS_SETTLE_READY,         // State was already warmed
+    KAOS_SETTLE_WAITED         // Waited for a running warmup
+};
+
+/* Makes slot i safe to read or reuse; every slot before i is settled */
+static int kaos_prestage_settle(KaosPrestager* p, size_t i) {
+    KaosStageSlot* slot = &p->slots[i & p->mask];
+    size_t c = i;
+
+    // claim >= i here; claim == i means no thread has started on it
+    if (atomic_compare_exchange_strong(&p->claim, &c, i + 1)) {
+        return KAOS_SETTLE_UNCLAIMED;
+    }
+
+    if (atomic_load_explicit(&slot->status, memory_order_acquire) == KAOS_SLOT_READY) {
+        return KAOS_SETTLE_READY;
+    }
+    while (atomic_load_explicit(&slot->status, memory_order_acquire) != KAOS_SLOT_READY) {
+        sched_yield();
+    }
+    return KAOS_SETTLE_WAITED;
+}
+
+int kaos_encrypt_prestaged(KaosPrestager* prestager, const uint8_t* in,
+                           uint8_t* out, size_t length, const uint8_t* nonce_96bit) {
+
+    // Validate inputs
+    if (!prestager || !in || !out || !nonce_96bit || length <= 0) {
+        return 0;
+    }
+
+    KaosPrestager* p = prestager;
+    KaosState state;
+    size_t head = atomic_load_explicit(&p->head, memory_order_relaxed);
+    size_t tail = atomic_load(&p->tail);
+
+    // Oldest reservation for this nonce (normally the head itself)
+    size_t match = head;
+    while (match != tail && memcmp(p->slots[match & p->mask].nonce, nonce_96bit,
+                                   KAOS_NONCE_SIZE) != 0) {
+        match++;
+    }
+
+    if (match == tail) {
+        atomic_fetch_add_explicit(&p->unreserved, 1, memory_order_relaxed);
+        kaos_key_to_state_prepared(&p->key, nonce_96bit, &state.x, &state.y, &state.z);
+        kaos_warmup(&p->cipher, &state);
+    } else {
+        // Reservations before the match will never be used
+        for (size_t i = head; i <= match; i++) {
+            KaosStageSlot* slot = &p->slots[i & p->mask];
+            int settled = kaos_prestage_settle(p, i);
+
+            if (settled != KAOS_SETTLE_UNCLAIMED) {
+                atomic_fetch_sub(&p->ready, 1);
+            }
+
+            if (i < match) {
+                atomic_fetch_add_explicit(&p->discarded, 1, memory_order_relaxed);
+            } else if (settled == KAOS_SETTLE_UNCLAIMED) {
+                atomic_fetch_add_explicit(&p->starved, 1, memory_order_relaxed);
+                kaos_key_to_state_prepared(&p->key, nonce_96bit, &state.x, &state.y, &state.z);
+                kaos_warmup(&p->cipher, &state);
+            } else {
+                atomic_fetch_add_explicit(settled == KAOS_SETTLE_READY ? &p->hits : &p->waits,
+                                          1, memory_order_relaxed);
+                state = slot->state;
+            }
+
+            kaos_wipe(&slot->state, sizeof(KaosState));
+        }
+        atomic_store(&p->head, match + 1);
+    }
+
+    kaos_xor_keystream(&p->cipher, &state, 0, in, out, length);
+    kaos_wipe(&state, sizeof(state));
+
+    return 1;
+}
+
+int kaos_decrypt_prestaged(KaosPrestager* prestager, const uint8_t* in,
+                           uint8_t* out, size_t length, const uint8_t* nonce_96bit) {
+    // XOR symmetry - identical operation
+    return kaos_encrypt_prestaged(prestager, in, out, length, nonce_96bit);
+}
+
+void kaos_prestager_stats(KaosPrestager* prestager, KaosPrestageStats* stats) {
+    if (!prestager || !stats) {
+        return;
+    }
+
+    KaosPrestager* p = prestager;
+    size_t head = atomic_load(&p->head);
+    size_t tail = atomic_load(&p->tail);
+
+    stats->depth = atomic_load(&p->ready);
+    stats->reserved = tail - head;
+    stats->capacity = p->capacity;
+    stats->hits = atomic_load_explicit(&p->hits, memory_order_relaxed);
+    stats->waits = atomic_load_explicit(&p->waits, memory_order_relaxed);
+    stats->starved = atomic_load_explicit(&p->starved, memory_order_relaxed);
+    stats->unreserved = atomic_load_explicit(&p->unreserved, memory_order_relaxed);
+    stats->discarded = atomic_load_explicit(&p->discarded, memory_order_relaxed);
+}
@@ -0,0 +1,159 @@
+/**
+ * KAOS CIPHER - Stream Cipher Based on Lorenz Chaotic System
+ * KAOS-P - Segmented Parallel Mode
+ * Author: Simón M. Guiñazú
+ * Github: https://github.com/sysphersec/kaos-cipher
+ *
+ * A single (key, nonce) stream is serial: byte N needs N Lorenz steps.
+ * KAOS-P splits the message into fixed-size segments, each an ordinary
+ * KAOS stream under (key, segment nonce), so segments warm up and
+ * encrypt independently on every core.
+ *
+ * Container (little-endian):
+ *   0  "KAOS"         4 bytes magic
+ *   4  version        1 byte (KAOS_P_VERSION)
+ *   5  mode           1 byte (KAOS_P_MODE_SEGMENTED)
+ *   6  reserved       2 bytes, zero
+ *   8  segment size   4 bytes
+ *   12 length         8 bytes, plaintext length
+ *   20 nonce          12 bytes, message nonce
+ *   32 ciphertext     length bytes
+ */
+
+#include "kaos_internal.h"
+#include <string.h>
+
+#define KAOS_P_MAGIC "KAOS"
+
+/* One parallel job: every segment of one message */
+typedef struct {
+    KaosCipher* cipher;
+    const uint8_t* in;
+    uint8_t* out;
+    size_t length;
+    size_t segment_size;
+    const uint8_t* key;
+    const uint8_t* nonce;
+} KaosSegmentJob;
+
+size_t kaos_p_container_size(size_t length) {
+    if (length > SIZE_MAX - KAOS_P_HEADER_SIZE) {
+        return 0;
+    }
+    return KAOS_P_HEADER_SIZE + length;
+}
+
+/*
+ * SEGMENT NONCE - splitmix64(index + 1) folded into nonce bytes 4..11
+ */
+void kaos_p_segment_nonce(const uint8_t* nonce_96bit, uint64_t index,
+                          uint8_t* segment_nonce) {
+    uint64_t z = (index + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+
+    memcpy(segment_nonce, nonce_96bit, KAOS_NONCE_SIZE);
+    for (int i = 0; i < 8; i++) {
+        segment_nonce[4 + i] ^= (uint8_t)(z >> (8 * i));
+    }
+}
+
+/* Parallel task: encrypt (or decrypt) one segment */
+static void kaos_segment_task(void* ctx, size_t segment) {
+    KaosSegmentJob* job = (KaosSegmentJob*)ctx;
+    size_t offset = segment * job->segment_size;
+    size_t n = job->length - offset;
+    if (n > job->segment_size) n = job->segment_size;
+
+    uint8_t nonce[KAOS_NONCE_SIZE];
+    kaos_p_segment_nonce(job->nonce, segment, nonce);
+    kaos_encrypt_into(job->cipher, job->in + offset, job->out + offset, n,
+                      job->key, nonce);
+}
+
+static void kaos_segments_run(KaosSegmentJob* job, int threads) {
+    if (job->length == 0) {
+        return;
+    }
+
+    size_t segments = (job->length - 1) / job->segment_size + 1;
+    kaos_parallel_for(segments, threads, kaos_segment_task, job);
+}
+
+/*
+ * SEGMENTED ENCRYPTION - header, then ciphertext in segment order
+ */
+int kaos_p_encrypt(KaosCipher* cipher, const uint8_t* in, size_t length,
+                   uint8_t* out, size_t out_capacity,
+                   const uint8_t* key_256bit, const uint8_t* nonce_96bit,
+                   uint32_t segment_size, int threads) {
+    size_t size = kaos_p_container_size(length);
+
+    // Validate inputs
+    if (!cipher || (length > 0 && !in) || !out || !key_256bit || !nonce_96bit ||
+        size == 0 || out_capacity < size) {
+        return 0;
+    }
+
+    if (segment_size == 0) {
+        segment_size = KAOS_P_SEGMENT_DEFAULT;
+    }
+
+    memcpy(out, KAOS_P_MAGIC, 4);
+    out[4] = KAOS_P_VERSION;
+    out[5] = KAOS_P_MODE_SEGMENTED;
+    out[6] = 0;
+    out[7] = 0;
+    for (int i = 0; i < 4; i++) out[8 + i] = (uint8_t)(segment_size >> (8 * i));
+    for (int i = 0; i < 8; i++) out[12 + i] = (uint8_t)((uint64_t)length >> (8 * i));
+    memcpy(out + 20, nonce_96bit, KAOS_NONCE_SIZE);
+
+    KaosSegmentJob job = { cipher, in, out + KAOS_P_HEADER_SIZE, length,
+                           segment_size, key_256bit, nonce_96bit };
+    kaos_segments_run(&job, threads);
+
+    return 1;
+}
+
+int kaos_p_parse_header(const uint8_t* container, size_t container_length,
+                        KaosPHeader* header) {
+    if (!container || !header || container_length < KAOS_P_HEADER_SIZE ||
+        memcmp(container, KAOS_P_MAGIC, 4) != 0 ||
+        container[4] != KAOS_P_VERSION || container[5] != KAOS_P_MODE_SEGMENTED) {
+        return 0;
+    }
+
+    header->version = container[4];
+    header->mode = container[5];
+    header->segment_size = 0;
+    header->length = 0;
+    for (int i = 3; i >= 0; i--) header->segment_size = (header->segment_size << 8) | container[8 + i];
+    for (int i = 7; i >= 0; i--) header->length = (header->length << 8) | container[12 + i];
+    memcpy(header->nonce, container + 20, KAOS_NONCE_SIZE);
+
+    return header->segment_size > 0;
+}
+
+/*
+ * SEGMENTED DECRYPTION - same segments, same nonces (XOR symmetry)
+ */
+int kaos_p_decrypt(KaosCipher* cipher, const uint8_t* container,
+                   size_t container_length, uint8_t* out, size_t out_capacity,
+                   const uint8_t* key_256bit, int threads) {
+    KaosPHeader header;
+
+    // Validate inputs
+    if (!cipher || !key_256bit || !kaos_p_parse_header(container, container_length, &header) ||
+        header.length != container_length - KAOS_P_HEADER_SIZE ||
+        (header.length > 0 && !out) || out_capacity < header.length) {
+        return 0;
+    }
+
+    KaosSegmentJob job = { cipher, container + KAOS_P_HEADER_SIZE, out,
+                           (size_t)header.length, header.segment_size,
+                           key_256bit, header.nonce };
+    kaos_segments_run(&job, threads);
+
+    return 1;
+}
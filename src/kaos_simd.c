@@ -0,0 +1,245 @@
+/**
+ * KAOS CIPHER - Stream Cipher Based on Lorenz Chaotic System
+ * ISA-specific kernels (SSE2 / AVX2 / AVX-512)
+ * Author: Simón M. Guiñazú
+ * Github: https://github.com/sysphersec/kaos-cipher
+ *
+ * Each function is compiled for its instruction set with a target
+ * attribute, so the library needs no global -m flags. The dispatcher
+ * only calls a kernel after checking the CPU supports it and that it
+ * reproduces the scalar reference bit for bit.
+ */
+
+/* Every multiply and add must round exactly like the scalar reference */
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#include "kaos_internal.h"
+
+#ifdef KAOS_HAVE_X86
+#include <immintrin.h>
+#endif
+
+#ifdef KAOS_HAVE_X86
+
+/*
+ * XOR KERNELS - scalar head up to an aligned output, vector body (4
+ * vectors per iteration, unaligned loads, aligned stores), scalar tail
+ */
+#define KAOS_DEFINE_XOR_KERNEL(isa, target_isa, vec, width, loadu, store, xor_op)    \
+    __attribute__((target(target_isa)))                                             \
+    void kaos_xor_##isa(uint8_t* out, const uint8_t* in, const uint8_t* keystream,  \
+                        size_t length) {                                            \
+        size_t i = 0;                                                               \
+        size_t head = (size_t)(-(uintptr_t)out & ((width) - 1));                    \
+        if (head > length) head = length;                                           \
+        for (; i < head; i++) {                                                     \
+            out[i] = in[i] ^ keystream[i];                                          \
+        }                                                                           \
+        for (; i + 4 * (width) <= length; i += 4 * (width)) {                       \
+            vec a0 = loadu((const vec*)(in + i));                                   \
+            vec a1 = loadu((const vec*)(in + i + (width)));                         \
+            vec a2 = loadu((const vec*)(in + i + 2 * (width)));                     \
+            vec a3 = loadu((const vec*)(in + i + 3 * (width)));                     \
+            vec k0 = loadu((const vec*)(keystream + i));                            \
+            vec k1 = loadu((const vec*)(keystream + i + (width)));                  \
+            vec k2 = loadu((const vec*)(keystream + i + 2 * (width)));              \
+            vec k3 = loadu((const vec*)(keystream + i + 3 * (width)));              \
+            store((vec*)(out + i), xor_op(a0, k0));                                 \
+            store((vec*)(out + i + (width)), xor_op(a1, k1));                       \
+            store((vec*)(out + i + 2 * (width)), xor_op(a2, k2));                   \
+            store((vec*)(out + i + 3 * (width)), xor_op(a3, k3));                   \
+        }                                                                           \
+        for (; i + (width) <= length; i += (width)) {                               \
+            vec a = loadu((const vec*)(in + i));                                    \
+            vec k = loadu((const vec*)(keystream + i));                             \
+            store((vec*)(out + i), xor_op(a, k));                                   \
+        }                                                                           \
+        for (; i < length; i++) {                                                   \
+            out[i] = in[i] ^ keystream[i];                                          \
+        }                                                                           \
+    }
+
+KAOS_DEFINE_XOR_KERNEL(sse2, "sse2", __m128i, 16, _mm_loadu_si128, _mm_store_si128,
+                       _mm_xor_si128)
+KAOS_DEFINE_XOR_KERNEL(avx2, "avx2", __m256i, 32, _mm256_loadu_si256, _mm256_store_si256,
+                       _mm256_xor_si256)
+KAOS_DEFINE_XOR_KERNEL(avx512, "avx512f", __m512i, 64, _mm512_loadu_si512,
+                       _mm512_store_si512, _mm512_xor_si512)
+
+/*
+ * SINGLE-STREAM KERNELS - tiled keystream + XOR compiled per ISA
+ * With SSE4.1+ the compiler turns the truncations into round instructions
+ */
+#define KAOS_DEFINE_STREAM_KERNELS(isa, target_isa)                                 \
+    __attribute__((target(target_isa)))                                             \
+    void kaos_stream_##isa(KaosCipher* cipher, KaosState* state, uint64_t counter,  \
+                           const uint8_t* in, uint8_t* out, size_t length) {        \
+        kaos_xor_tiled(cipher, state, counter, in, out, length, kaos_xor_##isa);    \
+    }                                                                               \
+    __attribute__((target(target_isa)))                                             \
+    void kaos_block_##isa(KaosCipher* cipher, KaosState* state, uint64_t counter,   \
+                          uint8_t* out, size_t length) {                            \
+        kaos_keystream_fused(cipher, state, counter, out, length);                  \
+    }
+
+KAOS_DEFINE_STREAM_KERNELS(sse2, "sse2")
+KAOS_DEFINE_STREAM_KERNELS(avx2, "avx2")
+KAOS_DEFINE_STREAM_KERNELS(avx512, "avx512f")
+
+/*
+ * AVX2 KERNEL - 4 lanes per __m256d
+ * Same operation order as lorenz_step / kaos_keystream_byte
+ */
+__attribute__((target("avx2")))
+void kaos_lanes_avx2(KaosCipher* cipher, KaosLanes* lanes,
+                     const KaosLaneEmit* emit, size_t steps) {
+    const __m256d sigma = _mm256_set1_pd(cipher->sigma);
+    const __m256d rho = _mm256_set1_pd(cipher->rho);
+    const __m256d beta = _mm256_set1_pd(cipher->beta);
+    const __m256d dt = _mm256_set1_pd(cipher->dt);
+
+    __m256d x = _mm256_load_pd(lanes->x);
+    __m256d y = _mm256_load_pd(lanes->y);
+    __m256d z = _mm256_load_pd(lanes->z);
+
+    if (emit->emitting == 0) {
+        // Pure warmup run - no keystream needed
+        for (size_t k = 0; k < steps; k++) {
+            __m256d dx = _mm256_mul_pd(_mm256_mul_pd(sigma, _mm256_sub_pd(y, x)), dt);
+            __m256d dy = _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(x, _mm256_sub_pd(rho, z)), y), dt);
+            __m256d dz = _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(x, y), _mm256_mul_pd(beta, z)), dt);
+            x = _mm256_add_pd(x, dx);
+            y = _mm256_add_pd(y, dy);
+            z = _mm256_add_pd(z, dz);
+        }
+    } else {
+        const __m256d phi = _mm256_set1_pd(KAOS_PHI);
+        const __m256d e = _mm256_set1_pd(KAOS_E);
+        const __m256d pi = _mm256_set1_pd(KAOS_PI);
+        const __m256d scale = _mm256_set1_pd(KAOS_PERTURBATION);
+        const __m256d sign = _mm256_set1_pd(-0.0);
+        const __m256d one = _mm256_set1_pd(1.0);
+        const __m256d byte_range = _mm256_set1_pd(256.0);
+
+        // Counters stay exact in double up to 2^53 bytes
+        __m256d counter = _mm256_set_pd((double)emit->counter[3], (double)emit->counter[2],
+                                        (double)emit->counter[1], (double)emit->counter[0]);
+        int32_t raw[4];
+
+        for (size_t k = 0; k < steps; k++) {
+            __m256d dx = _mm256_mul_pd(_mm256_mul_pd(sigma, _mm256_sub_pd(y, x)), dt);
+            __m256d dy = _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(x, _mm256_sub_pd(rho, z)), y), dt);
+            __m256d dz = _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(x, y), _mm256_mul_pd(beta, z)), dt);
+            x = _mm256_add_pd(x, dx);
+            y = _mm256_add_pd(y, dy);
+            z = _mm256_add_pd(z, dz);
+
+            // fractional = |c| - floor(|c|), then fmod(f + p, 1.0) as a - trunc(a)
+            __m256d combined = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(x, phi),
+                                                           _mm256_mul_pd(y, e)),
+                                             _mm256_mul_pd(z, pi));
+            __m256d magnitude = _mm256_andnot_pd(sign, combined);
+            __m256d fractional = _mm256_sub_pd(magnitude,
+                _mm256_round_pd(magnitude, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC));
+            __m256d sum = _mm256_add_pd(fractional, _mm256_mul_pd(counter, scale));
+            fractional = _mm256_sub_pd(sum,
+                _mm256_round_pd(sum, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC));
+            counter = _mm256_add_pd(counter, one);
+
+            _mm_storeu_si128((__m128i*)raw,
+                             _mm256_cvttpd_epi32(_mm256_mul_pd(fractional, byte_range)));
+
+            for (int l = 0; l < 4; l++) {
+                if (emit->in[l]) {
+                    uint8_t k_byte = kaos_byte_finish((uint8_t)raw[l], emit->counter[l] + k);
+                    emit->out[l][k] = emit->in[l][k] ^ k_byte;
+                }
+            }
+        }
+    }
+
+    _mm256_store_pd(lanes->x, x);
+    _mm256_store_pd(lanes->y, y);
+    _mm256_store_pd(lanes->z, z);
+}
+
+/*
+ * AVX-512 KERNEL - 8 lanes per __m512d
+ */
+__attribute__((target("avx512f")))
+void kaos_lanes_avx512(KaosCipher* cipher, KaosLanes* lanes,
+                       const KaosLaneEmit* emit, size_t steps) {
+    const __m512d sigma = _mm512_set1_pd(cipher->sigma);
+    const __m512d rho = _mm512_set1_pd(cipher->rho);
+    const __m512d beta = _mm512_set1_pd(cipher->beta);
+    const __m512d dt = _mm512_set1_pd(cipher->dt);
+
+    __m512d x = _mm512_load_pd(lanes->x);
+    __m512d y = _mm512_load_pd(lanes->y);
+    __m512d z = _mm512_load_pd(lanes->z);
+
+    if (emit->emitting == 0) {
+        // Pure warmup run - no keystream needed
+        for (size_t k = 0; k < steps; k++) {
+            __m512d dx = _mm512_mul_pd(_mm512_mul_pd(sigma, _mm512_sub_pd(y, x)), dt);
+            __m512d dy = _mm512_mul_pd(_mm512_sub_pd(_mm512_mul_pd(x, _mm512_sub_pd(rho, z)), y), dt);
+            __m512d dz = _mm512_mul_pd(_mm512_sub_pd(_mm512_mul_pd(x, y), _mm512_mul_pd(beta, z)), dt);
+            x = _mm512_add_pd(x, dx);
+            y = _mm512_add_pd(y, dy);
+            z = _mm512_add_pd(z, dz);
+        }
+    } else {
+        const __m512d phi = _mm512_set1_pd(KAOS_PHI);
+        const __m512d e = _mm512_set1_pd(KAOS_E);
+        const __m512d pi = _mm512_set1_pd(KAOS_PI);
+        const __m512d scale = _mm512_set1_pd(KAOS_PERTURBATION);
+        const __m512d one = _mm512_set1_pd(1.0);
+        const __m512d byte_range = _mm512_set1_pd(256.0);
+
+        __m512d counter = _mm512_set_pd((double)emit->counter[7], (double)emit->counter[6],
+                                        (double)emit->counter[5], (double)emit->counter[4],
+                                        (double)emit->counter[3], (double)emit->counter[2],
+                                        (double)emit->counter[1], (double)emit->counter[0]);
+        int32_t raw[8];
+
+        for (size_t k = 0; k < steps; k++) {
+            __m512d dx = _mm512_mul_pd(_mm512_mul_pd(sigma, _mm512_sub_pd(y, x)), dt);
+            __m512d dy = _mm512_mul_pd(_mm512_sub_pd(_mm512_mul_pd(x, _mm512_sub_pd(rho, z)), y), dt);
+            __m512d dz = _mm512_mul_pd(_mm512_sub_pd(_mm512_mul_pd(x, y), _mm512_mul_pd(beta, z)), dt);
+            x = _mm512_add_pd(x, dx);
+            y = _mm512_add_pd(y, dy);
+            z = _mm512_add_pd(z, dz);
+
+            __m512d combined = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(x, phi),
+                                                           _mm512_mul_pd(y, e)),
+                                             _mm512_mul_pd(z, pi));
+            __m512d magnitude = _mm512_abs_pd(combined);
+            __m512d fractional = _mm512_sub_pd(magnitude,
+                _mm512_roundscale_pd(magnitude, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC));
+            __m512d sum = _mm512_add_pd(fractional, _mm512_mul_pd(counter, scale));
+            fractional = _mm512_sub_pd(sum,
+                _mm512_roundscale_pd(sum, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC));
+            counter = _mm512_add_pd(counter, one);
+
+            _mm256_storeu_si256((__m256i*)raw,
+                                _mm512_cvttpd_epi32(_mm512_mul_pd(fractional, byte_range)));
+
+            for (int l = 0; l < 8; l++) {
+                if (emit->in[l]) {
+                    uint8_t k_byte = kaos_byte_finish((uint8_t)raw[l], emit->counter[l] + k);
+                    emit->out[l][k] = emit->in[l][k] ^ k_byte;
+                }
+            }
+        }
+    }
+
+    _mm512_store_pd(lanes->x, x);
+    _mm512_store_pd(lanes->y, y);
+    _mm512_store_pd(lanes->z, z);
+}
+
+#endif /* KAOS_HAVE_X86 */
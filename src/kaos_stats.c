@@ -0,0 +1,353 @@
+/**
+ * KAOS CIPHER - Stream Cipher Based on Lorenz Chaotic System
+ * Phase Statistics - per-thread counters, aggregated on read
+ * Author: Simón M. Guiñazú
+ * Github: https://github.com/sysphersec/kaos-cipher
+ *
+ * Every thread counts calls, bytes and ticks per phase into its own
+ * cache-line aligned block: one writer, relaxed loads and stores, no
+ * locked instructions on the hot path. Blocks are linked into a
+ * registry that snapshots walk; a thread's counts are folded into a
+ * retired total when it exits. Reset records a baseline per block that
+ * later reads subtract, so it never races with the writers.
+ * Without -DKAOS_STATS nothing is recorded and snapshots are all zero.
+ */
+
+#include "kaos_internal.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#ifdef KAOS_STATS
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+/* Calibration window (ns) after which the TSC rate is final */
+#define KAOS_STATS_CALIBRATION_NS 10000000
+
+typedef struct KaosThreadStats {
+    atomic_uint_fast64_t count[KAOS_PHASE_COUNT][3];   // calls, bytes, ticks
+    atomic_uint_fast64_t baseline[KAOS_PHASE_COUNT][3]; // Values at the last reset
+    struct KaosThreadStats* next;
+} KaosThreadStats;
+
+static _Thread_local KaosThreadStats* kaos_thread_stats = NULL;
+static _Thread_local int kaos_thread_paused = 0;
+static pthread_key_t kaos_stats_key;
+static pthread_once_t kaos_stats_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t kaos_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Registry, all under kaos_stats_lock */
+static KaosThreadStats* kaos_stats_threads = NULL;          // Live threads
+static uint64_t kaos_stats_retired[KAOS_PHASE_COUNT][3];    // Exited threads
+static uint64_t kaos_stats_retired_base[KAOS_PHASE_COUNT][3];
+static uint32_t kaos_stats_thread_count = 0;                // Live threads
+
+/* TSC calibration anchor (taken at load time) and the settled rate */
+static uint64_t kaos_stats_anchor_ticks;
+static uint64_t kaos_stats_anchor_ns;
+static _Atomic double kaos_stats_settled_rate = 0.0;
+
+uint64_t kaos_stats_clock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t kaos_stats_load(atomic_uint_fast64_t* counter) {
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+/* Thread exit: fold the counts into the retired total */
+static void kaos_stats_retire(void* arg) {
+    KaosThreadStats* t = (KaosThreadStats*)arg;
+
+    pthread_mutex_lock(&kaos_stats_lock);
+    for (KaosThreadStats** link = &kaos_stats_threads; *link; link = &(*link)->next) {
+        if (*link == t) {
+            *link = t->next;
+            break;
+        }
+    }
+    kaos_stats_thread_count--;
+    for (int p = 0; p < KAOS_PHASE_COUNT; p++) {
+        for (int f = 0; f < 3; f++) {
+            kaos_stats_retired[p][f] += kaos_stats_load(&t->count[p][f]);
+            kaos_stats_retired_base[p][f] += kaos_stats_load(&t->baseline[p][f]);
+        }
+    }
+    pthread_mutex_unlock(&kaos_stats_lock);
+
+    kaos_thread_stats = NULL;
+    free(t);
+}
+
+static void kaos_stats_init(void) {
+    pthread_key_create(&kaos_stats_key, kaos_stats_retire);
+    kaos_stats_anchor_ns = kaos_stats_clock();
+    kaos_stats_anchor_ticks = kaos_stats_ticks();
+}
+
+/* Anchor at load time, so the window has usually elapsed by the first read */
+__attribute__((constructor))
+static void kaos_stats_constructor(void) {
+    pthread_once(&kaos_stats_once, kaos_stats_init);
+}
+
+static KaosThreadStats* kaos_stats_register(void) {
+    pthread_once(&kaos_stats_once, kaos_stats_init);
+
+    KaosThreadStats* t = (KaosThreadStats*)aligned_alloc(64, sizeof(KaosThreadStats));
+    if (!t) {
+        return NULL;
+    }
+    for (int p = 0; p < KAOS_PHASE_COUNT; p++) {
+        for (int f = 0; f < 3; f++) {
+            atomic_init(&t->count[p][f], 0);
+            atomic_init(&t->baseline[p][f], 0);
+        }
+    }
+
+    pthread_mutex_lock(&kaos_stats_lock);
+    t->next = kaos_stats_threads;
+    kaos_stats_threads = t;
+    kaos_stats_thread_count++;
+    pthread_mutex_unlock(&kaos_stats_lock);
+
+    pthread_setspecific(kaos_stats_key, t);
+    kaos_thread_stats = t;
+    return t;
+}
+
+/*
+ * RECORDING - owner thread only
+ */
+static inline void kaos_stats_add(atomic_uint_fast64_t* counter, uint64_t value) {
+    // Single writer: plain load + store, no locked read-modify-write
+    atomic_store_explicit(counter, kaos_stats_load(counter) + value, memory_order_relaxed);
+}
+
+void kaos_stats_pause(int paused) {
+    kaos_thread_paused = paused;
+}
+
+void kaos_stats_record(KaosPhase phase, uint64_t calls, uint64_t bytes, uint64_t ticks) {
+    if (kaos_thread_paused) {
+        return;
+    }
+
+    KaosThreadStats* t = kaos_thread_stats;
+    if (!t && !(t = kaos_stats_register())) {
+        return;
+    }
+
+    kaos_stats_add(&t->count[phase][0], calls);
+    kaos_stats_add(&t->count[phase][1], bytes);
+    kaos_stats_add(&t->count[phase][2], ticks);
+}
+
+/*
+ * READING
+ */
+/*
+ * Ticks per second: TSC rate measured against CLOCK_MONOTONIC since the
+ * anchor. Never waits: a read inside the first window gets the estimate
+ * so far; the first read after it fixes the rate for good
+ */
+static double kaos_stats_rate(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    double rate = atomic_load_explicit(&kaos_stats_settled_rate, memory_order_relaxed);
+    if (rate > 0.0) {
+        return rate;
+    }
+
+    uint64_t ticks = kaos_stats_ticks();
+    uint64_t ns = kaos_stats_clock();
+    if (ns == kaos_stats_anchor_ns) {
+        return 1e9;  // No time has passed, so no ticks were recorded either
+    }
+    rate = (double)(ticks - kaos_stats_anchor_ticks) * 1e9 / (double)(ns - kaos_stats_anchor_ns);
+    if (ns - kaos_stats_anchor_ns >= KAOS_STATS_CALIBRATION_NS) {
+        atomic_store_explicit(&kaos_stats_settled_rate, rate, memory_order_relaxed);
+    }
+    return rate;
+#else
+    return 1e9;
+#endif
+}
+
+static void kaos_stats_fill(KaosStats* stats, uint64_t sum[KAOS_PHASE_COUNT][3]) {
+    stats->enabled = 1;
+    stats->ticks_per_second = kaos_stats_rate();
+    for (int p = 0; p < KAOS_PHASE_COUNT; p++) {
+        stats->phase[p].calls = sum[p][0];
+        stats->phase[p].bytes = sum[p][1];
+        stats->phase[p].ticks = sum[p][2];
+        stats->phase[p].seconds = (double)sum[p][2] / stats->ticks_per_second;
+    }
+}
+
+void kaos_stats_snapshot(KaosStats* stats) {
+    if (!stats) {
+        return;
+    }
+    memset(stats, 0, sizeof(KaosStats));
+    pthread_once(&kaos_stats_once, kaos_stats_init);
+
+    uint64_t sum[KAOS_PHASE_COUNT][3];
+    pthread_mutex_lock(&kaos_stats_lock);
+    for (int p = 0; p < KAOS_PHASE_COUNT; p++) {
+        for (int f = 0; f < 3; f++) {
+            sum[p][f] = kaos_stats_retired[p][f] - kaos_stats_retired_base[p][f];
+            for (KaosThreadStats* t = kaos_stats_threads; t; t = t->next) {
+                sum[p][f] += kaos_stats_load(&t->count[p][f]) - kaos_stats_load(&t->baseline[p][f]);
+            }
+        }
+    }
+    stats->threads = kaos_stats_thread_count;
+    pthread_mutex_unlock(&kaos_stats_lock);
+
+    kaos_stats_fill(stats, sum);
+}
+
+void kaos_stats_thread_snapshot(KaosStats* stats) {
+    if (!stats) {
+        return;
+    }
+    memset(stats, 0, sizeof(KaosStats));
+    pthread_once(&kaos_stats_once, kaos_stats_init);
+
+    uint64_t sum[KAOS_PHASE_COUNT][3] = { { 0 } };
+    KaosThreadStats* t = kaos_thread_stats;
+    if (t) {
+        // Baselines are written by kaos_stats_reset under the lock
+        pthread_mutex_lock(&kaos_stats_lock);
+        for (int p = 0; p < KAOS_PHASE_COUNT; p++) {
+            for (int f = 0; f < 3; f++) {
+                sum[p][f] = kaos_stats_load(&t->count[p][f]) - kaos_stats_load(&t->baseline[p][f]);
+            }
+        }
+        pthread_mutex_unlock(&kaos_stats_lock);
+        stats->threads = 1;
+    }
+
+    kaos_stats_fill(stats, sum);
+}
+
+void kaos_stats_reset(void) {
+    pthread_mutex_lock(&kaos_stats_lock);
+    memcpy(kaos_stats_retired_base, kaos_stats_retired, sizeof(kaos_stats_retired));
+    for (KaosThreadStats* t = kaos_stats_threads; t; t = t->next) {
+        for (int p = 0; p < KAOS_PHASE_COUNT; p++) {
+            for (int f = 0; f < 3; f++) {
+                atomic_store_explicit(&t->baseline[p][f], kaos_stats_load(&t->count[p][f]),
+                                      memory_order_relaxed);
+            }
+        }
+    }
+    pthread_mutex_unlock(&kaos_stats_lock);
+}
+
+#else /* !KAOS_STATS */
+
+void kaos_stats_snapshot(KaosStats* stats) {
+    if (stats) {
+        memset(stats, 0, sizeof(KaosStats));
+    }
+}
+
+void kaos_stats_thread_snapshot(KaosStats* stats) {
+    kaos_stats_snapshot(stats);
+}
+
+void kaos_stats_reset(void) {
+}
+
+#endif /* KAOS_STATS */
+
+/*
+ * FORMATTING
+ */
+static const char* const kaos_phase_names[KAOS_PHASE_COUNT] = {
+    "key_setup", "warmup", "keystream", "xor"
+};
+
+const char* kaos_phase_name(KaosPhase phase) {
+    if (phase < 0 || phase >= KAOS_PHASE_COUNT) {
+        return "unknown";
+    }
+    return kaos_phase_names[phase];
+}
+
+/* snprintf that keeps counting once the buffer is full */
+static void kaos_stats_append(char* buffer, size_t size, size_t* length,
+                              const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    size_t room = *length < size ? size - *length : 0;
+    int n = vsnprintf(room ? buffer + *length : NULL, room, format, args);
+    va_end(args);
+    if (n > 0) {
+        *length += (size_t)n;
+    }
+}
+
+size_t kaos_stats_format(const KaosStats* stats, KaosStatsFormat format,
+                         char* buffer, size_t size) {
+    if (!stats || (size > 0 && !buffer)) {
+        return 0;
+    }
+    if (size > 0) {
+        buffer[0] = '\0';
+    }
+
+    size_t length = 0;
+    if (format == KAOS_STATS_JSON) {
+        kaos_stats_append(buffer, size, &length,
+                          "{\"enabled\":%s,\"threads\":%u,\"ticks_per_second\":%.0f,\"phases\":{",
+                          stats->enabled ? "true" : "false", stats->threads,
+                          stats->ticks_per_second);
+        for (int p = 0; p < KAOS_PHASE_COUNT; p++) {
+            const KaosPhaseStats* s = &stats->phase[p];
+            kaos_stats_append(buffer, size, &length,
+                              "%s\"%s\":{\"calls\":%llu,\"bytes\":%llu,\"ticks\":%llu,\"seconds\":%.9f}",
+                              p ? "," : "", kaos_phase_names[p],
+                              (unsigned long long)s->calls, (unsigned long long)s->bytes,
+                              (unsigned long long)s->ticks, s->seconds);
+        }
+        kaos_stats_append(buffer, size, &length, "}}\n");
+        return length;
+    }
+
+    if (!stats->enabled) {
+        kaos_stats_append(buffer, size, &length,
+                          "Phase statistics disabled (library built without -DKAOS_STATS)\n");
+        return length;
+    }
+
+    kaos_stats_append(buffer, size, &length,
+                      "%-10s %12s %14s %10s %12s %11s %10s\n", "phase", "calls", "bytes",
+                      "seconds", "ticks/call", "ticks/byte", "MB/s");
+    for (int p = 0; p < KAOS_PHASE_COUNT; p++) {
+        const KaosPhaseStats* s = &stats->phase[p];
+        kaos_stats_append(buffer, size, &length, "%-10s %12llu %14llu %10.4f ",
+                          kaos_phase_names[p], (unsigned long long)s->calls,
+                          (unsigned long long)s->bytes, s->seconds);
+        if (s->calls) {
+            kaos_stats_append(buffer, size, &length, "%12.1f ", (double)s->ticks / s->calls);
+        } else {
+            kaos_stats_append(buffer, size, &length, "%12s ", "-");
+        }
+        if (s->bytes && s->seconds > 0.0) {
+            kaos_stats_append(buffer, size, &length, "%11.3f %10.2f\n",
+                              (double)s->ticks / s->bytes, s->bytes / 1048576.0 / s->seconds);
+        } else {
+            kaos_stats_append(buffer, size, &length, "%11s %10s\n", "-", "-");
+        }
+    }
+    kaos_stats_append(buffer, size, &length, "(%u threads, %.3f GHz ticks)\n",
+                      stats->threads, stats->ticks_per_second / 1e9);
+    return length;
+}